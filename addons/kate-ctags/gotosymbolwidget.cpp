@@ -17,15 +17,15 @@
 #include <QScrollBar>
 #include <QSortFilterProxyModel>
 #include <QCoreApplication>
-#include <QStyledItemDelegate>
-#include <QTextDocument>
-#include <QPainter>
+#include <QFileInfo>
 #include <QPropertyAnimation>
 
 #include <KTextEditor/MainWindow>
 #include <KTextEditor/View>
 #include <KTextEditor/Message>
 
+#include <fuzzyhighlightdelegate.h>
+
 class QuickOpenFilterProxyModel : public QSortFilterProxyModel {
 public:
     QuickOpenFilterProxyModel(QObject *parent = nullptr) : QSortFilterProxyModel(parent)
@@ -63,75 +63,6 @@ private:
     QStringList m_filterStrings;
 };
 
-class GotoStyleDelegate : public QStyledItemDelegate {
-
-public:
-    GotoStyleDelegate(QObject* parent = nullptr)
-        : QStyledItemDelegate(parent)
-    {}
-
-    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
-    {
-        QStyleOptionViewItem options = option;
-        initStyleOption(&options, index);
-
-        QTextDocument doc;
-
-        QString str = index.data().toString();
-        for (const auto& string : m_filterStrings) {
-            // FIXME: This will skip the letter 'b' if the string
-            // has only one letter so that we don't match inside
-            // <b> tags.
-            if (string == QLatin1String("b"))
-                continue;
-            const QRegularExpression re (QStringLiteral("(")+QRegularExpression::escape(string)+QStringLiteral(")"), QRegularExpression::CaseInsensitiveOption);
-            str.replace(re, QStringLiteral("<b>\\1</b>"));
-        }
-
-        auto file = index.data(GotoGlobalSymbolModel::FileUrl).toString();
-        // this will be empty for local symbol mode
-        if (!file.isEmpty())
-            str += QStringLiteral(" &nbsp;<span style=\"color: gray;\">") + QFileInfo(file).fileName() + QStringLiteral("</span>");
-
-        doc.setHtml(str);
-        doc.setDocumentMargin(2);
-
-        painter->save();
-
-        // paint background
-        if (option.state & QStyle::State_Selected) {
-            painter->fillRect(option.rect, option.palette.highlight());
-        } else {
-            painter->fillRect(option.rect, option.palette.base());
-        }
-
-        options.text = QString(); // clear old text
-        options.widget->style()->drawControl(QStyle::CE_ItemViewItem, &options, painter, options.widget);
-
-        // draw text
-        painter->translate(option.rect.x(), option.rect.y());
-        if (index.column() == 0) {
-            painter->translate(25, 0);
-        }
-        doc.drawContents(painter);
-
-        painter->restore();
-    }
-
-public Q_SLOTS:
-    void setFilterStrings(const QString& text)
-    {
-        #if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
-        m_filterStrings = text.split(QLatin1Char(' '), QString::SkipEmptyParts);
-        #else
-        m_filterStrings = text.split(QLatin1Char(' '), Qt::SkipEmptyParts);
-        #endif
-    }
-
-private:
-    QStringList m_filterStrings;
-};
-
 GotoSymbolWidget::GotoSymbolWidget(KTextEditor::MainWindow* mainWindow, KateCTagsView *pluginView, QWidget *widget)
     : QWidget(widget),
       ctagsPluginView(pluginView),
@@ -143,7 +74,13 @@ GotoSymbolWidget::GotoSymbolWidget(KTextEditor::MainWindow* mainWindow, KateCTag
     mode = Local;
 
     m_treeView = new GotoSymbolTreeView(mainWindow, this);
-    m_styleDelegate = new GotoStyleDelegate(this);
+    m_styleDelegate = new FuzzyHighlightDelegate(this);
+    m_styleDelegate->setMatchMode(FuzzyHighlightDelegate::SubstringMatch);
+    m_styleDelegate->setSecondaryText([](const QModelIndex &index) {
+        // this will be empty for local symbol mode
+        const QString file = index.data(GotoGlobalSymbolModel::FileUrl).toString();
+        return file.isEmpty() ? QString() : QFileInfo(file).fileName();
+    });
     m_treeView->setItemDelegate(m_styleDelegate);
     m_lineEdit = new QLineEdit(this);
 
@@ -163,7 +100,9 @@ GotoSymbolWidget::GotoSymbolWidget(KTextEditor::MainWindow* mainWindow, KateCTag
     m_treeView->setModel(m_proxyModel);
 
     connect(m_lineEdit, &QLineEdit::textChanged, m_proxyModel, &QuickOpenFilterProxyModel::setFilterText);
-    connect(m_lineEdit, &QLineEdit::textChanged, m_styleDelegate, &GotoStyleDelegate::setFilterStrings);
+    connect(m_lineEdit, &QLineEdit::textChanged, m_styleDelegate, [this](const QString &text) {
+        m_styleDelegate->setFilterString(text);
+    });
     connect(m_lineEdit, &QLineEdit::textChanged, this, [this](){ m_treeView->viewport()->update(); });
     connect(m_lineEdit, &QLineEdit::textChanged, this, &GotoSymbolWidget::loadGlobalSymbols);
     connect(m_lineEdit, &QLineEdit::returnPressed, this, &GotoSymbolWidget::slotReturnPressed);
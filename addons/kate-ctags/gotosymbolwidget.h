@@ -16,7 +16,7 @@ class QuickOpenFilterProxyModel;
 class QTreeView;
 class GotoGlobalSymbolModel;
 class KateCTagsView;
-class GotoStyleDelegate;
+class FuzzyHighlightDelegate;
 
 namespace KTextEditor {
 class MainWindow;
@@ -47,7 +47,7 @@ private:
 private:
     Mode mode;
     KateCTagsView* ctagsPluginView;
-    GotoStyleDelegate* m_styleDelegate;
+    FuzzyHighlightDelegate* m_styleDelegate;
     KTextEditor::MainWindow* m_mainWindow;
     GotoSymbolTreeView* m_treeView;
     QuickOpenFilterProxyModel* m_proxyModel;
@@ -0,0 +1,265 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientbenchmark.h"
+#include "lspclientserver.h"
+#include "lspclientsymbolcache.h"
+
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QtTest>
+
+#include <functional>
+
+QTEST_GUILESS_MAIN(LSPClientBenchmark)
+
+enum {
+    // ms to wait for a reply, more than plenty even for a slow build
+    Timeout = 60000
+};
+
+static QJsonObject request(int id, const QString &method)
+{
+    return QJsonObject {{QStringLiteral("jsonrpc"), QStringLiteral("2.0")}, {QStringLiteral("id"), id}, {QStringLiteral("method"), method}};
+}
+
+static QJsonObject notification(const QString &method, const QJsonObject &params = QJsonObject())
+{
+    return QJsonObject {{QStringLiteral("jsonrpc"), QStringLiteral("2.0")}, {QStringLiteral("method"), method}, {QStringLiteral("params"), params}};
+}
+
+static QJsonObject reply(int id, const QJsonValue &result)
+{
+    return QJsonObject {{QStringLiteral("jsonrpc"), QStringLiteral("2.0")}, {QStringLiteral("id"), id}, {QStringLiteral("result"), result}};
+}
+
+static QJsonObject range(int line, int column, int length)
+{
+    return QJsonObject {{QStringLiteral("start"), QJsonObject {{QStringLiteral("line"), line}, {QStringLiteral("character"), column}}},
+                        {QStringLiteral("end"), QJsonObject {{QStringLiteral("line"), line}, {QStringLiteral("character"), column + length}}}};
+}
+
+// runs the event loop until the function passed to start is called, false on timeout
+template<typename Function> static bool waitFor(Function start)
+{
+    QEventLoop loop;
+    bool done = false;
+    start([&loop, &done]() {
+        done = true;
+        loop.quit();
+    });
+    if (!done) {
+        QTimer::singleShot(Timeout, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    return done;
+}
+
+void LSPClientBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_document = QUrl::fromLocalFile(m_dir.filePath(QStringLiteral("test.cpp")));
+}
+
+QString LSPClientBenchmark::writeLog(const QString &name, const QVector<Message> &messages)
+{
+    const auto fileName = m_dir.filePath(name + QStringLiteral(".lsplog"));
+    LSPMessageLog log;
+    if (!log.open(fileName)) {
+        return QString();
+    }
+
+    QJsonObject legend {{QStringLiteral("tokenTypes"), QJsonArray {QStringLiteral("variable"), QStringLiteral("function")}}, {QStringLiteral("tokenModifiers"), QJsonArray()}};
+    QJsonObject capabilities {{QStringLiteral("referencesProvider"), true},
+                              {QStringLiteral("semanticTokensProvider"), QJsonObject {{QStringLiteral("legend"), legend}, {QStringLiteral("full"), true}}}};
+    const QVector<Message> handshake = {{LSPMessageLog::Outgoing, request(1, QStringLiteral("initialize"))},
+                                        {LSPMessageLog::Incoming, reply(1, QJsonObject {{QStringLiteral("capabilities"), capabilities}})},
+                                        {LSPMessageLog::Outgoing, notification(QStringLiteral("initialized"))}};
+    for (const auto &part : {handshake, messages}) {
+        for (const auto &message : part) {
+            log.write(message.first, QJsonDocument(message.second).toJson(QJsonDocument::Compact));
+        }
+    }
+    return fileName;
+}
+
+std::unique_ptr<LSPClientServer> LSPClientBenchmark::startServer(const QString &log)
+{
+    // no delays, the benchmark is about the client
+    std::unique_ptr<LSPClientServer> server(new LSPClientServer({QStringLiteral(LSPREPLAYSERVER), log, QStringLiteral("0")}, QUrl::fromLocalFile(m_dir.path())));
+    QMetaObject::Connection connection;
+    const bool running = waitFor([&server, &connection](const std::function<void()> &done) {
+        connection = QObject::connect(server.get(), &LSPClientServer::stateChanged, server.get(), [done](LSPClientServer *s) {
+            if (s->state() == LSPClientServer::State::Running) {
+                done();
+            }
+        });
+        server->start(nullptr);
+    });
+    QObject::disconnect(connection);
+    if (!running) {
+        server.reset();
+    }
+    return server;
+}
+
+void LSPClientBenchmark::benchmarkReferences()
+{
+    const int count = 100000;
+    QJsonArray locations;
+    for (int i = 0; i < count; ++i) {
+        locations.push_back(QJsonObject {{QStringLiteral("uri"), m_document.toString()}, {QStringLiteral("range"), range(i, 4, 8)}});
+    }
+    const auto log = writeLog(QStringLiteral("references"),
+                              {{LSPMessageLog::Outgoing, request(2, QStringLiteral("textDocument/references"))}, {LSPMessageLog::Incoming, reply(2, locations)}});
+    QVERIFY(!log.isEmpty());
+    auto server = startServer(log);
+    QVERIFY(server);
+
+    QList<LSPLocation> result;
+    bool replied = false;
+    QBENCHMARK_ONCE {
+        replied = waitFor([this, &server, &result](const std::function<void()> &done) {
+            server->documentReferences(m_document, {0, 4}, false, this, [&result, done](const QList<LSPLocation> &locations) {
+                result = locations;
+                done();
+            });
+        });
+    }
+    QVERIFY(replied);
+    QCOMPARE(result.size(), count);
+}
+
+void LSPClientBenchmark::benchmarkDiagnostics()
+{
+    const int count = 50000;
+    QJsonArray diagnostics;
+    for (int i = 0; i < count; ++i) {
+        diagnostics.push_back(QJsonObject {{QStringLiteral("range"), range(i, 0, 10)},
+                                           {QStringLiteral("severity"), 1 + i % 4},
+                                           {QStringLiteral("source"), QStringLiteral("benchmark")},
+                                           {QStringLiteral("message"), QStringLiteral("diagnostic %1").arg(i)}});
+    }
+    QJsonObject params {{QStringLiteral("uri"), m_document.toString()}, {QStringLiteral("diagnostics"), diagnostics}};
+    const auto log = writeLog(QStringLiteral("diagnostics"),
+                              {{LSPMessageLog::Outgoing, notification(QStringLiteral("textDocument/didOpen"))},
+                               {LSPMessageLog::Incoming, notification(QStringLiteral("textDocument/publishDiagnostics"), params)}});
+    QVERIFY(!log.isEmpty());
+    auto server = startServer(log);
+    QVERIFY(server);
+
+    LSPPublishDiagnosticsParams result;
+    bool published = false;
+    QMetaObject::Connection connection;
+    QBENCHMARK_ONCE {
+        published = waitFor([this, &server, &result, &connection](const std::function<void()> &done) {
+            connection = QObject::connect(server.get(), &LSPClientServer::publishDiagnostics, this, [&result, done](const LSPPublishDiagnosticsParams &diagnostics) {
+                result = diagnostics;
+                done();
+            });
+            server->didOpen(m_document, 1, QString(), QString());
+        });
+    }
+    QObject::disconnect(connection);
+    QVERIFY(published);
+    QCOMPARE(result.uri, m_document);
+    QCOMPARE(result.diagnostics.size(), count);
+}
+
+void LSPClientBenchmark::benchmarkSemanticTokens()
+{
+    const int count = 200000;
+    QJsonArray data;
+    for (int i = 0; i < count; ++i) {
+        // a token per line
+        for (int value : {1, 4, 8, i % 2, 0}) {
+            data.push_back(value);
+        }
+    }
+    QJsonObject tokens {{QStringLiteral("resultId"), QStringLiteral("1")}, {QStringLiteral("data"), data}};
+    const auto log = writeLog(QStringLiteral("semantictokens"),
+                              {{LSPMessageLog::Outgoing, request(2, QStringLiteral("textDocument/semanticTokens/full"))}, {LSPMessageLog::Incoming, reply(2, tokens)}});
+    QVERIFY(!log.isEmpty());
+    auto server = startServer(log);
+    QVERIFY(server);
+
+    LSPSemanticTokensDelta result;
+    bool replied = false;
+    QBENCHMARK_ONCE {
+        replied = waitFor([this, &server, &result](const std::function<void()> &done) {
+            server->documentSemanticTokensFull(m_document, this, [&result, done](const LSPSemanticTokensDelta &tokens) {
+                result = tokens;
+                done();
+            });
+        });
+    }
+    QVERIFY(replied);
+    QCOMPARE(result.resultId, QStringLiteral("1"));
+    QCOMPARE(result.data.size(), 5 * count);
+}
+
+// names of generated symbols, a few kinds of each
+static QString symbolName(int i)
+{
+    static const char *const parts[] = {"parse", "Document", "symbol", "Range", "server", "Reply", "cache", "Index"};
+    return QStringLiteral("%1%2%3").arg(QLatin1String(parts[i % 8]), QLatin1String(parts[(i / 8) % 8])).arg(i);
+}
+
+void LSPClientBenchmark::benchmarkWorkspaceSymbols()
+{
+    const int count = 50000;
+    QJsonArray symbols;
+    for (int i = 0; i < count; ++i) {
+        // a hundred symbols per file
+        const auto uri = QUrl::fromLocalFile(m_dir.filePath(QStringLiteral("file%1.cpp").arg(i / 100))).toString();
+        QJsonObject location {{QStringLiteral("uri"), uri}, {QStringLiteral("range"), range(i % 100, 0, 8)}};
+        symbols.push_back(QJsonObject {{QStringLiteral("name"), symbolName(i)}, {QStringLiteral("kind"), 12}, {QStringLiteral("location"), location}});
+    }
+    const auto log = writeLog(QStringLiteral("workspacesymbols"),
+                              {{LSPMessageLog::Outgoing, request(2, QStringLiteral("workspace/symbol"))}, {LSPMessageLog::Incoming, reply(2, symbols)}});
+    QVERIFY(!log.isEmpty());
+    auto server = startServer(log);
+    QVERIFY(server);
+
+    QList<LSPWorkspaceSymbol> result;
+    bool replied = false;
+    QBENCHMARK_ONCE {
+        replied = waitFor([this, &server, &result](const std::function<void()> &done) {
+            server->workspaceSymbol(QStringLiteral("sym"), this, [&result, done](const QList<LSPWorkspaceSymbol> &symbols) {
+                result = symbols;
+                done();
+            });
+        });
+    }
+    QVERIFY(replied);
+    QCOMPARE(result.size(), count);
+    // all kept for later queries
+    QCOMPARE(server->symbols().size(), count);
+}
+
+void LSPClientBenchmark::benchmarkSymbolCache()
+{
+    const int count = 200000;
+    QList<LSPWorkspaceSymbol> symbols;
+    for (int i = 0; i < count; ++i) {
+        const auto url = QUrl::fromLocalFile(m_dir.filePath(QStringLiteral("file%1.cpp").arg(i / 100)));
+        symbols.push_back({symbolName(i), LSPSymbolKind::Function, {url, {i % 100, 0, i % 100, 8}}, QString()});
+    }
+    LSPClientSymbolCache cache;
+    cache.add(symbols);
+    QCOMPARE(cache.size(), count);
+
+    // what the dialog does on every key stroke
+    QVector<LSPClientSymbolCache::Match> matches;
+    QBENCHMARK {
+        matches = cache.find(QStringLiteral("symRep"), 200);
+    }
+    QCOMPARE(matches.size(), 200);
+    QVERIFY(matches.front().symbol.name.startsWith(QLatin1String("symbolReply")));
+}
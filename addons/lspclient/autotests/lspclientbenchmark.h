@@ -0,0 +1,51 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTBENCHMARK_H
+#define LSPCLIENTBENCHMARK_H
+
+#include "lspclienttransport.h"
+
+#include <QJsonObject>
+#include <QObject>
+#include <QPair>
+#include <QTemporaryDir>
+#include <QUrl>
+#include <QVector>
+
+#include <memory>
+
+class LSPClientServer;
+
+// client side cost of big replies and notifications,
+// as played back by lspreplayserver (so no real server needed)
+class LSPClientBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkReferences();
+    void benchmarkDiagnostics();
+    void benchmarkSemanticTokens();
+    void benchmarkWorkspaceSymbols();
+    void benchmarkSymbolCache();
+
+private:
+    using Message = QPair<LSPMessageLog::Direction, QJsonObject>;
+
+    // log of a session with the initialize handshake followed by messages
+    QString writeLog(const QString &name, const QVector<Message> &messages);
+
+    // running server that plays back log
+    std::unique_ptr<LSPClientServer> startServer(const QString &log);
+
+    QTemporaryDir m_dir;
+    QUrl m_document;
+};
+
+#endif
@@ -0,0 +1,235 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientcontentchangestest.h"
+#include "lspclientcontentchanges.h"
+
+#include <QtTest>
+
+#include <algorithm>
+
+QTEST_GUILESS_MAIN(LSPClientContentChangesTest)
+
+static int offset(const QString &text, const LSPPosition &pos)
+{
+    int index = 0;
+    for (int line = 0; line < pos.line(); ++line) {
+        index = text.indexOf(QLatin1Char('\n'), index) + 1;
+    }
+    return index + pos.column();
+}
+
+static LSPPosition position(const QString &text, int offset)
+{
+    const int line = text.leftRef(offset).count(QLatin1Char('\n'));
+    const int lineStart = offset > 0 ? text.lastIndexOf(QLatin1Char('\n'), offset - 1) + 1 : 0;
+    return {line, offset - lineStart};
+}
+
+static void apply(QString &text, const LSPRange &range, const QString &replacement)
+{
+    const int start = offset(text, range.start());
+    text.replace(start, offset(text, range.end()) - start, replacement);
+}
+
+// a document being edited, recording the edits like the server manager does
+struct Document {
+    explicit Document(const QString &text)
+        : original(text)
+        , text(text)
+    {
+    }
+
+    void insert(int at, const QString &inserted)
+    {
+        const auto pos = position(text, at);
+        addChange(changes, {pos, pos}, inserted, QString());
+        text.insert(at, inserted);
+    }
+
+    void remove(int at, int count)
+    {
+        addChange(changes, {position(text, at), position(text, at + count)}, QString(), text.mid(at, count));
+        text.remove(at, count);
+    }
+
+    // e.g. a line unwrap, reported with the replacement text only
+    void replace(int at, int count, const QString &replacement)
+    {
+        addChange(changes, {position(text, at), position(text, at + count)}, replacement, QString());
+        text.replace(at, count, replacement);
+    }
+
+    // the original text with the merged changes applied in order
+    QString merged() const
+    {
+        QString result = original;
+        for (const auto &change : changes) {
+            apply(result, change.range, change.text);
+        }
+        return result;
+    }
+
+    const QString original;
+    QString text;
+    QList<LSPTextDocumentContentChangeEvent> changes;
+};
+
+void LSPClientContentChangesTest::testAdvance()
+{
+    QCOMPARE(advance({2, 3}, QString()), LSPPosition(2, 3));
+    QCOMPARE(advance({2, 3}, QStringLiteral("abc")), LSPPosition(2, 6));
+    QCOMPARE(advance({2, 3}, QStringLiteral("a\n")), LSPPosition(3, 0));
+    QCOMPARE(advance({2, 3}, QStringLiteral("a\nbc\ndef")), LSPPosition(4, 3));
+}
+
+void LSPClientContentChangesTest::testTyping()
+{
+    Document doc(QStringLiteral("int x;\n"));
+    int at = 6;
+    for (const auto &typed : {QStringLiteral("\n"), QStringLiteral("i"), QStringLiteral("nt"), QStringLiteral(" y;"), QStringLiteral("\n")}) {
+        doc.insert(at, typed);
+        at += typed.size();
+    }
+    QCOMPARE(doc.changes.size(), 1);
+    QCOMPARE(doc.changes[0].text, QStringLiteral("\nint y;\n"));
+    QCOMPARE(doc.merged(), doc.text);
+}
+
+void LSPClientContentChangesTest::testBackspace()
+{
+    Document doc(QStringLiteral("first\nsecond\nthird\n"));
+    // from the end of "second" back over the line break into "first"
+    for (int at = 11; at >= 3; --at) {
+        doc.remove(at, 1);
+    }
+    QCOMPARE(doc.changes.size(), 1);
+    QCOMPARE(doc.changes[0].range, LSPRange(0, 3, 1, 6));
+    QCOMPARE(doc.text, QStringLiteral("fir\nthird\n"));
+    QCOMPARE(doc.merged(), doc.text);
+}
+
+void LSPClientContentChangesTest::testDelete()
+{
+    Document doc(QStringLiteral("first\nsecond\nthird\n"));
+    // forward from "first" over the line break, then a selection
+    for (int i = 0; i < 4; ++i) {
+        doc.remove(3, 1);
+    }
+    doc.remove(3, 3);
+    QCOMPARE(doc.changes.size(), 1);
+    QCOMPARE(doc.changes[0].range, LSPRange(0, 3, 1, 4));
+    QCOMPARE(doc.text, QStringLiteral("firnd\nthird\n"));
+    QCOMPARE(doc.merged(), doc.text);
+}
+
+void LSPClientContentChangesTest::testTypeAndErase()
+{
+    Document doc(QStringLiteral("ab\n"));
+    doc.insert(1, QStringLiteral("xyz"));
+    doc.remove(3, 1);
+    doc.insert(3, QStringLiteral("\nw"));
+    doc.remove(4, 1);
+    QCOMPARE(doc.changes.size(), 1);
+    QCOMPARE(doc.changes[0].text, QStringLiteral("xy\n"));
+    QCOMPARE(doc.merged(), doc.text);
+
+    // erasing all that was typed leaves an empty change
+    doc.remove(1, 3);
+    QCOMPARE(doc.changes.size(), 1);
+    QCOMPARE(doc.changes[0].text, QString());
+    QCOMPARE(doc.text, QStringLiteral("ab\n"));
+    QCOMPARE(doc.merged(), doc.text);
+}
+
+void LSPClientContentChangesTest::testNoMerge()
+{
+    Document doc(QStringLiteral("first\nsecond\nthird\n"));
+    // elsewhere in the document
+    doc.insert(2, QStringLiteral("a"));
+    doc.insert(10, QStringLiteral("b"));
+    QCOMPARE(doc.changes.size(), 2);
+    // removal reaching beyond the text just inserted
+    doc.remove(9, 2);
+    QCOMPARE(doc.changes.size(), 3);
+    // insertion where text was removed turns the removal into a replacement
+    doc.insert(9, QStringLiteral("c"));
+    QCOMPARE(doc.changes.size(), 3);
+    QCOMPARE(doc.changes[2].text, QStringLiteral("c"));
+    // removal overlapping a replacement
+    doc.replace(0, 7, QStringLiteral("x\n"));
+    doc.remove(0, 3);
+    QCOMPARE(doc.changes.size(), 5);
+    QCOMPARE(doc.merged(), doc.text);
+}
+
+void LSPClientContentChangesTest::testRandomEdits()
+{
+    // fixed seed, edits mostly continue at the cursor
+    uint seed = 1;
+    const auto random = [&seed](int n) {
+        seed = seed * 1103515245 + 12345;
+        return int((seed >> 16) % uint(n));
+    };
+
+    QString text = QStringLiteral("first line\nsecond\n\nfourth line\n");
+    int edits = 0;
+    int changes = 0;
+    for (int batch = 0; batch < 200; ++batch) {
+        Document doc(text);
+        int cursor = random(text.size() + 1);
+        for (int i = 0; i < 20; ++i) {
+            if (random(4) == 0) {
+                cursor = random(doc.text.size() + 1);
+            }
+            const int count = 1 + random(3);
+            switch (random(5)) {
+            case 0:
+            case 1: {
+                const QString inserted(count, QChar(QLatin1String("ab\n").at(random(3))));
+                doc.insert(cursor, inserted);
+                cursor += count;
+                break;
+            }
+            case 2: {
+                const int removed = std::min(cursor, count);
+                cursor -= removed;
+                doc.remove(cursor, removed);
+                break;
+            }
+            case 3:
+                doc.remove(cursor, std::min(doc.text.size() - cursor, count));
+                break;
+            default:
+                doc.replace(cursor, std::min(doc.text.size() - cursor, count), QStringLiteral("x"));
+                break;
+            }
+            ++edits;
+        }
+        QCOMPARE(doc.merged(), doc.text);
+        changes += doc.changes.size();
+        text = doc.text;
+    }
+    QVERIFY(changes < edits);
+}
+
+void LSPClientContentChangesTest::testExceedsFullText()
+{
+    QList<LSPTextDocumentContentChangeEvent> changes;
+    QVERIFY(!exceedsFullText(changes, 0));
+
+    // each change costs its text and the JSON around it
+    changes.push_back({LSPRange(0, 0, 0, 0), QString(10, QLatin1Char('a'))});
+    QVERIFY(exceedsFullText(changes, 100));
+    QVERIFY(!exceedsFullText(changes, 1000));
+
+    for (int i = 0; i < 9; ++i) {
+        changes.push_back({LSPRange(i + 1, 0, i + 1, 0), QString(10, QLatin1Char('a'))});
+    }
+    QVERIFY(exceedsFullText(changes, 1000));
+    QVERIFY(!exceedsFullText(changes, 2000));
+}
@@ -0,0 +1,28 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTCONTENTCHANGESTEST_H
+#define LSPCLIENTCONTENTCHANGESTEST_H
+
+#include <QObject>
+
+class LSPClientContentChangesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testAdvance();
+    void testTyping();
+    void testBackspace();
+    void testDelete();
+    void testTypeAndErase();
+    void testNoMerge();
+    void testRandomEdits();
+    void testExceedsFullText();
+};
+
+#endif
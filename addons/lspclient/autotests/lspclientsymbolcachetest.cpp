@@ -0,0 +1,137 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientsymbolcachetest.h"
+#include "lspclientsymbolcache.h"
+
+#include <QtTest>
+
+QTEST_GUILESS_MAIN(LSPClientSymbolCacheTest)
+
+static const QUrl documentA(QStringLiteral("file:///a.cpp"));
+static const QUrl documentB(QStringLiteral("file:///b.cpp"));
+
+static LSPWorkspaceSymbol symbol(const QString &name, LSPSymbolKind kind, const QUrl &document, int line, const QString &container = QString())
+{
+    return {name, kind, {document, LSPRange(line, 0, line, name.size())}, container};
+}
+
+static LSPSymbolInformation information(const QString &name, LSPSymbolKind kind, int line)
+{
+    return LSPSymbolInformation(name, kind, LSPRange(line, 0, line, name.size()), QString());
+}
+
+void LSPClientSymbolCacheTest::testAddDeduplicates()
+{
+    LSPClientSymbolCache cache;
+    cache.add({symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentA, 1)});
+    QCOMPARE(cache.size(), 1);
+
+    // same name, kind and start: only the details are updated
+    cache.add({symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentA, 1, QStringLiteral("ns"))});
+    QCOMPARE(cache.size(), 1);
+    auto matches = cache.find(QStringLiteral("foo"), -1);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].symbol.containerName, QStringLiteral("ns"));
+
+    // any other start, kind or document is another symbol
+    cache.add({symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentA, 2),
+               symbol(QStringLiteral("foo"), LSPSymbolKind::Variable, documentA, 1),
+               symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentB, 1)});
+    QCOMPARE(cache.size(), 4);
+    QCOMPARE(cache.find(QStringLiteral("foo"), -1).size(), 4);
+}
+
+void LSPClientSymbolCacheTest::testSetDocument()
+{
+    LSPClientSymbolCache cache;
+    cache.add({symbol(QStringLiteral("stale"), LSPSymbolKind::Function, documentA, 7), symbol(QStringLiteral("other"), LSPSymbolKind::Function, documentB, 1)});
+    QCOMPARE(cache.size(), 2);
+
+    auto outer = information(QStringLiteral("Outer"), LSPSymbolKind::Class, 1);
+    auto inner = information(QStringLiteral("inner"), LSPSymbolKind::Method, 2);
+    inner.children.append(information(QStringLiteral("local"), LSPSymbolKind::Variable, 3));
+    outer.children.append(inner);
+    cache.setDocument(documentA, {outer});
+
+    // the document's symbols are replaced, nested ones flattened, others stay
+    QCOMPARE(cache.size(), 4);
+    QVERIFY(cache.find(QStringLiteral("stale"), -1).isEmpty());
+    QCOMPARE(cache.find(QStringLiteral("other"), -1).size(), 1);
+
+    auto matches = cache.find(QStringLiteral("Outer"), -1);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].symbol.containerName, QString());
+    QCOMPARE(matches[0].symbol.location.uri, documentA);
+
+    matches = cache.find(QStringLiteral("inner"), -1);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].symbol.containerName, QStringLiteral("Outer"));
+    QCOMPARE(matches[0].symbol.kind, LSPSymbolKind::Method);
+    QCOMPARE(matches[0].symbol.location.range.start().line(), 2);
+
+    matches = cache.find(QStringLiteral("local"), -1);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].symbol.containerName, QStringLiteral("inner"));
+
+    // an empty reply leaves nothing of the document
+    cache.setDocument(documentA, {});
+    QCOMPARE(cache.size(), 1);
+    QVERIFY(cache.find(QStringLiteral("inner"), -1).isEmpty());
+}
+
+void LSPClientSymbolCacheTest::testRemoveDocument()
+{
+    LSPClientSymbolCache cache;
+    cache.add({symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentA, 1),
+               symbol(QStringLiteral("bar"), LSPSymbolKind::Function, documentA, 2),
+               symbol(QStringLiteral("baz"), LSPSymbolKind::Function, documentB, 1)});
+    QCOMPARE(cache.size(), 3);
+
+    cache.removeDocument(documentA);
+    QCOMPARE(cache.size(), 1);
+    QVERIFY(cache.find(QStringLiteral("foo"), -1).isEmpty());
+    QCOMPARE(cache.find(QStringLiteral("baz"), -1).size(), 1);
+
+    // unknown or already removed documents change nothing
+    cache.removeDocument(documentA);
+    cache.removeDocument(QUrl(QStringLiteral("file:///c.cpp")));
+    QCOMPARE(cache.size(), 1);
+
+    cache.removeDocument(documentB);
+    QCOMPARE(cache.size(), 0);
+}
+
+void LSPClientSymbolCacheTest::testFind()
+{
+    LSPClientSymbolCache cache;
+    cache.add({symbol(QStringLiteral("xfxoxo"), LSPSymbolKind::Function, documentA, 1),
+               symbol(QStringLiteral("foo"), LSPSymbolKind::Function, documentA, 2),
+               symbol(QStringLiteral("fooBar"), LSPSymbolKind::Function, documentA, 3),
+               symbol(QStringLiteral("bar"), LSPSymbolKind::Function, documentB, 1)});
+
+    QVERIFY(cache.find(QString(), -1).isEmpty());
+
+    // best first, the exact name before longer ones
+    const auto all = cache.find(QStringLiteral("foo"), -1);
+    QCOMPARE(all.size(), 3);
+    QCOMPARE(all[0].symbol.name, QStringLiteral("foo"));
+    for (int i = 1; i < all.size(); ++i) {
+        QVERIFY(all[i - 1].score >= all[i].score);
+    }
+
+    // the cut-off keeps the best ones, in the same order
+    const auto best = cache.find(QStringLiteral("foo"), 2);
+    QCOMPARE(best.size(), 2);
+    for (int i = 0; i < best.size(); ++i) {
+        QCOMPARE(best[i].symbol.name, all[i].symbol.name);
+        QCOMPARE(best[i].score, all[i].score);
+    }
+
+    QVERIFY(cache.find(QStringLiteral("foo"), 0).isEmpty());
+    QCOMPARE(cache.find(QStringLiteral("foo"), 10).size(), 3);
+}
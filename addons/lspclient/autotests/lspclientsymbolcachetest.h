@@ -0,0 +1,24 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTSYMBOLCACHETEST_H
+#define LSPCLIENTSYMBOLCACHETEST_H
+
+#include <QObject>
+
+class LSPClientSymbolCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testAddDeduplicates();
+    void testSetDocument();
+    void testRemoveDocument();
+    void testFind();
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclienttransporttest.h"
+#include "lspclienttransport.h"
+
+#include <QBuffer>
+#include <QtTest>
+
+QTEST_GUILESS_MAIN(LSPClientTransportTest)
+
+static QByteArray message(const QByteArray &payload)
+{
+    return QByteArrayLiteral("Content-Length: ") + QByteArray::number(payload.size()) + QByteArrayLiteral("\r\n\r\n") + payload;
+}
+
+// distinct content, so misplaced bytes show up
+static QByteArray payload(int size, char first)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        data[i] = char(first + i % 26);
+    }
+    return data;
+}
+
+static void append(LSPMessageBuffer &buffer, const QByteArray &data)
+{
+    buffer.append(data.constData(), data.size());
+}
+
+void LSPClientTransportTest::testSplitHeader()
+{
+    LSPMessageBuffer buffer;
+    QByteArray result;
+
+    // every part of the header, including the terminating empty line, may arrive on its own
+    const QList<QByteArray> parts = {"Content-Len", "gth: 5\r", "\nContent-Type: application/vscode-jsonrpc\r\n\r", "\nhel", "lo"};
+    for (const auto &part : parts) {
+        QVERIFY(!buffer.takeMessage(result));
+        append(buffer, part);
+    }
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, QByteArray("hello"));
+    QCOMPARE(buffer.size(), 0);
+
+    // byte by byte
+    const auto data = message("{\"id\":1}");
+    for (int i = 0; i < data.size(); ++i) {
+        QVERIFY(!buffer.takeMessage(result));
+        append(buffer, data.mid(i, 1));
+    }
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, QByteArray("{\"id\":1}"));
+}
+
+void LSPClientTransportTest::testSeveralMessages()
+{
+    LSPMessageBuffer buffer;
+    append(buffer, message("first") + message("second") + message("").left(8));
+
+    QByteArray result;
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, QByteArray("first"));
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, QByteArray("second"));
+    QVERIFY(!buffer.takeMessage(result));
+    QCOMPARE(buffer.size(), 8);
+}
+
+void LSPClientTransportTest::testWraparound()
+{
+    LSPMessageBuffer buffer;
+    QByteArray result;
+
+    // moves the start of the buffered data towards the end of the initial capacity
+    const auto first = payload(40000, 'a');
+    const auto second = payload(40000, 'A');
+    const auto secondMessage = message(second);
+    append(buffer, message(first) + secondMessage.left(10));
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, first);
+
+    // so the rest of the next message wraps around
+    append(buffer, secondMessage.mid(10));
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, second);
+    QCOMPARE(buffer.size(), 0);
+}
+
+void LSPClientTransportTest::testGrowWrapped()
+{
+    LSPMessageBuffer buffer;
+    QByteArray result;
+
+    const auto first = payload(40000, 'a');
+    const auto second = payload(200000, 'A');
+    const auto secondMessage = message(second);
+    append(buffer, message(first) + secondMessage.left(20000));
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, first);
+
+    // wraps around first, then exceeds the capacity
+    append(buffer, secondMessage.mid(20000, 20000));
+    QVERIFY(!buffer.takeMessage(result));
+    append(buffer, secondMessage.mid(40000));
+    QVERIFY(buffer.takeMessage(result));
+    QCOMPARE(result, second);
+}
+
+void LSPClientTransportTest::testReadFrom()
+{
+    QByteArray data;
+    for (int i = 0; i < 100; ++i) {
+        data += message(payload(1000 + i, 'a'));
+    }
+    QBuffer device(&data);
+    QVERIFY(device.open(QIODevice::ReadOnly));
+
+    LSPMessageBuffer buffer;
+    buffer.readFrom(&device);
+    QCOMPARE(buffer.size(), data.size());
+
+    QByteArray result;
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(buffer.takeMessage(result));
+        QCOMPARE(result, payload(1000 + i, 'a'));
+    }
+    QVERIFY(!buffer.takeMessage(result));
+}
@@ -0,0 +1,25 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTTRANSPORTTEST_H
+#define LSPCLIENTTRANSPORTTEST_H
+
+#include <QObject>
+
+class LSPClientTransportTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testSplitHeader();
+    void testSeveralMessages();
+    void testWraparound();
+    void testGrowWrapped();
+    void testReadFrom();
+};
+
+#endif
@@ -20,6 +20,8 @@
 #include <algorithm>
 #include <utility>
 
+#include <kfts_fuzzy_match.h>
+
 // clang-format off
 #define RETURN_CACHED_ICON(name) \
     { \
@@ -94,9 +96,12 @@ struct LSPClientCompletionItem : public LSPCompletionItem {
     int argumentHintDepth = 0;
     QString prefix;
     QString postfix;
+    // see kfts::fuzzy_char_mask
+    quint64 filterMask = 0;
 
     LSPClientCompletionItem(const LSPCompletionItem &item)
         : LSPCompletionItem(item)
+        , filterMask(kfts::fuzzy_char_mask(filterText))
     {
         // transform for later display
         // sigh, remove (leading) whitespace (looking at clangd here)
@@ -127,6 +132,13 @@ static bool compare_match(const LSPCompletionItem &a, const LSPCompletionItem &b
     return a.sortText < b.sortText;
 }
 
+// signature items are not subject to filtering
+static bool accept_match(const LSPClientCompletionItem &item, const QString &pattern, quint64 patternMask)
+{
+    int score = 0;
+    return item.argumentHintDepth > 0 || pattern.isEmpty() || kfts::fuzzy_match(pattern, patternMask, item.filterText, item.filterMask, score);
+}
+
 class LSPClientCompletionImpl : public LSPClientCompletion
 {
     Q_OBJECT
@@ -144,6 +156,19 @@ class LSPClientCompletionImpl : public LSPClientCompletion
     QList<LSPClientCompletionItem> m_matches;
     LSPClientServer::RequestHandle m_handle, m_handleSig;
 
+    // last server result, to narrow down locally while typing the same word
+    struct CompletionCache {
+        QUrl document;
+        KTextEditor::Cursor start = KTextEditor::Cursor::invalid();
+        // text typed when requested, and when last narrowed down
+        QString prefix;
+        QString filter;
+        // all items are known, so typing more only filters them
+        bool complete = false;
+        QList<LSPClientCompletionItem> items;
+    };
+    CompletionCache m_cache;
+
 public:
     LSPClientCompletionImpl(QSharedPointer<LSPClientServerManager> manager)
         : LSPClientCompletion(nullptr)
@@ -236,13 +261,42 @@ public:
 
         qCInfo(LSPCLIENT) << "completion invoked" << m_server;
 
+        auto document = view->document();
+        if (!m_server || !document) {
+            aborted(view);
+            return;
+        }
+
+        // the default range is determined based on a reasonable identifier (word)
+        // which is generally fine and nice, but let's pass actual cursor position
+        // (which may be within this typical range)
+        auto position = view->cursorPosition();
+        auto cursor = qMax(range.start(), qMin(range.end(), position));
+        const auto typed = document->text({range.start(), cursor});
+
+        // still typing the word the server gave all candidates for
+        if (!m_triggerSignature && m_cache.complete && m_cache.document == document->url() && m_cache.start == range.start() && typed.startsWith(m_cache.prefix)) {
+            narrow(typed);
+            return;
+        }
+
+        m_cache.document = document->url();
+        m_cache.start = range.start();
+        m_cache.prefix = typed;
+        m_cache.filter = typed;
+        m_cache.complete = false;
+        m_cache.items.clear();
+
         // maybe use WaitForReset ??
         // but more complex and already looks good anyway
-        auto handler = [this](const QList<LSPCompletionItem> & compl ) {
+        auto handler = [this](const LSPCompletionList &completion) {
             beginResetModel();
-            qCInfo(LSPCLIENT) << "adding completions " << compl .size();
-            for (const auto &item : compl )
-                m_matches.push_back(item);
+            qCInfo(LSPCLIENT) << "adding completions " << completion.items.size() << "incomplete" << completion.isIncomplete;
+            for (const auto &item : completion.items)
+                m_cache.items.push_back(item);
+            std::stable_sort(m_cache.items.begin(), m_cache.items.end(), compare_match);
+            m_cache.complete = !completion.isIncomplete;
+            m_matches.append(m_cache.items);
             std::stable_sort(m_matches.begin(), m_matches.end(), compare_match);
             setRowCount(m_matches.size());
             endResetModel();
@@ -270,23 +324,61 @@ public:
 
         beginResetModel();
         m_matches.clear();
-        auto document = view->document();
-        if (m_server && document) {
-            // the default range is determined based on a reasonable identifier (word)
-            // which is generally fine and nice, but let's pass actual cursor position
-            // (which may be within this typical range)
-            auto position = view->cursorPosition();
-            auto cursor = qMax(range.start(), qMin(range.end(), position));
-            m_manager->update(document, false);
-            if (!m_triggerSignature) {
-                m_handle = m_server->documentCompletion(document->url(), {cursor.line(), cursor.column()}, this, handler);
-            }
-            m_handleSig = m_server->signatureHelp(document->url(), {cursor.line(), cursor.column()}, this, sigHandler);
+        m_manager->update(document, false);
+        if (!m_triggerSignature) {
+            m_handle.cancel() = m_server->documentCompletion(document->url(), {cursor.line(), cursor.column()}, this, handler);
         }
+        m_handleSig.cancel() = m_server->signatureHelp(document->url(), {cursor.line(), cursor.column()}, this, sigHandler);
         setRowCount(m_matches.size());
         endResetModel();
     }
 
+    // filter the cached items by the typed text, without asking the server again
+    void narrow(const QString &typed)
+    {
+        qCInfo(LSPCLIENT) << "narrowing completions to" << typed;
+        const auto mask = kfts::fuzzy_char_mask(typed);
+
+        if (!typed.startsWith(m_cache.filter)) {
+            // text got removed, so matches may come back
+            beginResetModel();
+            m_matches.erase(std::remove_if(m_matches.begin(),
+                                           m_matches.end(),
+                                           [](const LSPClientCompletionItem &item) {
+                                               return item.argumentHintDepth == 0;
+                                           }),
+                            m_matches.end());
+            for (const auto &item : qAsConst(m_cache.items)) {
+                if (accept_match(item, typed, mask)) {
+                    m_matches.push_back(item);
+                }
+            }
+            std::stable_sort(m_matches.begin(), m_matches.end(), compare_match);
+            m_cache.filter = typed;
+            setRowCount(m_matches.size());
+            endResetModel();
+            return;
+        }
+
+        // typing more only drops matches, remove them in runs of rows
+        int row = m_matches.size();
+        while (row > 0) {
+            --row;
+            if (accept_match(m_matches.at(row), typed, mask)) {
+                continue;
+            }
+            const int last = row;
+            while (row > 0 && !accept_match(m_matches.at(row - 1), typed, mask)) {
+                --row;
+            }
+            beginRemoveRows(QModelIndex(), row, last);
+            m_matches.erase(m_matches.begin() + row, m_matches.begin() + last + 1);
+            setRowCount(m_matches.size());
+            endRemoveRows();
+        }
+        m_cache.filter = typed;
+    }
+
     void executeCompletionItem(KTextEditor::View *view, const KTextEditor::Range &word, const QModelIndex &index) const override
     {
         if (index.row() < m_matches.size())
@@ -301,6 +393,7 @@ public:
         m_handle.cancel();
         m_handleSig.cancel();
         m_triggerSignature = false;
+        m_cache = CompletionCache();
         endResetModel();
     }
 };
@@ -70,6 +70,7 @@ LSPClientConfigPage::LSPClientConfigPage(QWidget *parent, LSPClientPlugin *plugi
                            ui->chkOnTypeFormatting,
                            ui->chkIncrementalSync,
                            ui->chkSemanticHighlighting,
+                           ui->chkServerStartOnProjectLoad,
                            ui->chkAutoHover})
         connect(cb, &QCheckBox::toggled, this, &LSPClientConfigPage::changed);
     auto ch = [this](int) { this->changed(); };
@@ -141,6 +142,7 @@ void LSPClientConfigPage::apply()
     m_plugin->m_onTypeFormatting = ui->chkOnTypeFormatting->isChecked();
     m_plugin->m_incrementalSync = ui->chkIncrementalSync->isChecked();
     m_plugin->m_semanticHighlighting = ui->chkSemanticHighlighting->isChecked();
+    m_plugin->m_serverStartOnProjectLoad = ui->chkServerStartOnProjectLoad->isChecked();
 
     m_plugin->m_messages = ui->chkMessages->isChecked();
     m_plugin->m_messagesAutoSwitch = ui->comboMessagesSwitch->currentIndex();
@@ -179,6 +181,7 @@ void LSPClientConfigPage::reset()
     ui->chkOnTypeFormatting->setChecked(m_plugin->m_onTypeFormatting);
     ui->chkIncrementalSync->setChecked(m_plugin->m_incrementalSync);
     ui->chkSemanticHighlighting->setChecked(m_plugin->m_semanticHighlighting);
+    ui->chkServerStartOnProjectLoad->setChecked(m_plugin->m_serverStartOnProjectLoad);
 
     ui->chkMessages->setChecked(m_plugin->m_messages);
     ui->comboMessagesSwitch->setCurrentIndex(m_plugin->m_messagesAutoSwitch);
@@ -0,0 +1,64 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientcontentchanges.h"
+
+// (rough) size of the JSON wrapping a content change's text
+static const int CHANGE_EVENT_OVERHEAD = 100;
+
+LSPPosition advance(const LSPPosition &pos, const QString &text)
+{
+    const int lines = text.count(QLatin1Char('\n'));
+    if (!lines) {
+        return {pos.line(), pos.column() + text.size()};
+    }
+    return {pos.line() + lines, text.size() - text.lastIndexOf(QLatin1Char('\n')) - 1};
+}
+
+void addChange(QList<LSPTextDocumentContentChangeEvent> &changes, const LSPRange &range, const QString &text, const QString &removed)
+{
+    if (!changes.empty()) {
+        auto &last = changes.last();
+        // end of last change's text in current document
+        const auto end = advance(last.range.start(), last.text);
+        if (range.isEmpty()) {
+            if (range.start() == end) {
+                last.text += text;
+                return;
+            }
+        } else if (text.isEmpty() && !removed.isEmpty()) {
+            // removal of (part of) the text that was just inserted
+            if (range.end() == end && last.text.endsWith(removed)) {
+                last.text.chop(removed.size());
+                return;
+            }
+            // removal right before or right after a preceding removal
+            if (last.text.isEmpty()) {
+                if (range.end() == last.range.start()) {
+                    last.range = {range.start(), last.range.end()};
+                    return;
+                } else if (range.start() == last.range.start()) {
+                    last.range = {last.range.start(), advance(last.range.end(), removed)};
+                    return;
+                }
+            }
+        }
+    }
+    changes.push_back({range, text});
+}
+
+bool exceedsFullText(const QList<LSPTextDocumentContentChangeEvent> &changes, int documentSize)
+{
+    int changesSize = 0;
+    for (const auto &change : changes) {
+        changesSize += change.text.size() + CHANGE_EVENT_OVERHEAD;
+        if (changesSize >= documentSize) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,32 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTCONTENTCHANGES_H
+#define LSPCLIENTCONTENTCHANGES_H
+
+#include "lspclientprotocol.h"
+
+#include <QList>
+
+/*
+ * Helpers to collect the edits of a document as incremental
+ * didChange content changes, in the order they are to be applied.
+ */
+
+// position right after text inserted at pos
+LSPPosition advance(const LSPPosition &pos, const QString &text);
+
+// adds an edit (with removed the text it removed, if any) to the pending ones,
+// merging it with the last one if it simply continues that one;
+// so typing, pasting or deleting a stretch of text ends up as a single change
+void addChange(QList<LSPTextDocumentContentChangeEvent> &changes, const LSPRange &range, const QString &text, const QString &removed);
+
+// whether sending changes costs at least as much as the full text
+// of a document with documentSize characters
+bool exceedsFullText(const QList<LSPTextDocumentContentChangeEvent> &changes, int documentSize);
+
+#endif
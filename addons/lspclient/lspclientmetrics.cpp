@@ -0,0 +1,94 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientmetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+enum {
+    // round trip times kept per method
+    MaxLatencySamples = 1000
+};
+
+qint64 LSPClientMetrics::Method::latency(int p) const
+{
+    if (latencies.empty())
+        return -1;
+
+    // nearest rank
+    auto samples = latencies;
+    const int rank = int(std::ceil(p / 100.0 * samples.size()));
+    const auto nth = samples.begin() + qBound(0, rank - 1, samples.size() - 1);
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+void LSPClientMetrics::requestSent(const QString &method, qint64 bytes)
+{
+    auto &m = m_methods[method];
+    ++m.requests;
+    m.bytesOut += bytes;
+}
+
+void LSPClientMetrics::requestCancelled(const QString &method)
+{
+    ++m_methods[method].cancelled;
+}
+
+void LSPClientMetrics::replyReceived(const QString &method, qint64 bytes, qint64 latency, qint64 decodeTime, qint64 handlerTime, bool error)
+{
+    auto &m = m_methods[method];
+    m.errors += error ? 1 : 0;
+    m.bytesIn += bytes;
+    m.decodeTime += decodeTime;
+    m.handlerTime += handlerTime;
+    if (m.latencies.size() < MaxLatencySamples) {
+        m.latencies.push_back(latency);
+    } else {
+        m.latencies[m.nextLatency] = latency;
+        m.nextLatency = (m.nextLatency + 1) % MaxLatencySamples;
+    }
+}
+
+void LSPClientMetrics::notificationSent(const QString &method, qint64 bytes)
+{
+    auto &m = m_methods[method];
+    ++m.notifications;
+    m.bytesOut += bytes;
+}
+
+void LSPClientMetrics::notificationReceived(const QString &method, qint64 bytes, qint64 decodeTime, qint64 handlerTime)
+{
+    auto &m = m_methods[method];
+    ++m.notifications;
+    m.bytesIn += bytes;
+    m.decodeTime += decodeTime;
+    m.handlerTime += handlerTime;
+}
+
+QJsonObject LSPClientMetrics::toJson() const
+{
+    QJsonObject result;
+    for (auto it = m_methods.begin(); it != m_methods.end(); ++it) {
+        const auto &m = it.value();
+        QJsonObject latency {{QStringLiteral("samples"), m.latencies.size()},
+                             {QStringLiteral("p50"), m.latency(50)},
+                             {QStringLiteral("p95"), m.latency(95)},
+                             {QStringLiteral("p99"), m.latency(99)}};
+        result[it.key()] = QJsonObject {{QStringLiteral("requests"), m.requests},
+                                        {QStringLiteral("notifications"), m.notifications},
+                                        {QStringLiteral("cancelled"), m.cancelled},
+                                        {QStringLiteral("errors"), m.errors},
+                                        {QStringLiteral("bytesOut"), m.bytesOut},
+                                        {QStringLiteral("bytesIn"), m.bytesIn},
+                                        {QStringLiteral("decodeTime"), m.decodeTime},
+                                        {QStringLiteral("handlerTime"), m.handlerTime},
+                                        {QStringLiteral("latency"), latency}};
+    }
+    return result;
+}
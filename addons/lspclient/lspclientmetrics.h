@@ -0,0 +1,70 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTMETRICS_H
+#define LSPCLIENTMETRICS_H
+
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+/*
+ * Traffic and timing of the messages exchanged with a server, per method.
+ * Times are in microseconds; round trip times are kept for the most recent
+ * requests only, enough for percentiles without growing unbounded.
+ */
+class LSPClientMetrics
+{
+public:
+    struct Method {
+        // requests sent, and notifications sent or received
+        int requests = 0;
+        int notifications = 0;
+        // requests cancelled, either before or after being sent
+        int cancelled = 0;
+        // replies carrying an error
+        int errors = 0;
+        qint64 bytesOut = 0;
+        qint64 bytesIn = 0;
+        // json parsing and conversion
+        qint64 decodeTime = 0;
+        // running the reply handler or emitting the notification
+        qint64 handlerTime = 0;
+        // ring of recent round trip times
+        QVector<qint64> latencies;
+        int nextLatency = 0;
+
+        // p-th percentile (0 - 100) of the recent round trip times, -1 if none
+        qint64 latency(int p) const;
+    };
+
+    void requestSent(const QString &method, qint64 bytes);
+    void requestCancelled(const QString &method);
+    void replyReceived(const QString &method, qint64 bytes, qint64 latency, qint64 decodeTime, qint64 handlerTime, bool error);
+
+    void notificationSent(const QString &method, qint64 bytes);
+    void notificationReceived(const QString &method, qint64 bytes, qint64 decodeTime, qint64 handlerTime);
+
+    const QMap<QString, Method> &methods() const
+    {
+        return m_methods;
+    }
+
+    void clear()
+    {
+        m_methods.clear();
+    }
+
+    // method -> metrics
+    QJsonObject toJson() const;
+
+private:
+    QMap<QString, Method> m_methods;
+};
+
+#endif
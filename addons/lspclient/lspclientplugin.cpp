@@ -8,6 +8,7 @@
 #include "lspclientplugin.h"
 #include "lspclientconfigpage.h"
 #include "lspclientpluginview.h"
+#include "lspclientservermanager.h"
 
 #include "lspclient_debug.h"
 
@@ -38,6 +39,7 @@ static const QString CONFIG_MESSAGES {QStringLiteral("Messages")};
 static const QString CONFIG_MESSAGES_AUTO_SWITCH {QStringLiteral("MessagesAutoSwitch")};
 static const QString CONFIG_SERVER_CONFIG {QStringLiteral("ServerConfiguration")};
 static const QString CONFIG_SEMANTIC_HIGHLIGHTING {QStringLiteral("SemanticHighlighting")};
+static const QString CONFIG_SERVER_START_ON_PROJECT_LOAD {QStringLiteral("ServerStartOnProjectLoad")};
 
 K_PLUGIN_FACTORY_WITH_JSON(LSPClientPluginFactory, "lspclientplugin.json", registerPlugin<LSPClientPlugin>();)
 
@@ -72,6 +74,16 @@ QObject *LSPClientPlugin::createView(KTextEditor::MainWindow *mainWindow)
     return LSPClientPluginView::new_(this, mainWindow);
 }
 
+QSharedPointer<LSPClientServerManager> LSPClientPlugin::serverManager()
+{
+    auto manager = m_serverManager.toStrongRef();
+    if (!manager) {
+        manager = LSPClientServerManager::new_(this);
+        m_serverManager = manager;
+    }
+    return manager;
+}
+
 int LSPClientPlugin::configPages() const
 {
     return 1;
@@ -107,6 +119,7 @@ void LSPClientPlugin::readConfig()
     m_messagesAutoSwitch = config.readEntry(CONFIG_MESSAGES_AUTO_SWITCH, 1);
     m_configPath = config.readEntry(CONFIG_SERVER_CONFIG, QUrl());
     m_semanticHighlighting = config.readEntry(CONFIG_SEMANTIC_HIGHLIGHTING, false);
+    m_serverStartOnProjectLoad = config.readEntry(CONFIG_SERVER_START_ON_PROJECT_LOAD, false);
 
     emit update();
 }
@@ -132,6 +145,7 @@ void LSPClientPlugin::writeConfig() const
     config.writeEntry(CONFIG_MESSAGES_AUTO_SWITCH, m_messagesAutoSwitch);
     config.writeEntry(CONFIG_SERVER_CONFIG, m_configPath);
     config.writeEntry(CONFIG_SEMANTIC_HIGHLIGHTING, m_semanticHighlighting);
+    config.writeEntry(CONFIG_SERVER_START_ON_PROJECT_LOAD, m_serverStartOnProjectLoad);
 
     emit update();
 }
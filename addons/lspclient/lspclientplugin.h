@@ -9,11 +9,14 @@
 #define LSPCLIENTPLUGIN_H
 
 #include <QMap>
+#include <QSharedPointer>
 #include <QUrl>
 #include <QVariant>
 
 #include <KTextEditor/Plugin>
 
+class LSPClientServerManager;
+
 class LSPClientPlugin : public KTextEditor::Plugin
 {
     Q_OBJECT
@@ -24,6 +27,10 @@ public:
 
     QObject *createView(KTextEditor::MainWindow *mainWindow) override;
 
+    // servers are shared by all main windows,
+    // and shut down once the last window (holding on to them) is gone
+    QSharedPointer<LSPClientServerManager> serverManager();
+
     int configPages() const override;
     KTextEditor::ConfigPage *configPage(int number = 0, QWidget *parent = nullptr) override;
 
@@ -55,6 +62,7 @@ public:
     bool m_incrementalSync = false;
     QUrl m_configPath;
     bool m_semanticHighlighting = false;
+    bool m_serverStartOnProjectLoad = false;
 
     // debug mode?
     bool m_debugMode = false;
@@ -66,6 +74,8 @@ public:
     }
 
 private:
+    QWeakPointer<LSPClientServerManager> m_serverManager;
+
 Q_SIGNALS:
     // signal settings update
     void update() const;
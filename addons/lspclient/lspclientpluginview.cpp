@@ -9,8 +9,10 @@
 #include "lspclientcompletion.h"
 #include "lspclienthover.h"
 #include "lspclientplugin.h"
+#include "lspclientsemanticranges.h"
 #include "lspclientservermanager.h"
 #include "lspclientsymbolview.h"
+#include "lspclientworkspacesymbols.h"
 
 #include "lspclient_debug.h"
 
@@ -35,23 +37,34 @@
 #include <ktexteditor/movingrange.h>
 #include <ktexteditor_version.h>
 
+#include <QAbstractItemModel>
 #include <QAction>
 #include <QApplication>
 #include <QDateTime>
+#include <QFileDialog>
 #include <QFileInfo>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QInputDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QKeyEvent>
+#include <QLocale>
 #include <QMenu>
 #include <QPlainTextEdit>
+#include <QScrollBar>
 #include <QSet>
 #include <QStandardItem>
+#include <QStandardItemModel>
 #include <QTextCodec>
 #include <QTimer>
 #include <QTreeView>
+#include <algorithm>
+#include <iterator>
+#include <memory>
 #include <utility>
+#include <vector>
 
 namespace RangeData
 {
@@ -189,6 +202,330 @@ public:
     }
 };
 
+// compact model for the diagnostics tree;
+// file -> diagnostic -> related information and code actions
+// only the diagnostics are stored, whereas display and role data is
+// produced on demand for the (visible) rows the view asks for
+class LSPClientDiagnosticsModel : public QAbstractItemModel
+{
+public:
+    // a node is the parent of the rows it contains,
+    // so an index refers to its parent node (none for top level files)
+    struct Node {
+        Node *parent = nullptr;
+        int row = 0;
+    };
+
+    struct CodeAction {
+        LSPCodeAction action;
+        QSharedPointer<LSPClientRevisionSnapshot> snapshot;
+    };
+
+    struct Diagnostic : public Node {
+        LSPDiagnostic diagnostic;
+        // child rows; related information first, then code actions
+        QVector<CodeAction> codeActions;
+        bool codeActionsAdded = false;
+    };
+
+    struct File : public Node {
+        QUrl url;
+        std::vector<std::unique_ptr<Diagnostic>> diagnostics;
+    };
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override
+    {
+        if (column != 0 || row < 0 || row >= rowCount(parent))
+            return QModelIndex();
+        return createIndex(row, column, parent.isValid() ? node(parent) : nullptr);
+    }
+
+    QModelIndex parent(const QModelIndex &child) const override
+    {
+        auto p = child.isValid() ? static_cast<Node *>(child.internalPointer()) : nullptr;
+        return p ? createIndex(p->row, 0, p->parent) : QModelIndex();
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        if (!parent.isValid())
+            return int(m_files.size());
+        if (parent.column() != 0)
+            return 0;
+        if (auto file = fileAt(parent))
+            return int(file->diagnostics.size());
+        if (auto diag = diagnosticAt(parent))
+            return diag->diagnostic.relatedInformation.size() + diag->codeActions.size();
+        return 0;
+    }
+
+    int columnCount(const QModelIndex &) const override
+    {
+        return 1;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (!index.isValid())
+            return QVariant();
+
+        if (auto file = fileAt(index)) {
+            return role == Qt::DisplayRole ? QVariant(file->url.toLocalFile()) : QVariant();
+        }
+
+        if (auto diag = diagnosticAt(index)) {
+            const auto &d = diag->diagnostic;
+            switch (role) {
+            case Qt::DisplayRole:
+                return d.source.length() ? QStringLiteral("[%1] %2").arg(d.source, d.message) : d.message;
+            case Qt::DecorationRole:
+                return diagnosticsIcon(d.severity);
+            case Qt::UserRole:
+                return diag->codeActionsAdded;
+            case RangeData::FileUrlRole:
+                return static_cast<const File *>(diag->parent)->url;
+            case RangeData::RangeRole:
+                return QVariant::fromValue<LSPRange>(d.range);
+            case RangeData::KindRole:
+                return static_cast<int>(RangeData::KindEnum(d.severity));
+            }
+            return QVariant();
+        }
+
+        auto parent = static_cast<const Diagnostic *>(index.internalPointer());
+        const auto &relatedInfo = parent->diagnostic.relatedInformation;
+        if (index.row() < relatedInfo.size()) {
+            const auto &related = relatedInfo.at(index.row());
+            switch (role) {
+            case Qt::DisplayRole: {
+                auto basename = QFileInfo(related.location.uri.toLocalFile()).fileName();
+                auto location = QStringLiteral("%1:%2").arg(basename).arg(related.location.range.start().line());
+                return QStringLiteral("[%1] %2").arg(location, related.message);
+            }
+            case Qt::DecorationRole:
+                return diagnosticsIcon(LSPDiagnosticSeverity::Information);
+            case RangeData::FileUrlRole:
+                return related.location.uri;
+            case RangeData::RangeRole:
+                return QVariant::fromValue<LSPRange>(related.location.range);
+            case RangeData::KindRole:
+                return static_cast<int>(RangeData::KindEnum::Related);
+            }
+            return QVariant();
+        }
+
+        const auto &action = parent->codeActions.at(index.row() - relatedInfo.size()).action;
+        switch (role) {
+        case Qt::DisplayRole:
+            return action.kind.size() ? QStringLiteral("[%1] %2").arg(action.kind, action.title) : action.title;
+        case Qt::DecorationRole:
+            return codeActionIcon();
+        }
+        return QVariant();
+    }
+
+    const std::vector<std::unique_ptr<File>> &files() const
+    {
+        return m_files;
+    }
+
+    const File *file(const QUrl &url) const
+    {
+        return m_index.value(url);
+    }
+
+    QModelIndex fileIndex(const QUrl &url) const
+    {
+        auto file = m_index.value(url);
+        return file ? createIndex(file->row, 0, nullptr) : QModelIndex();
+    }
+
+    // diagnostic of file item at pos (or only its line)
+    QModelIndex diagnosticIndex(const QModelIndex &fileIndex, KTextEditor::Cursor pos, bool onlyLine) const
+    {
+        auto file = fileAt(fileIndex);
+        if (!file)
+            return QModelIndex();
+        for (const auto &diag : file->diagnostics) {
+            const auto &range = diag->diagnostic.range;
+            if ((onlyLine && pos.line() == range.start().line()) || (range.contains(pos))) {
+                return createIndex(diag->row, 0, diag->parent);
+            }
+        }
+        return QModelIndex();
+    }
+
+    const Diagnostic *diagnosticAt(const QModelIndex &index) const
+    {
+        return diagnosticNode(index);
+    }
+
+    CodeAction *codeActionAt(const QModelIndex &index)
+    {
+        auto p = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+        if (!p || !p->parent)
+            return nullptr;
+        auto diag = static_cast<Diagnostic *>(p);
+        int i = index.row() - diag->diagnostic.relatedInformation.size();
+        return i >= 0 ? &diag->codeActions[i] : nullptr;
+    }
+
+    // replace diagnostics of url, only the rows that actually differ are replaced;
+    // returns whether anything changed
+    bool setDiagnostics(const QUrl &url, QList<LSPDiagnostic> diagnostics)
+    {
+        // related information without location is of no use
+        for (auto &diag : diagnostics) {
+            auto &relatedInfo = diag.relatedInformation;
+            relatedInfo.erase(std::remove_if(relatedInfo.begin(),
+                                             relatedInfo.end(),
+                                             [](const LSPDiagnosticRelatedInformation &related) {
+                                                 return related.location.uri.isEmpty();
+                                             }),
+                              relatedInfo.end());
+        }
+
+        auto file = m_index.value(url);
+        if (!file) {
+            // no need to create an empty one
+            if (diagnostics.empty())
+                return false;
+            const int row = int(m_files.size());
+            beginInsertRows(QModelIndex(), row, row);
+            std::unique_ptr<File> f(new File);
+            f->row = row;
+            f->url = url;
+            file = f.get();
+            m_files.push_back(std::move(f));
+            m_index.insert(url, file);
+            endInsertRows();
+        } else if (diagnostics.empty()) {
+            removeFile(file);
+            return true;
+        }
+
+        // skip the unchanged rows at either end
+        auto &current = file->diagnostics;
+        const int oldCount = int(current.size());
+        const int newCount = diagnostics.size();
+        int first = 0;
+        while (first < oldCount && first < newCount && sameDiagnostic(current[first]->diagnostic, diagnostics.at(first)))
+            ++first;
+        int last = 0;
+        while (last < oldCount - first && last < newCount - first
+               && sameDiagnostic(current[oldCount - 1 - last]->diagnostic, diagnostics.at(newCount - 1 - last)))
+            ++last;
+        if (first == oldCount && first == newCount)
+            return false;
+
+        const auto parent = createIndex(file->row, 0, nullptr);
+        if (oldCount - last > first) {
+            beginRemoveRows(parent, first, oldCount - last - 1);
+            current.erase(current.begin() + first, current.begin() + (oldCount - last));
+            renumber(file->diagnostics, first);
+            endRemoveRows();
+        }
+        if (newCount - last > first) {
+            beginInsertRows(parent, first, newCount - last - 1);
+            std::vector<std::unique_ptr<Diagnostic>> added;
+            added.reserve(newCount - last - first);
+            for (int i = first; i < newCount - last; ++i) {
+                std::unique_ptr<Diagnostic> diag(new Diagnostic);
+                diag->parent = file;
+                diag->diagnostic = diagnostics.at(i);
+                added.push_back(std::move(diag));
+            }
+            current.insert(current.begin() + first, std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+            renumber(file->diagnostics, first);
+            endInsertRows();
+        }
+        return true;
+    }
+
+    // remove diagnostics of all files not in urls
+    void retainFiles(const QSet<QUrl> &urls)
+    {
+        for (int i = int(m_files.size()) - 1; i >= 0; --i) {
+            if (!urls.contains(m_files[i]->url)) {
+                removeFile(m_files[i].get());
+            }
+        }
+    }
+
+    void addCodeActions(const QModelIndex &index, const QList<LSPCodeAction> &actions, const QSharedPointer<LSPClientRevisionSnapshot> &snapshot)
+    {
+        auto diag = diagnosticNode(index);
+        if (!diag)
+            return;
+        if (actions.size()) {
+            const int row = rowCount(index);
+            beginInsertRows(index, row, row + actions.size() - 1);
+            for (const auto &action : actions) {
+                diag->codeActions.push_back({action, snapshot});
+            }
+            endInsertRows();
+        }
+        diag->codeActionsAdded = true;
+        emit dataChanged(index, index, {Qt::UserRole});
+    }
+
+private:
+    File *fileAt(const QModelIndex &index) const
+    {
+        return index.isValid() && !index.internalPointer() ? m_files[index.row()].get() : nullptr;
+    }
+
+    Diagnostic *diagnosticNode(const QModelIndex &index) const
+    {
+        auto p = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+        return p && !p->parent ? static_cast<File *>(p)->diagnostics[index.row()].get() : nullptr;
+    }
+
+    // node that holds the rows below index
+    Node *node(const QModelIndex &index) const
+    {
+        if (auto file = fileAt(index))
+            return file;
+        return diagnosticNode(index);
+    }
+
+    template<typename T>
+    static void renumber(const std::vector<std::unique_ptr<T>> &nodes, int from)
+    {
+        for (int i = from; i < int(nodes.size()); ++i) {
+            nodes[i]->row = i;
+        }
+    }
+
+    static bool sameDiagnostic(const LSPDiagnostic &a, const LSPDiagnostic &b)
+    {
+        if (a.range != b.range || a.severity != b.severity || a.code != b.code || a.source != b.source || a.message != b.message)
+            return false;
+        if (a.relatedInformation.size() != b.relatedInformation.size())
+            return false;
+        for (int i = 0; i < a.relatedInformation.size(); ++i) {
+            const auto &ra = a.relatedInformation.at(i);
+            const auto &rb = b.relatedInformation.at(i);
+            if (ra.location.uri != rb.location.uri || ra.location.range != rb.location.range || ra.message != rb.message)
+                return false;
+        }
+        return true;
+    }
+
+    void removeFile(File *file)
+    {
+        const int row = file->row;
+        beginRemoveRows(QModelIndex(), row, row);
+        m_index.remove(file->url);
+        m_files.erase(m_files.begin() + row);
+        renumber(m_files, row);
+        endRemoveRows();
+    }
+
+    std::vector<std::unique_ptr<File>> m_files;
+    QHash<QUrl, File *> m_index;
+};
+
 
 /**
  * @brief This is just a helper class that provides "underline" on Ctrl + click
@@ -276,6 +613,86 @@ private:
     KTextEditor::Range range;
 };
 
+// highlighting for semantic token types, cf. the LSP specification
+// TODO: make schema attributes accessible via some new interface,
+// or at least add configuration to the lsp plugin config
+// FIXME: static attributes break if one e.g. switches the color scheme on the fly!
+static KTextEditor::Attribute::Ptr semanticTokenAttribute(const QString &type, KTextEditor::View *view)
+{
+    struct Style {
+        KTextEditor::DefaultStyle style;
+        Qt::GlobalColor color;
+        bool italic;
+    };
+    static const QHash<QString, Style> styles = {
+        {QStringLiteral("method"), {KTextEditor::dsFunction, Qt::darkYellow, true}},
+        {QStringLiteral("function"), {KTextEditor::dsFunction, Qt::darkYellow, false}},
+        {QStringLiteral("variable"), {KTextEditor::dsVariable, Qt::darkCyan, false}},
+        {QStringLiteral("parameter"), {KTextEditor::dsVariable, Qt::darkCyan, false}},
+        {QStringLiteral("property"), {KTextEditor::dsVariable, Qt::darkCyan, true}},
+        {QStringLiteral("enum"), {KTextEditor::dsConstant, Qt::darkMagenta, false}},
+        {QStringLiteral("enumMember"), {KTextEditor::dsConstant, Qt::darkMagenta, true}},
+        {QStringLiteral("class"), {KTextEditor::dsDataType, Qt::darkMagenta, false}},
+        {QStringLiteral("struct"), {KTextEditor::dsDataType, Qt::darkMagenta, false}},
+        {QStringLiteral("interface"), {KTextEditor::dsDataType, Qt::darkMagenta, false}},
+        {QStringLiteral("type"), {KTextEditor::dsDataType, Qt::darkMagenta, false}},
+        {QStringLiteral("typeParameter"), {KTextEditor::dsDataType, Qt::darkMagenta, false}},
+        {QStringLiteral("namespace"), {KTextEditor::dsDataType, Qt::darkGreen, true}},
+    };
+    static QHash<QString, KTextEditor::Attribute::Ptr> attributes;
+
+    auto it = attributes.find(type);
+    if (it == attributes.end()) {
+        KTextEditor::Attribute::Ptr attr;
+        auto style = styles.find(type);
+        if (style != styles.end()) {
+            attr = view->defaultStyleAttribute(style->style);
+            attr.detach();
+            attr->setForeground(style->color);
+            if (style->italic) {
+                attr->setFontItalic(true);
+            }
+        }
+        it = attributes.insert(type, attr);
+    }
+    return *it;
+}
+
+// apply the edits of a semantic tokens delta, false if they do not fit
+static bool applySemanticTokensEdits(QVector<quint32> &data, QVector<LSPSemanticTokensEdit> edits)
+{
+    std::sort(edits.begin(), edits.end(), [](const LSPSemanticTokensEdit &a, const LSPSemanticTokensEdit &b) {
+        return a.start < b.start;
+    });
+
+    // edits refer to the old data, so build the new data in one pass
+    QVector<quint32> result;
+    result.reserve(data.size());
+    int pos = 0;
+    for (const auto &edit : qAsConst(edits)) {
+        if (edit.start < pos || edit.deleteCount < 0 || edit.start + edit.deleteCount > data.size()) {
+            return false;
+        }
+        std::copy(data.constBegin() + pos, data.constBegin() + edit.start, std::back_inserter(result));
+        result += edit.data;
+        pos = edit.start + edit.deleteCount;
+    }
+    std::copy(data.constBegin() + pos, data.constEnd(), std::back_inserter(result));
+    data.swap(result);
+    return true;
+}
+
+// lines currently shown by view
+static KTextEditor::Range visibleRange(KTextEditor::View *view)
+{
+    const auto top = view->coordinatesToCursor(QPoint(0, 0));
+    const auto bottom = view->coordinatesToCursor(QPoint(0, view->height() - 1));
+    // e.g. below the end of the document, where there is no cursor
+    const int first = top.isValid() ? top.line() : view->firstDisplayedLine();
+    const int last = bottom.isValid() ? bottom.line() : view->lastDisplayedLine();
+    return KTextEditor::Range(first, 0, last, view->document()->lineLength(last));
+}
+
 class LSPClientActionView : public QObject
 {
     Q_OBJECT
@@ -291,11 +708,14 @@ class LSPClientActionView : public QObject
     QScopedPointer<LSPClientHover> m_hover;
     QScopedPointer<KTextEditor::TextHintProvider> m_forwardHover;
     QScopedPointer<QObject> m_symbolView;
+    // created on first use, lives in the main window
+    QPointer<LSPClientWorkspaceSymbols> m_workspaceSymbols;
 
     QPointer<QAction> m_findDef;
     QPointer<QAction> m_findDecl;
     QPointer<QAction> m_findRef;
     QPointer<QAction> m_findImpl;
+    QPointer<QAction> m_findWorkspaceSymbol;
     QPointer<QAction> m_triggerHighlight;
     QPointer<QAction> m_triggerSymbolInfo;
     QPointer<QAction> m_triggerFormat;
@@ -314,6 +734,7 @@ class LSPClientActionView : public QObject
     QPointer<KSelectAction> m_messagesAutoSwitch;
     QPointer<QAction> m_messagesSwitch;
     QPointer<QAction> m_closeDynamic;
+    QPointer<QAction> m_showMetrics;
     QPointer<QAction> m_restartServer;
     QPointer<QAction> m_restartAll;
 
@@ -323,7 +744,23 @@ class LSPClientActionView : public QObject
     // applied search ranges
     typedef QMultiHash<KTextEditor::Document *, KTextEditor::MovingRange *> RangeCollection;
     RangeCollection m_ranges;
-    QHash<KTextEditor::Document *, QHash<int, QVector<KTextEditor::MovingRange *>>> m_semanticHighlightRanges;
+    QHash<KTextEditor::Document *, QSharedPointer<LSPClientSemanticRanges>> m_semanticHighlightRanges;
+    // semantic tokens of a document, as last sent by the server
+    struct SemanticTokens {
+        QString resultId;
+        QVector<quint32> data;
+        LSPClientServer::RequestHandle handle;
+        LSPClientServer::RequestHandle rangeHandle;
+    };
+    QHash<KTextEditor::Document *, SemanticTokens> m_semanticTokens;
+    // attribute per token type of the legend of a server
+    struct SemanticTokenAttributes {
+        QPointer<LSPClientServer> server;
+        QVector<KTextEditor::Attribute::Ptr> attributes;
+    };
+    QHash<LSPClientServer *, SemanticTokenAttributes> m_semanticTokenAttributes;
+    // semantic tokens are requested once typing pauses
+    QTimer m_semanticTokensTimer;
     // applied marks
     typedef QSet<KTextEditor::Document *> DocumentCollection;
     DocumentCollection m_marks;
@@ -342,7 +779,15 @@ class LSPClientActionView : public QObject
     QPointer<QTreeView> m_diagnosticsTree;
     // tree widget is either owned here or by tab
     QScopedPointer<QTreeView> m_diagnosticsTreeOwn;
-    QScopedPointer<QStandardItemModel> m_diagnosticsModel;
+    QScopedPointer<LSPClientDiagnosticsModel> m_diagnosticsModel;
+    // diagnostics as last published, not yet applied
+    QHash<QUrl, QList<LSPDiagnostic>> m_pendingDiagnostics;
+    // servers may publish for many documents in a burst,
+    // so these are applied in one go rather than one by one
+    QTimer m_diagnosticsTimer;
+    // metrics tab, refreshed while shown
+    QPointer<QTreeView> m_metricsTree;
+    QTimer m_metricsTimer;
     // diagnostics ranges
     RangeCollection m_diagnosticsRanges;
     // and marks
@@ -412,6 +857,17 @@ public:
         connect(m_serverManager.data(), &LSPClientServerManager::serverChanged, this, &self_type::updateState);
         connect(m_serverManager.data(), &LSPClientServerManager::showMessage, this, &self_type::onShowMessage);
 
+        m_semanticTokensTimer.setSingleShot(true);
+        m_semanticTokensTimer.setInterval(500);
+        connect(&m_semanticTokensTimer, &QTimer::timeout, this, &self_type::requestSemanticTokens);
+
+        m_diagnosticsTimer.setSingleShot(true);
+        m_diagnosticsTimer.setInterval(16);
+        connect(&m_diagnosticsTimer, &QTimer::timeout, this, &self_type::processDiagnostics);
+
+        m_metricsTimer.setInterval(1000);
+        connect(&m_metricsTimer, &QTimer::timeout, this, &self_type::updateMetrics);
+
         m_findDef = actionCollection()->addAction(QStringLiteral("lspclient_find_definition"), this, &self_type::goToDefinition);
         m_findDef->setText(i18n("Go to Definition"));
         m_findDecl = actionCollection()->addAction(QStringLiteral("lspclient_find_declaration"), this, &self_type::goToDeclaration);
@@ -420,6 +876,8 @@ public:
         m_findRef->setText(i18n("Find References"));
         m_findImpl = actionCollection()->addAction(QStringLiteral("lspclient_find_implementations"), this, &self_type::findImplementation);
         m_findImpl->setText(i18n("Find Implementations"));
+        m_findWorkspaceSymbol = actionCollection()->addAction(QStringLiteral("lspclient_workspace_symbol"), this, &self_type::findWorkspaceSymbol);
+        m_findWorkspaceSymbol->setText(i18n("Go to Workspace Symbol..."));
         m_triggerHighlight = actionCollection()->addAction(QStringLiteral("lspclient_highlight"), this, &self_type::highlight);
         m_triggerHighlight->setText(i18n("Highlight"));
         m_triggerSymbolInfo = actionCollection()->addAction(QStringLiteral("lspclient_symbol_info"), this, &self_type::symbolInfo);
@@ -442,7 +900,7 @@ public:
         m_onTypeFormatting = actionCollection()->addAction(QStringLiteral("lspclient_type_formatting"), this, &self_type::displayOptionChanged);
         m_onTypeFormatting->setText(i18n("Format on typing"));
         m_onTypeFormatting->setCheckable(true);
-        m_incrementalSync = actionCollection()->addAction(QStringLiteral("lspclient_incremental_sync"), this, &self_type::displayOptionChanged);
+        m_incrementalSync = actionCollection()->addAction(QStringLiteral("lspclient_incremental_sync"), this, &self_type::incrementalSyncChanged);
         m_incrementalSync->setText(i18n("Incremental document synchronization"));
         m_incrementalSync->setCheckable(true);
 
@@ -476,6 +934,8 @@ public:
         // server control and misc actions
         m_closeDynamic = actionCollection()->addAction(QStringLiteral("lspclient_close_dynamic"), this, &self_type::closeDynamic);
         m_closeDynamic->setText(i18n("Close all dynamic reference tabs"));
+        m_showMetrics = actionCollection()->addAction(QStringLiteral("lspclient_show_metrics"), this, &self_type::showMetrics);
+        m_showMetrics->setText(i18n("Show server metrics"));
         m_restartServer = actionCollection()->addAction(QStringLiteral("lspclient_restart_server"), this, &self_type::restartCurrent);
         m_restartServer->setText(i18n("Restart LSP Server"));
         m_restartAll = actionCollection()->addAction(QStringLiteral("lspclient_restart_all"), this, &self_type::restartAll);
@@ -488,6 +948,7 @@ public:
         menu->addAction(m_findDecl);
         menu->addAction(m_findRef);
         menu->addAction(m_findImpl);
+        menu->addAction(m_findWorkspaceSymbol);
         menu->addAction(m_triggerHighlight);
         menu->addAction(m_triggerSymbolInfo);
         menu->addAction(m_triggerFormat);
@@ -496,6 +957,7 @@ public:
         menu->addAction(m_diagnosticsSwitch);
         menu->addAction(m_messagesSwitch);
         menu->addAction(m_closeDynamic);
+        menu->addAction(m_showMetrics);
         menu->addSeparator();
         menu->addAction(m_restartServer);
         menu->addAction(m_restartAll);
@@ -537,14 +999,15 @@ public:
 
         // MOD
         m_diagnosticsTree->setAlternatingRowColors(false);
+        // there may be quite some diagnostics, so spare the view from measuring each row
+        m_diagnosticsTree->setUniformRowHeights(true);
 
 
 
 
         
         m_diagnosticsTreeOwn.reset(m_diagnosticsTree);
-        m_diagnosticsModel.reset(new QStandardItemModel());
-        m_diagnosticsModel->setColumnCount(1);
+        m_diagnosticsModel.reset(new LSPClientDiagnosticsModel());
         m_diagnosticsTree->setModel(m_diagnosticsModel.data());
         configureTreeView(m_diagnosticsTree);
         connect(m_diagnosticsTree, &QTreeView::clicked, this, &self_type::goToItemLocation);
@@ -670,6 +1133,9 @@ public:
 
         clearAllLocationMarks();
         clearAllDiagnosticsMarks();
+
+        // lives in the main window
+        delete m_workspaceSymbols;
     }
 
     void configureTreeView(QTreeView *treeView)
@@ -716,10 +1182,19 @@ public:
             m_tabWidget->removeTab(diagnosticsIndex);
         }
         m_diagnosticsSwitch->setEnabled(m_diagnostics->isChecked());
-        m_serverManager->setIncrementalSync(m_incrementalSync->isChecked());
+        // marks are added again as needed with the new options
+        clearAllDiagnosticsMarks();
         updateState();
     }
 
+    void incrementalSyncChanged()
+    {
+        // applies to the servers shared by all windows, so to all of them
+        // (their actions follow along as the config is updated)
+        m_plugin->m_incrementalSync = m_incrementalSync->isChecked();
+        m_plugin->writeConfig();
+    }
+
     void configUpdated()
     {
         if (m_complDocOn)
@@ -810,6 +1285,14 @@ public:
     void addMarks(KTextEditor::Document *doc, QStandardItem *item, RangeCollection *ranges, DocumentCollection *docs)
     {
         Q_ASSERT(item);
+        auto url = item->data(RangeData::FileUrlRole).toUrl();
+        KTextEditor::Range range = item->data(RangeData::RangeRole).value<LSPRange>();
+        RangeData::KindEnum kind = RangeData::KindEnum(item->data(RangeData::KindRole).toInt());
+        addMarks(doc, url, range, kind, ranges, docs);
+    }
+
+    void addMarks(KTextEditor::Document *doc, const QUrl &url, KTextEditor::Range range, RangeData::KindEnum kind, RangeCollection *ranges, DocumentCollection *docs)
+    {
         KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
         Q_ASSERT(miface);
 #if KTEXTEDITOR_VERSION >= QT_VERSION_CHECK(5, 69, 0)
@@ -821,17 +1304,14 @@ public:
         KTextEditor::View *activeView = m_mainWindow->activeView();
         KTextEditor::ConfigInterface *ciface = qobject_cast<KTextEditor::ConfigInterface *>(activeView);
 
-        auto url = item->data(RangeData::FileUrlRole).toUrl();
         // document url could end up empty while in intermediate reload state
         // (and then it might match a parent item with no RangeData at all)
         if (url != doc->url() || url.isEmpty())
             return;
 
-        KTextEditor::Range range = item->data(RangeData::RangeRole).value<LSPRange>();
         if (!range.isValid() || range.isEmpty())
             return;
         auto line = range.start().line();
-        RangeData::KindEnum kind = RangeData::KindEnum(item->data(RangeData::KindRole).toInt());
 
         KTextEditor::Attribute::Ptr attr(new KTextEditor::Attribute());
 
@@ -972,6 +1452,30 @@ public:
         addMarksRec(doc, treeModel->invisibleRootItem(), oranges, odocs);
     }
 
+    void addDiagnosticsMarks(KTextEditor::Document *doc)
+    {
+        // check if already added
+        auto oranges = m_diagnosticsRanges.contains(doc) ? nullptr : &m_diagnosticsRanges;
+        auto odocs = m_diagnosticsMarks.contains(doc) ? nullptr : &m_diagnosticsMarks;
+
+        if (!oranges && !odocs)
+            return;
+
+        const auto url = doc->url();
+        for (const auto &file : m_diagnosticsModel->files()) {
+            const bool own = file->url == url;
+            for (const auto &diag : file->diagnostics) {
+                if (own)
+                    addMarks(doc, url, diag->diagnostic.range, diag->diagnostic.severity, oranges, odocs);
+                // related information may well point elsewhere
+                for (const auto &related : diag->diagnostic.relatedInformation) {
+                    if (related.location.uri == url)
+                        addMarks(doc, url, related.location.range, RangeData::KindEnum::Related, oranges, odocs);
+                }
+            }
+        }
+    }
+
     void goToDocumentLocation(const QUrl &uri, const KTextEditor::Range& location)
     {
         int line = location.start().line();
@@ -1024,31 +1528,6 @@ public:
         goToDocumentLocation(url, start);
     }
 
-    // custom item subclass that captures additional attributes;
-    // a bit more convenient than the variant/role way
-    struct DiagnosticItem : public QStandardItem {
-        LSPDiagnostic m_diagnostic;
-        LSPCodeAction m_codeAction;
-        QSharedPointer<LSPClientRevisionSnapshot> m_snapshot;
-
-        DiagnosticItem(const LSPDiagnostic &d)
-            : m_diagnostic(d)
-        {
-        }
-
-        DiagnosticItem(const LSPCodeAction &c, QSharedPointer<LSPClientRevisionSnapshot> s)
-            : m_codeAction(c)
-            , m_snapshot(std::move(s))
-        {
-            m_diagnostic.range = LSPRange::invalid();
-        }
-
-        bool isCodeAction()
-        {
-            return !m_diagnostic.range.isValid() && m_codeAction.title.size();
-        }
-    };
-
     // double click on:
     // diagnostic item -> request and add actions (below item)
     // code action -> perform action (literal edit and/or execute command)
@@ -1058,15 +1537,14 @@ public:
         KTextEditor::View *activeView = m_mainWindow->activeView();
         QPointer<KTextEditor::Document> document = activeView->document();
         auto server = m_serverManager->findServer(activeView);
-        auto it = dynamic_cast<DiagnosticItem *>(m_diagnosticsModel->itemFromIndex(index));
-        if (!server || !document || !it)
+        if (!server || !document || !index.isValid())
             return;
 
         // click on an action ?
-        if (it->isCodeAction()) {
-            auto &action = it->m_codeAction;
+        if (auto codeAction = m_diagnosticsModel->codeActionAt(index)) {
+            auto &action = codeAction->action;
             // apply edit before command
-            applyWorkspaceEdit(action.edit, it->m_snapshot.data());
+            applyWorkspaceEdit(action.edit, codeAction->snapshot.data());
             auto &command = action.command;
             if (command.command.size()) {
                 // accept edit requests that may be sent to execute command
@@ -1085,11 +1563,13 @@ public:
         // only engage action if
         // * active document matches diagnostic document
         // * if really clicked a diagnostic item
-        //   (which is the case as it != nullptr and not a code action)
         // * if no code action invoked and added already
         //   (note; related items are also children)
-        auto url = it->data(RangeData::FileUrlRole).toUrl();
-        if (url != document->url() || it->data(Qt::UserRole).toBool())
+        auto diagnostic = m_diagnosticsModel->diagnosticAt(index);
+        if (!diagnostic)
+            return;
+        auto url = index.data(RangeData::FileUrlRole).toUrl();
+        if (url != document->url() || diagnostic->codeActionsAdded)
             return;
 
         // store some things to find item safely later on
@@ -1098,27 +1578,16 @@ public:
         auto h = [this, url, snapshot, pindex](const QList<LSPCodeAction> &actions) {
             if (!pindex.isValid())
                 return;
-            auto child = m_diagnosticsModel->itemFromIndex(pindex);
-            if (!child)
-                return;
             // add actions below diagnostic item
-            for (const auto &action : actions) {
-                auto item = new DiagnosticItem(action, snapshot);
-                child->appendRow(item);
-                auto text = action.kind.size() ? QStringLiteral("[%1] %2").arg(action.kind).arg(action.title) : action.title;
-                item->setData(text, Qt::DisplayRole);
-                item->setData(codeActionIcon(), Qt::DecorationRole);
-            }
-            m_diagnosticsTree->setExpanded(child->index(), true);
-            // mark actions added
-            child->setData(true, Qt::UserRole);
+            m_diagnosticsModel->addCodeActions(pindex, actions, snapshot);
+            m_diagnosticsTree->setExpanded(pindex, true);
         };
 
         auto range = activeView->selectionRange();
         if (!range.isValid()) {
             range = document->documentRange();
         }
-        server->documentCodeAction(url, range, {}, {it->m_diagnostic}, this, h);
+        server->documentCodeAction(url, range, {}, {diagnostic->diagnostic}, this, h);
     }
 
     bool tabCloseRequested(int index)
@@ -1152,6 +1621,143 @@ public:
         m_mainWindow->showToolView(m_toolView.data());
     }
 
+    void findWorkspaceSymbol()
+    {
+        if (!m_workspaceSymbols) {
+            m_workspaceSymbols = LSPClientWorkspaceSymbols::new_(m_mainWindow, m_serverManager);
+            connect(m_workspaceSymbols, &LSPClientWorkspaceSymbols::symbolActivated, this, &self_type::goToDocumentLocation);
+        }
+        m_workspaceSymbols->popup();
+    }
+
+    void showMetrics()
+    {
+        if (!m_metricsTree) {
+            m_metricsTree = new QTreeView();
+            m_metricsTree->setFocusPolicy(Qt::NoFocus);
+            m_metricsTree->setLayoutDirection(Qt::LeftToRight);
+            m_metricsTree->setEditTriggers(QAbstractItemView::NoEditTriggers);
+            m_metricsTree->setUniformRowHeights(true);
+            auto model = new QStandardItemModel(m_metricsTree);
+            model->setHorizontalHeaderLabels({i18nc("@title:column", "Server / Method"),
+                                              i18nc("@title:column", "Requests"),
+                                              i18nc("@title:column", "Notifications"),
+                                              i18nc("@title:column", "Cancelled"),
+                                              i18nc("@title:column", "Errors"),
+                                              i18nc("@title:column", "p50 (ms)"),
+                                              i18nc("@title:column", "p95 (ms)"),
+                                              i18nc("@title:column", "p99 (ms)"),
+                                              i18nc("@title:column", "Sent"),
+                                              i18nc("@title:column", "Received"),
+                                              i18nc("@title:column", "Decoding (ms)"),
+                                              i18nc("@title:column", "Handling (ms)")});
+            m_metricsTree->setModel(model);
+
+            // context menu
+            m_metricsTree->setContextMenuPolicy(Qt::CustomContextMenu);
+            auto menu = new QMenu(m_metricsTree);
+            menu->addAction(i18n("Export as JSON..."), this, &self_type::exportMetrics);
+            menu->addAction(i18n("Reset"), this, &self_type::resetMetrics);
+            auto h = [menu](const QPoint &) { menu->popup(QCursor::pos()); };
+            connect(m_metricsTree, &QTreeView::customContextMenuRequested, h);
+
+            // next to the fixed tabs
+            int index = std::max(m_tabWidget->indexOf(m_messagesView), m_tabWidget->indexOf(m_diagnosticsTree)) + 1;
+            m_tabWidget->insertTab(index, m_metricsTree, i18nc("@title:tab", "Metrics"));
+            m_metricsTimer.start();
+        }
+        updateMetrics();
+        m_tabWidget->setCurrentWidget(m_metricsTree);
+        m_mainWindow->showToolView(m_toolView.data());
+    }
+
+    void updateMetrics()
+    {
+        if (!m_metricsTree) {
+            m_metricsTimer.stop();
+            return;
+        }
+        // no use updating what is not seen
+        if (m_tabWidget->currentWidget() != m_metricsTree || !m_metricsTree->isVisible())
+            return;
+
+        auto model = static_cast<QStandardItemModel *>(m_metricsTree->model());
+        const int scroll = m_metricsTree->verticalScrollBar()->value();
+        model->setRowCount(0);
+
+        auto time = [](qint64 us) {
+            return QString::number(us / 1000.0, 'f', 1);
+        };
+        auto size = [](qint64 bytes) {
+            return QLocale().formattedDataSize(bytes);
+        };
+        for (const auto &server : m_serverManager->servers()) {
+            auto serverItem = new QStandardItem(LSPClientServerManager::serverDescription(server.data()));
+            const auto &methods = server->metrics().methods();
+            for (auto it = methods.begin(); it != methods.end(); ++it) {
+                const auto &m = it.value();
+                auto latency = [&m, &time](int p) {
+                    const auto value = m.latency(p);
+                    return value < 0 ? QString() : time(value);
+                };
+                QList<QStandardItem *> row;
+                for (const auto &text : {it.key(),
+                                         QString::number(m.requests),
+                                         QString::number(m.notifications),
+                                         QString::number(m.cancelled),
+                                         QString::number(m.errors),
+                                         latency(50),
+                                         latency(95),
+                                         latency(99),
+                                         size(m.bytesOut),
+                                         size(m.bytesIn),
+                                         time(m.decodeTime),
+                                         time(m.handlerTime)}) {
+                    auto item = new QStandardItem(text);
+                    if (!row.empty())
+                        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                    row.push_back(item);
+                }
+                serverItem->appendRow(row);
+            }
+            model->appendRow(serverItem);
+        }
+
+        m_metricsTree->expandAll();
+        m_metricsTree->verticalScrollBar()->setValue(scroll);
+    }
+
+    QJsonObject metricsJson() const
+    {
+        QJsonArray servers;
+        for (const auto &server : m_serverManager->servers()) {
+            servers.push_back(QJsonObject {{QStringLiteral("server"), LSPClientServerManager::serverDescription(server.data())},
+                                           {QStringLiteral("command"), server->cmdline().join(QLatin1Char(' '))},
+                                           {QStringLiteral("methods"), server->metrics().toJson()}});
+        }
+        return QJsonObject {{QStringLiteral("timeUnit"), QStringLiteral("us")}, {QStringLiteral("servers"), servers}};
+    }
+
+    void exportMetrics()
+    {
+        const auto fileName = QFileDialog::getSaveFileName(m_mainWindow->window(), i18n("Export Server Metrics"), QString(), i18n("JSON files (*.json)"));
+        if (fileName.isEmpty())
+            return;
+
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(metricsJson()).toJson()) < 0) {
+            onShowMessage(KTextEditor::Message::Error, i18n("Failed to write server metrics to %1: %2", fileName, file.errorString()));
+        }
+    }
+
+    void resetMetrics()
+    {
+        for (const auto &server : m_serverManager->servers()) {
+            server->clearMetrics();
+        }
+        updateMetrics();
+    }
+
     void closeDynamic()
     {
         for (int i = 0; i < m_tabWidget->count();) {
@@ -1659,36 +2265,6 @@ public:
         delayCancelRequest(std::move(handle));
     }
 
-    static QStandardItem *getItem(const QStandardItemModel &model, const QUrl &url)
-    {
-        auto l = model.findItems(url.toLocalFile());
-        if (l.length()) {
-            return l.at(0);
-        }
-        return nullptr;
-    }
-
-    static QStandardItem *getItem(const QStandardItem *topItem, KTextEditor::Cursor pos, bool onlyLine)
-    {
-        QStandardItem *targetItem = nullptr;
-        if (topItem) {
-            int count = topItem->rowCount();
-            // let's not run wild on a linear search in a flood of diagnostics
-            // user is already in enough trouble as it is ;-)
-            if (count > 50)
-                count = 0;
-            for (int i = 0; i < count; ++i) {
-                auto item = topItem->child(i);
-                auto range = item->data(RangeData::RangeRole).value<LSPRange>();
-                if ((onlyLine && pos.line() == range.start().line()) || (range.contains(pos))) {
-                    targetItem = item;
-                    break;
-                }
-            }
-        }
-        return targetItem;
-    }
-
     // select/scroll to diagnostics item for document and (optionally) line
     bool syncDiagnostics(KTextEditor::Document *document, int line, bool allowTop, bool doShow)
     {
@@ -1696,25 +2272,25 @@ public:
             return false;
 
         auto hint = QAbstractItemView::PositionAtTop;
-        QStandardItem *topItem = getItem(*m_diagnosticsModel, document->url());
-        QStandardItem *targetItem = getItem(topItem, {line, 0}, true);
-        if (targetItem) {
+        QModelIndex topIndex = m_diagnosticsModel->fileIndex(document->url());
+        QModelIndex targetIndex = m_diagnosticsModel->diagnosticIndex(topIndex, {line, 0}, true);
+        if (targetIndex.isValid()) {
             hint = QAbstractItemView::PositionAtCenter;
         }
-        if (!targetItem && allowTop) {
-            targetItem = topItem;
+        if (!targetIndex.isValid() && allowTop) {
+            targetIndex = topIndex;
         }
-        if (targetItem) {
+        if (targetIndex.isValid()) {
             m_diagnosticsTree->blockSignals(true);
-            m_diagnosticsTree->scrollTo(targetItem->index(), hint);
-            m_diagnosticsTree->setCurrentIndex(targetItem->index());
+            m_diagnosticsTree->scrollTo(targetIndex, hint);
+            m_diagnosticsTree->setCurrentIndex(targetIndex);
             m_diagnosticsTree->blockSignals(false);
             if (doShow) {
                 m_tabWidget->setCurrentWidget(m_diagnosticsTree);
                 m_mainWindow->showToolView(m_toolView.data());
             }
         }
-        return targetItem != nullptr;
+        return targetIndex.isValid();
     }
 
     void onViewState(KTextEditor::View *view, LSPClientViewTracker::State newState)
@@ -1750,57 +2326,78 @@ public:
         if (!m_diagnosticsTree)
             return;
 
-        QStandardItemModel *model = m_diagnosticsModel.data();
-        QStandardItem *topItem = getItem(*m_diagnosticsModel, diagnostics.uri);
+        // only the latest diagnostics of a document matter
+        m_pendingDiagnostics.insert(diagnostics.uri, diagnostics.diagnostics);
+        if (!m_diagnosticsTimer.isActive())
+            m_diagnosticsTimer.start();
+    }
 
-        if (!topItem) {
-            // no need to create an empty one
-            if (diagnostics.diagnostics.empty()) {
-                return;
-            }
-            topItem = new QStandardItem();
-            model->appendRow(topItem);
-            topItem->setText(diagnostics.uri.toLocalFile());
-        } else {
-            topItem->setRowCount(0);
-        }
+    void processDiagnostics()
+    {
+        const auto pending = std::move(m_pendingDiagnostics);
+        m_pendingDiagnostics.clear();
+        if (!m_diagnosticsTree)
+            return;
 
-        for (const auto &diag : diagnostics.diagnostics) {
-            auto item = new DiagnosticItem(diag);
-            topItem->appendRow(item);
-            QString source;
-            if (diag.source.length()) {
-                source = QStringLiteral("[%1] ").arg(diag.source);
+        // documents the related information of a file's diagnostics points to
+        const auto relatedUrls = [this](const QUrl &url) {
+            QSet<QUrl> urls;
+            const auto file = m_diagnosticsModel->file(url);
+            if (!file)
+                return urls;
+            for (const auto &diag : file->diagnostics) {
+                for (const auto &related : diag->diagnostic.relatedInformation)
+                    urls.insert(related.location.uri);
             }
-            item->setData(diagnosticsIcon(diag.severity), Qt::DecorationRole);
-            item->setText(source + diag.message);
-            fillItemRoles(item, diagnostics.uri, diag.range, diag.severity);
-            const auto &relatedInfo = diag.relatedInformation;
-            for (const auto &related : relatedInfo) {
-                if (related.location.uri.isEmpty()) {
-                    continue;
-                }
-                auto relatedItemMessage = new QStandardItem();
-                fillItemRoles(relatedItemMessage, related.location.uri, related.location.range, RangeData::KindEnum::Related);
-                auto basename = QFileInfo(related.location.uri.toLocalFile()).fileName();
-                auto location = QStringLiteral("%1:%2").arg(basename).arg(related.location.range.start().line());
-                relatedItemMessage->setText(QStringLiteral("[%1] %2").arg(location).arg(related.message));
-                relatedItemMessage->setData(diagnosticsIcon(LSPDiagnosticSeverity::Information), Qt::DecorationRole);
-                item->appendRow({relatedItemMessage});
-                m_diagnosticsTree->setExpanded(item->index(), true);
+            return urls;
+        };
+
+        QSet<QUrl> changed;
+        // documents with marks to replace; changed ones and those related before or after
+        QSet<QUrl> touched;
+        QModelIndex topIndex;
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            const auto related = relatedUrls(it.key());
+            if (!m_diagnosticsModel->setDiagnostics(it.key(), it.value()))
+                continue;
+            changed.insert(it.key());
+            touched.insert(it.key());
+            touched += related;
+            touched += relatedUrls(it.key());
+            auto index = m_diagnosticsModel->fileIndex(it.key());
+            if (!index.isValid())
+                continue;
+            topIndex = index;
+            // TODO perhaps add some custom delegate that only shows 1 line
+            // and only the whole text when item selected ??
+            m_diagnosticsTree->setExpanded(topIndex, true);
+            // show related information
+            const int count = m_diagnosticsModel->rowCount(topIndex);
+            for (int i = 0; i < count; ++i) {
+                auto child = m_diagnosticsModel->index(i, 0, topIndex);
+                if (m_diagnosticsModel->rowCount(child) > 0)
+                    m_diagnosticsTree->setExpanded(child, true);
             }
         }
+        if (topIndex.isValid())
+            m_diagnosticsTree->scrollTo(topIndex, QAbstractItemView::PositionAtTop);
 
-        // TODO perhaps add some custom delegate that only shows 1 line
-        // and only the whole text when item selected ??
-        m_diagnosticsTree->setExpanded(topItem->index(), true);
-        m_diagnosticsTree->setRowHidden(topItem->row(), QModelIndex(), topItem->rowCount() == 0);
-        m_diagnosticsTree->scrollTo(topItem->index(), QAbstractItemView::PositionAtTop);
+        // update marks of open documents, other ones get them once opened
+        QSet<KTextEditor::Document *> docs;
+        for (auto view : m_mainWindow->views()) {
+            auto doc = view->document();
+            if (!doc || docs.contains(doc) || !(pending.contains(doc->url()) || touched.contains(doc->url())))
+                continue;
+            docs.insert(doc);
+            // marks may also have been cleared meanwhile (e.g. reload) even if unchanged
+            if (touched.contains(doc->url()))
+                clearMarks(doc, m_diagnosticsRanges, m_diagnosticsMarks, RangeData::markTypeDiagAll);
+            addDiagnosticsMarks(doc);
+        }
 
-        updateState();
         // also sync updated diagnositic to current position
         auto currentView = m_mainWindow->activeView();
-        if (currentView && currentView->document())
+        if (!changed.empty() && currentView && currentView->document())
             syncDiagnostics(currentView->document(), currentView->cursorPosition().line(), false, false);
     }
 
@@ -1815,16 +2412,16 @@ public:
         bool autoHover = m_autoHover && m_autoHover->isChecked();
         bool diagHover = m_diagnostics && m_diagnostics->isChecked() && m_diagnosticsHover && m_diagnosticsHover->isChecked();
 
-        QStandardItem *topItem = diagHover ? getItem(*m_diagnosticsModel, document->url()) : nullptr;
-        QStandardItem *targetItem = getItem(topItem, position, false);
-        if (targetItem) {
-            result = targetItem->text();
+        QModelIndex topIndex = diagHover ? m_diagnosticsModel->fileIndex(document->url()) : QModelIndex();
+        QModelIndex targetIndex = m_diagnosticsModel->diagnosticIndex(topIndex, position, false);
+        if (targetIndex.isValid()) {
+            result = targetIndex.data().toString();
             // also include related info
-            int count = targetItem->rowCount();
+            int count = m_diagnosticsModel->rowCount(targetIndex);
             for (int i = 0; i < count; ++i) {
-                auto item = targetItem->child(i);
+                auto index = m_diagnosticsModel->index(i, 0, targetIndex);
                 result += QStringLiteral("\n<br>");
-                result += item->text();
+                result += index.data().toString();
             }
             // but let's not get carried away too far
             const int maxsize = m_plugin->m_diagnosticsSize;
@@ -1923,10 +2520,8 @@ public:
 
     Q_SLOT void clearSemanticHighlighting(KTextEditor::Document *document)
     {
-        auto &documentRanges = m_semanticHighlightRanges[document];
-        for (const auto &lineRanges : documentRanges)
-            qDeleteAll(lineRanges);
-        documentRanges.clear();
+        m_semanticHighlightRanges.remove(document);
+        m_semanticTokens.remove(document);
     }
 
     void onSemanticHighlighting(const LSPSemanticHighlightingParams &params)
@@ -1943,6 +2538,12 @@ public:
             return;
         }
 
+        // semantic tokens take precedence, both would update the same ranges
+        const auto &tokenCaps = server->capabilities().semanticTokensProvider;
+        if (tokenCaps.full || tokenCaps.range) {
+            return;
+        }
+
         auto *document = view->document();
         auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
         Q_ASSERT(miface);
@@ -1964,118 +2565,199 @@ public:
         connect(document, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
         connect(document, SIGNAL(aboutToDeleteMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
 
-        // TODO: make schema attributes accessible via some new interface,
-        // or at least add configuration to the lsp plugin config
-        // FIXME: static attributes break if one e.g. switches the color scheme on the fly!
+        // map the scopes to the corresponding semantic token type
         auto attributeForScopes = [view](const QVector<QString> &scopes) -> KTextEditor::Attribute::Ptr {
+            static const QHash<QString, QString> scopeTypes = {
+                {QStringLiteral("entity.name.function.method.cpp"), QStringLiteral("method")},
+                {QStringLiteral("entity.name.function.cpp"), QStringLiteral("function")},
+                {QStringLiteral("variable.other.cpp"), QStringLiteral("variable")},
+                {QStringLiteral("variable.other.field.cpp"), QStringLiteral("property")},
+                {QStringLiteral("entity.name.type.enum.cpp"), QStringLiteral("enum")},
+                {QStringLiteral("variable.other.enummember.cpp"), QStringLiteral("enumMember")},
+                {QStringLiteral("entity.name.type.class.cpp"), QStringLiteral("class")},
+                {QStringLiteral("entity.name.type.template.cpp"), QStringLiteral("class")},
+                {QStringLiteral("entity.name.namespace.cpp"), QStringLiteral("namespace")},
+            };
             for (const auto &scope : scopes) {
-                if (scope == QLatin1String("entity.name.function.method.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
-                        attr.detach();
-                        attr->setForeground(Qt::darkYellow);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.function.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
-                        attr.detach();
-                        attr->setForeground(Qt::darkYellow);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
-                        attr.detach();
-                        attr->setForeground(Qt::darkCyan);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.field.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
-                        attr.detach();
-                        attr->setForeground(Qt::darkCyan);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.type.enum.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.enummember.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.type.class.cpp") || scope == QLatin1String("entity.name.type.template.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.namespace.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
-                        attr.detach();
-                        attr->setForeground(Qt::darkGreen);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
+                const auto type = scopeTypes.value(scope);
+                if (!type.isEmpty()) {
+                    return semanticTokenAttribute(type, view);
                 }
             }
             return {};
         };
 
-        // TODO: we should try to recycle the moving ranges instead of recreating them all the time
-
         const auto scopes = server->capabilities().semanticHighlightingProvider.scopes;
         // qDebug() << params.textDocument.uri << scopes;
 
+        // resolve each scope once, not per token
+        QVector<KTextEditor::Attribute::Ptr> scopeAttributes;
+        scopeAttributes.reserve(scopes.size());
+        for (const auto &scope : scopes) {
+            scopeAttributes.push_back(attributeForScopes(scope));
+        }
+
         auto &documentRanges = m_semanticHighlightRanges[document];
+        if (!documentRanges) {
+            documentRanges.reset(new LSPClientSemanticRanges(miface));
+        }
         QSet<int> handledLines;
+        QVector<LSPClientSemanticRanges::Token> tokens;
         for (const auto &line : params.lines) {
             handledLines.insert(line.line);
-            auto &lineRanges = documentRanges[line.line];
-            qDeleteAll(lineRanges);
-            lineRanges.clear();
+            tokens.clear();
             // qDebug() << "line:" << line.line;
             for (const auto &token : line.tokens) {
                 // qDebug() << "token:" << token.character << token.length << token.scope << scopes.value(token.scope);
-                auto attribute = attributeForScopes(scopes.value(token.scope));
+                auto attribute = scopeAttributes.value(token.scope);
                 if (!attribute)
                     continue;
 
-                const auto columnStart = static_cast<int>(token.character);
-                const auto columnEnd = columnStart + static_cast<int>(token.length);
-                constexpr auto expand = KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight;
-                auto *range = miface->newMovingRange({line.line, columnStart, line.line, columnEnd}, expand, KTextEditor::MovingRange::InvalidateIfEmpty);
-                range->setAttribute(attribute);
+                tokens.push_back({static_cast<int>(token.character), static_cast<int>(token.length), attribute});
             }
+            // only changed lines are touched
+            documentRanges->setLine(line.line, tokens);
         }
         // clear lines that got removed or commented out
-        for (auto it = documentRanges.begin(); it != documentRanges.end();) {
-            if (!handledLines.contains(it.key())) {
-                qDeleteAll(it.value());
-                it = documentRanges.erase(it);
-            } else {
-                ++it;
+        documentRanges->retainLines(handledLines);
+    }
+
+    void requestSemanticTokens()
+    {
+        KTextEditor::View *activeView = m_mainWindow->activeView();
+        auto server = m_serverManager->findServer(activeView);
+        if (!server || !m_plugin->m_semanticHighlighting) {
+            return;
+        }
+        const auto &caps = server->capabilities().semanticTokensProvider;
+        if (!caps.full && !caps.range) {
+            return;
+        }
+
+        auto *document = activeView->document();
+        auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
+        Q_ASSERT(miface);
+
+        // ensure runtime match
+        connect(document, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
+        connect(document, SIGNAL(aboutToDeleteMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
+
+        // findServer has synced the document, so replies are for this revision
+        const qint64 revision = miface->revision();
+        QPointer<KTextEditor::Document> doc(document);
+        QPointer<LSPClientServer> serverPtr(server.data());
+        auto &tokens = m_semanticTokens[document];
+
+        // highlight what is visible first, the full result takes longer
+        if (caps.range && (!caps.full || tokens.resultId.isEmpty())) {
+            auto h = [this, doc, serverPtr, revision](const LSPSemanticTokensDelta &result) {
+                auto *miface = qobject_cast<KTextEditor::MovingInterface *>(doc.data());
+                if (miface && serverPtr && miface->revision() == revision) {
+                    applySemanticTokens(doc, serverPtr, result.data, false);
+                }
+            };
+            tokens.rangeHandle.cancel() = server->documentSemanticTokensRange(document->url(), visibleRange(activeView), this, h);
+        }
+
+        if (!caps.full) {
+            return;
+        }
+        auto h = [this, doc, serverPtr, revision](const LSPSemanticTokensDelta &result) {
+            if (doc && serverPtr) {
+                onSemanticTokens(doc, serverPtr, revision, result);
             }
+        };
+        if (caps.fullDelta && !tokens.resultId.isEmpty()) {
+            tokens.handle.cancel() = server->documentSemanticTokensFullDelta(document->url(), tokens.resultId, this, h);
+        } else {
+            tokens.handle.cancel() = server->documentSemanticTokensFull(document->url(), this, h);
+        }
+    }
+
+    void onSemanticTokens(KTextEditor::Document *document, LSPClientServer *server, qint64 revision, const LSPSemanticTokensDelta &result)
+    {
+        auto it = m_semanticTokens.find(document);
+        if (it == m_semanticTokens.end()) {
+            return;
+        }
+
+        // keep the data in sync with the server, even if it no longer fits the document
+        auto &tokens = *it;
+        if (!result.delta) {
+            tokens.data = result.data;
+        } else if (!applySemanticTokensEdits(tokens.data, result.edits)) {
+            qCWarning(LSPCLIENT) << "discarding invalid semantic tokens delta";
+            tokens.data.clear();
+            tokens.resultId.clear();
+            m_semanticTokensTimer.start();
+            return;
+        }
+        tokens.resultId = result.resultId;
+
+        // edited meanwhile, a new request follows
+        auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
+        if (miface->revision() != revision) {
+            return;
+        }
+        applySemanticTokens(document, server, tokens.data, true);
+    }
+
+    const QVector<KTextEditor::Attribute::Ptr> &semanticTokenAttributes(LSPClientServer *server, KTextEditor::View *view)
+    {
+        // the legend is fixed for the lifetime of the server
+        auto &entry = m_semanticTokenAttributes[server];
+        if (!entry.server) {
+            entry.server = server;
+            entry.attributes.clear();
+            for (const auto &type : server->capabilities().semanticTokensProvider.legend.tokenTypes) {
+                entry.attributes.push_back(semanticTokenAttribute(type, view));
+            }
+        }
+        return entry.attributes;
+    }
+
+    // full: data covers the whole document, so lines without tokens are cleared
+    void applySemanticTokens(KTextEditor::Document *document, LSPClientServer *server, const QVector<quint32> &data, bool full)
+    {
+        KTextEditor::View *activeView = m_mainWindow->activeView();
+        if (!activeView) {
+            return;
+        }
+        const auto &attributes = semanticTokenAttributes(server, activeView);
+
+        auto &documentRanges = m_semanticHighlightRanges[document];
+        if (!documentRanges) {
+            documentRanges.reset(new LSPClientSemanticRanges(qobject_cast<KTextEditor::MovingInterface *>(document)));
+        }
+
+        // 5 integers per token: delta line, delta start column, length, type, modifiers
+        QSet<int> handledLines;
+        QVector<LSPClientSemanticRanges::Token> tokens;
+        int line = 0;
+        int column = 0;
+        for (int i = 0; i + 4 < data.size(); i += 5) {
+            if (data[i] != 0) {
+                if (!tokens.isEmpty()) {
+                    documentRanges->setLine(line, tokens);
+                    handledLines.insert(line);
+                    tokens.clear();
+                }
+                line += data[i];
+                column = 0;
+            }
+            column += data[i + 1];
+            const auto attribute = attributes.value(data[i + 3]);
+            if (attribute) {
+                tokens.push_back({column, static_cast<int>(data[i + 2]), attribute});
+            }
+        }
+        if (!tokens.isEmpty()) {
+            documentRanges->setLine(line, tokens);
+            handledLines.insert(line);
+        }
+
+        if (full) {
+            documentRanges->retainLines(handledLines);
         }
     }
 
@@ -2088,34 +2770,29 @@ public:
         // if a language has a project system, diagnostics are not cleared by *server*
         // but in either case (url change or close); remove lingering diagnostics
         // collect active urls
-        QSet<QString> fpaths;
+        QSet<QUrl> urls;
         for (const auto &view : m_mainWindow->views()) {
             if (auto doc = view->document()) {
-                fpaths.insert(doc->url().toLocalFile());
+                urls.insert(doc->url());
             }
         }
         // check and clear defunct entries
-        const auto &model = *m_diagnosticsModel;
-        for (int i = 0; i < model.rowCount(); ++i) {
-            auto item = model.item(i);
-            if (item && !fpaths.contains(item->text())) {
-                item->setRowCount(0);
-                if (m_diagnosticsTree) {
-                    m_diagnosticsTree->setRowHidden(item->row(), QModelIndex(), true);
-                }
-            }
-        }
+        m_diagnosticsModel->retainFiles(urls);
     }
 
     void onTextChanged(KTextEditor::Document *doc)
     {
-        if (m_onTypeFormattingTriggers.empty())
-            return;
-
         KTextEditor::View *activeView = m_mainWindow->activeView();
         if (!activeView || activeView->document() != doc)
             return;
 
+        if (m_semanticTokens.contains(doc)) {
+            m_semanticTokensTimer.start();
+        }
+
+        if (m_onTypeFormattingTriggers.empty())
+            return;
+
         // NOTE the intendation mode should probably be set to None,
         // so as not to experience unpleasant interference
         auto cursor = activeView->cursorPosition();
@@ -2134,6 +2811,7 @@ public:
         bool hoverEnabled = false, highlightEnabled = false;
         bool formatEnabled = false;
         bool renameEnabled = false;
+        bool workspaceSymbolEnabled = false;
 
         if (server) {
             const auto &caps = server->capabilities();
@@ -2165,6 +2843,11 @@ public:
                 connect(doc, &KTextEditor::Document::textChanged, this, &self_type::onTextChanged, Qt::UniqueConnection);
                 connect(doc, &KTextEditor::Document::documentUrlChanged, this, &self_type::onDocumentUrlChanged, Qt::UniqueConnection);
             }
+
+            // bring the highlighting up to date, a delta if seen before
+            if (doc) {
+                requestSemanticTokens();
+            }
         }
 
         if (m_findDef)
@@ -2175,6 +2858,13 @@ public:
             m_findRef->setEnabled(refEnabled);
         if (m_findImpl)
             m_findImpl->setEnabled(implEnabled);
+        if (m_findWorkspaceSymbol) {
+            // any server will do, not only the one of the current document
+            for (const auto &s : m_serverManager->servers()) {
+                workspaceSymbolEnabled = workspaceSymbolEnabled || s->capabilities().workspaceSymbolProvider;
+            }
+            m_findWorkspaceSymbol->setEnabled(workspaceSymbolEnabled);
+        }
         if (m_triggerHighlight)
             m_triggerHighlight->setEnabled(highlightEnabled);
         if (m_triggerSymbolInfo)
@@ -2203,10 +2893,9 @@ public:
         // update marks if applicable
         if (m_markModel && doc)
             addMarks(doc, m_markModel, m_ranges, m_marks);
-        if (m_diagnosticsModel && doc) {
-            clearMarks(doc, m_diagnosticsRanges, m_diagnosticsMarks, RangeData::markTypeDiagAll);
-            addMarks(doc, m_diagnosticsModel.data(), m_diagnosticsRanges, m_diagnosticsMarks);
-        }
+        // (diagnostics marks are replaced as diagnostics change)
+        if (m_diagnosticsModel && doc)
+            addDiagnosticsMarks(doc);
 
         // connect for cleanup stuff
         if (activeView)
@@ -2274,15 +2963,42 @@ class LSPClientPluginViewImpl : public QObject, public KXMLGUIClient
 
     typedef LSPClientPluginViewImpl self_type;
 
+    LSPClientPlugin *m_plugin;
     KTextEditor::MainWindow *m_mainWindow;
     QSharedPointer<LSPClientServerManager> m_serverManager;
     QScopedPointer<LSPClientActionView> m_actionView;
+    QPointer<QObject> m_projectPluginView;
+
+    Q_SLOT
+    void onPluginViewCreated(const QString &name, QObject *pluginView)
+    {
+        if (pluginView && name == QLatin1String("kateprojectplugin")) {
+            m_projectPluginView = pluginView;
+            connect(pluginView, SIGNAL(projectMapChanged()), this, SLOT(onProjectMapChanged()), Qt::UniqueConnection);
+            onProjectMapChanged();
+        }
+    }
+
+    // a project got loaded or activated
+    Q_SLOT
+    void onProjectMapChanged()
+    {
+        if (!m_plugin->m_serverStartOnProjectLoad || !m_projectPluginView)
+            return;
+
+        const auto projectBaseDir = m_projectPluginView->property("projectBaseDir").toString();
+        const auto projectMap = m_projectPluginView->property("projectMap").toMap();
+        if (!projectBaseDir.isEmpty()) {
+            m_serverManager->startServers(projectBaseDir, projectMap);
+        }
+    }
 
 public:
     LSPClientPluginViewImpl(LSPClientPlugin *plugin, KTextEditor::MainWindow *mainWin)
         : QObject(mainWin)
+        , m_plugin(plugin)
         , m_mainWindow(mainWin)
-        , m_serverManager(LSPClientServerManager::new_(plugin, mainWin))
+        , m_serverManager(plugin->serverManager())
     {
         KXMLGUIClient::setComponentName(QStringLiteral("lspclient"), i18n("LSP Client"));
         setXMLFile(QStringLiteral("ui.rc"));
@@ -2291,6 +3007,10 @@ public:
         m_actionView.reset(new LSPClientActionView(plugin, mainWin, this, m_serverManager));
 
         m_mainWindow->guiFactory()->addClient(this);
+
+        // servers may be started as soon as a project is loaded
+        connect(m_mainWindow, &KTextEditor::MainWindow::pluginViewCreated, this, &self_type::onPluginViewCreated);
+        onPluginViewCreated(QStringLiteral("kateprojectplugin"), m_mainWindow->pluginView(QStringLiteral("kateprojectplugin")));
     }
 
     ~LSPClientPluginViewImpl() override
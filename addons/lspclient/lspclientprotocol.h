@@ -69,6 +69,18 @@ struct LSPSemanticHighlightingOptions {
     QVector<QVector<QString>> scopes;
 };
 
+struct LSPSemanticTokensLegend {
+    QVector<QString> tokenTypes;
+    QVector<QString> tokenModifiers;
+};
+
+struct LSPSemanticTokensOptions {
+    LSPSemanticTokensLegend legend;
+    bool full = false;
+    bool fullDelta = false;
+    bool range = false;
+};
+
 struct LSPServerCapabilities {
     LSPDocumentSyncKind textDocumentSync = LSPDocumentSyncKind::None;
     bool hoverProvider = false;
@@ -80,6 +92,7 @@ struct LSPServerCapabilities {
     bool referencesProvider = false;
     bool implementationProvider = false;
     bool documentSymbolProvider = false;
+    bool workspaceSymbolProvider = false;
     bool documentHighlightProvider = false;
     bool documentFormattingProvider = false;
     bool documentRangeFormattingProvider = false;
@@ -88,6 +101,7 @@ struct LSPServerCapabilities {
     // CodeActionOptions not useful/considered at present
     bool codeActionProvider = false;
     LSPSemanticHighlightingOptions semanticHighlightingProvider;
+    LSPSemanticTokensOptions semanticTokensProvider;
 };
 
 enum class LSPMarkupKind { None = 0, PlainText = 1, MarkDown = 2 };
@@ -172,6 +186,13 @@ struct LSPSymbolInformation {
     QList<LSPSymbolInformation> children;
 };
 
+struct LSPWorkspaceSymbol {
+    QString name;
+    LSPSymbolKind kind;
+    LSPLocation location;
+    QString containerName;
+};
+
 enum class LSPCompletionItemKind {
     Text = 1,
     Method = 2,
@@ -207,6 +228,13 @@ struct LSPCompletionItem {
     LSPMarkupContent documentation;
     QString sortText;
     QString insertText;
+    QString filterText;
+};
+
+struct LSPCompletionList {
+    // further typing should not be handled by filtering these items
+    bool isIncomplete;
+    QList<LSPCompletionItem> items;
 };
 
 struct LSPParameterInformation {
@@ -299,6 +327,22 @@ struct LSPSemanticHighlightingParams {
     QVector<LSPSemanticHighlightingInformation> lines;
 };
 
+struct LSPSemanticTokensEdit {
+    int start = 0;
+    int deleteCount = 0;
+    QVector<quint32> data;
+};
+
+// result of a semanticTokens full, full/delta or range request
+struct LSPSemanticTokensDelta {
+    QString resultId;
+    // edits of the previous data, or all data
+    bool delta = false;
+    // 5 integers per token, positions relative to the previous token
+    QVector<quint32> data;
+    QVector<LSPSemanticTokensEdit> edits;
+};
+
 struct LSPCommand {
     QString title;
     QString command;
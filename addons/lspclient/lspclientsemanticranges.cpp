@@ -0,0 +1,101 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientsemanticranges.h"
+
+#include <KTextEditor/MovingInterface>
+#include <KTextEditor/MovingRange>
+
+// pooled ranges kept at most, e.g. after a big block got removed
+static const int MaxPoolSize = 4096;
+
+LSPClientSemanticRanges::LSPClientSemanticRanges(KTextEditor::MovingInterface *miface)
+    : m_miface(miface)
+{
+}
+
+LSPClientSemanticRanges::~LSPClientSemanticRanges()
+{
+    for (const auto &lineRanges : qAsConst(m_lines)) {
+        qDeleteAll(lineRanges);
+    }
+    qDeleteAll(m_pool);
+}
+
+void LSPClientSemanticRanges::setLine(int line, const QVector<Token> &tokens)
+{
+    if (tokens.isEmpty()) {
+        auto it = m_lines.find(line);
+        if (it != m_lines.end()) {
+            for (auto *range : qAsConst(*it)) {
+                release(range);
+            }
+            m_lines.erase(it);
+        }
+        return;
+    }
+
+    auto &lineRanges = m_lines[line];
+    while (lineRanges.size() > tokens.size()) {
+        release(lineRanges.takeLast());
+    }
+
+    // ranges may have moved along with edits since, so compare the actual positions
+    for (int i = 0; i < tokens.size(); ++i) {
+        const auto &token = tokens.at(i);
+        const KTextEditor::Range target(line, token.column, line, token.column + token.length);
+        if (i == lineRanges.size()) {
+            lineRanges.push_back(acquire(target));
+        }
+        auto *range = lineRanges.at(i);
+        if (range->toRange() != target) {
+            range->setRange(target);
+        }
+        if (range->attribute() != token.attribute) {
+            range->setAttribute(token.attribute);
+        }
+    }
+}
+
+void LSPClientSemanticRanges::retainLines(const QSet<int> &lines)
+{
+    for (auto it = m_lines.begin(); it != m_lines.end();) {
+        if (!lines.contains(it.key())) {
+            for (auto *range : qAsConst(*it)) {
+                release(range);
+            }
+            it = m_lines.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+KTextEditor::MovingRange *LSPClientSemanticRanges::acquire(const KTextEditor::Range &range)
+{
+    if (!m_pool.isEmpty()) {
+        auto *recycled = m_pool.takeLast();
+        recycled->setRange(range);
+        return recycled;
+    }
+
+    constexpr auto expand = KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight;
+    return m_miface->newMovingRange(range, expand, KTextEditor::MovingRange::InvalidateIfEmpty);
+}
+
+void LSPClientSemanticRanges::release(KTextEditor::MovingRange *range)
+{
+    if (m_pool.size() >= MaxPoolSize) {
+        delete range;
+        return;
+    }
+
+    // invalid ranges are not tracked by the document
+    range->setAttribute(KTextEditor::Attribute::Ptr());
+    range->setRange(KTextEditor::Range::invalid());
+    m_pool.push_back(range);
+}
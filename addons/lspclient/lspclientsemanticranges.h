@@ -0,0 +1,63 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTSEMANTICRANGES_H
+#define LSPCLIENTSEMANTICRANGES_H
+
+#include <KTextEditor/Attribute>
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+namespace KTextEditor
+{
+class MovingInterface;
+class MovingRange;
+}
+
+/*
+ * Semantic highlighting ranges of a document, per line.
+ * An update only touches the ranges of lines whose tokens changed,
+ * and ranges no longer needed are kept in a pool for later lines
+ * rather than deleted and allocated again.
+ */
+class LSPClientSemanticRanges
+{
+public:
+    struct Token {
+        int column;
+        int length;
+        KTextEditor::Attribute::Ptr attribute;
+    };
+
+    explicit LSPClientSemanticRanges(KTextEditor::MovingInterface *miface);
+
+    // deletes all ranges, must happen before the document content is deleted
+    ~LSPClientSemanticRanges();
+
+    LSPClientSemanticRanges(const LSPClientSemanticRanges &) = delete;
+    LSPClientSemanticRanges &operator=(const LSPClientSemanticRanges &) = delete;
+
+    // highlight line with tokens, sorted by column
+    void setLine(int line, const QVector<Token> &tokens);
+
+    // remove highlighting of all lines not in lines
+    void retainLines(const QSet<int> &lines);
+
+private:
+    KTextEditor::MovingRange *acquire(const KTextEditor::Range &range);
+    void release(KTextEditor::MovingRange *range);
+
+private:
+    KTextEditor::MovingInterface *m_miface;
+    QHash<int, QVector<KTextEditor::MovingRange *>> m_lines;
+    // invalid ranges without attribute, ready for reuse
+    QVector<KTextEditor::MovingRange *> m_pool;
+};
+
+#endif
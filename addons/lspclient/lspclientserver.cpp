@@ -7,20 +7,26 @@
 
 #include "lspclientserver.h"
 #include "lspclientplugin.h"
+#include "lspclienttransport.h"
 
 #include "lspclient_debug.h"
 
 #include <QProcess>
 #include <QScopedPointer>
+#include <QThread>
 #include <QVariantMap>
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QTime>
 #include <QtEndian>
+#include <algorithm>
+#include <memory>
 #include <utility>
 
 // good/bad old school; allows easier concatenate
@@ -184,6 +190,20 @@ static QJsonObject documentOnTypeFormattingParams(const QUrl &document, const LS
     return params;
 }
 
+static QJsonObject semanticTokensDeltaParams(const QUrl &document, const QString &previousResultId)
+{
+    auto params = textDocumentParams(document);
+    params[QStringLiteral("previousResultId")] = previousResultId;
+    return params;
+}
+
+static QJsonObject semanticTokensRangeParams(const QUrl &document, const LSPRange &range)
+{
+    auto params = textDocumentParams(document);
+    params[MEMBER_RANGE] = to_json(range);
+    return params;
+}
+
 static QJsonObject renameParams(const QUrl &document, const LSPPosition &pos, const QString &newName)
 {
     auto params = textDocumentPositionParams(document, pos);
@@ -280,6 +300,32 @@ static void from_json(LSPSemanticHighlightingOptions &options, const QJsonValue
     }
 }
 
+static void from_json(QVector<QString> &strings, const QJsonValue &json)
+{
+    const auto array = json.toArray();
+    strings.clear();
+    strings.reserve(array.size());
+    for (const auto &value : array) {
+        strings.push_back(value.toString());
+    }
+}
+
+static void from_json(LSPSemanticTokensOptions &options, const QJsonValue &json)
+{
+    if (!json.isObject())
+        return;
+    const auto ob = json.toObject();
+    const auto legend = ob.value(QStringLiteral("legend")).toObject();
+    from_json(options.legend.tokenTypes, legend.value(QStringLiteral("tokenTypes")));
+    from_json(options.legend.tokenModifiers, legend.value(QStringLiteral("tokenModifiers")));
+    // either bool or object
+    const auto full = ob.value(QStringLiteral("full"));
+    options.full = full.toBool() || full.isObject();
+    options.fullDelta = full.toObject().value(QStringLiteral("delta")).toBool();
+    const auto range = ob.value(QStringLiteral("range"));
+    options.range = range.toBool() || range.isObject();
+}
+
 static void from_json(LSPServerCapabilities &caps, const QJsonObject &json)
 {
     auto sync = json.value(QStringLiteral("textDocumentSync"));
@@ -292,6 +338,8 @@ static void from_json(LSPServerCapabilities &caps, const QJsonObject &json)
     caps.referencesProvider = json.value(QStringLiteral("referencesProvider")).toBool();
     caps.implementationProvider = json.value(QStringLiteral("implementationProvider")).toBool();
     caps.documentSymbolProvider = json.value(QStringLiteral("documentSymbolProvider")).toBool();
+    auto workspaceSymbolProvider = json.value(QStringLiteral("workspaceSymbolProvider"));
+    caps.workspaceSymbolProvider = workspaceSymbolProvider.toBool() || workspaceSymbolProvider.isObject();
     caps.documentHighlightProvider = json.value(QStringLiteral("documentHighlightProvider")).toBool();
     caps.documentFormattingProvider = json.value(QStringLiteral("documentFormattingProvider")).toBool();
     caps.documentRangeFormattingProvider = json.value(QStringLiteral("documentRangeFormattingProvider")).toBool();
@@ -300,6 +348,7 @@ static void from_json(LSPServerCapabilities &caps, const QJsonObject &json)
     auto codeActionProvider = json.value(QStringLiteral("codeActionProvider"));
     caps.codeActionProvider = codeActionProvider.toBool() || codeActionProvider.isObject();
     from_json(caps.semanticHighlightingProvider, json.value(QStringLiteral("semanticHighlighting")).toObject());
+    from_json(caps.semanticTokensProvider, json.value(QStringLiteral("semanticTokensProvider")));
 }
 
 // follow suit; as performed in kate docmanager
@@ -507,6 +556,23 @@ static QList<LSPSymbolInformation> parseDocumentSymbols(const QJsonValue &result
     return ret;
 }
 
+static QList<LSPWorkspaceSymbol> parseWorkspaceSymbols(const QJsonValue &result)
+{
+    QList<LSPWorkspaceSymbol> ret;
+    for (const auto &info : result.toArray()) {
+        const auto &symbol = info.toObject();
+        auto location = parseLocation(symbol.value(MEMBER_LOCATION).toObject());
+        if (location.uri.isEmpty()) {
+            continue;
+        }
+        auto name = symbol.value(QStringLiteral("name")).toString();
+        auto kind = static_cast<LSPSymbolKind>(symbol.value(MEMBER_KIND).toInt());
+        auto containerName = symbol.value(QStringLiteral("containerName")).toString();
+        ret.push_back({name, kind, location, containerName});
+    }
+    return ret;
+}
+
 static QList<LSPLocation> parseDocumentLocation(const QJsonValue &result)
 {
     QList<LSPLocation> ret;
@@ -528,13 +594,15 @@ static QList<LSPLocation> parseDocumentLocation(const QJsonValue &result)
     return ret;
 }
 
-static QList<LSPCompletionItem> parseDocumentCompletion(const QJsonValue &result)
+static LSPCompletionList parseDocumentCompletion(const QJsonValue &result)
 {
-    QList<LSPCompletionItem> ret;
+    LSPCompletionList ret = {false, {}};
     QJsonArray items = result.toArray();
     // might be CompletionList
     if (items.empty()) {
-        items = result.toObject().value(QStringLiteral("items")).toArray();
+        const auto list = result.toObject();
+        items = list.value(QStringLiteral("items")).toArray();
+        ret.isIncomplete = list.value(QStringLiteral("isIncomplete")).toBool();
     }
     for (const auto &vitem : items) {
         const auto &item = vitem.toObject();
@@ -547,8 +615,11 @@ static QList<LSPCompletionItem> parseDocumentCompletion(const QJsonValue &result
         auto insertText = item.value(QStringLiteral("insertText")).toString();
         if (insertText.isEmpty())
             insertText = label;
+        auto filterText = item.value(QStringLiteral("filterText")).toString();
+        if (filterText.isEmpty())
+            filterText = label;
         auto kind = static_cast<LSPCompletionItemKind>(item.value(MEMBER_KIND).toInt());
-        ret.push_back({label, kind, detail, doc, sortText, insertText});
+        ret.items.push_back({label, kind, detail, doc, sortText, insertText, filterText});
     }
     return ret;
 }
@@ -746,8 +817,136 @@ static LSPSemanticHighlightingParams parseSemanticHighlighting(const QJsonObject
     return ret;
 }
 
+static QVector<quint32> parseSemanticTokensData(const QJsonValue &json)
+{
+    const auto array = json.toArray();
+    QVector<quint32> data;
+    data.reserve(array.size());
+    for (const auto &value : array) {
+        data.push_back(value.toInt());
+    }
+    return data;
+}
+
+static LSPSemanticTokensDelta parseSemanticTokensDelta(const QJsonValue &result)
+{
+    LSPSemanticTokensDelta ret;
+    const auto ob = result.toObject();
+    ret.resultId = ob.value(QStringLiteral("resultId")).toString();
+    const auto edits = ob.value(QStringLiteral("edits"));
+    ret.delta = edits.isArray();
+    if (ret.delta) {
+        for (const auto &vedit : edits.toArray()) {
+            const auto edit = vedit.toObject();
+            ret.edits.push_back({edit.value(MEMBER_START).toInt(), edit.value(QStringLiteral("deleteCount")).toInt(), parseSemanticTokensData(edit.value(QStringLiteral("data")))});
+        }
+    } else {
+        ret.data = parseSemanticTokensData(ob.value(QStringLiteral("data")));
+    }
+    return ret;
+}
+
+static LSPServerCapabilities parseServerCapabilities(const QJsonValue &result)
+{
+    // only parse parts that we use later on
+    LSPServerCapabilities caps;
+    from_json(caps, result.toObject().value(QStringLiteral("capabilities")).toObject());
+    return caps;
+}
+
 using GenericReplyType = QJsonValue;
-using GenericReplyHandler = ReplyHandler<GenericReplyType>;
+
+// a reply is handled in 2 steps;
+// conversion of the json reply runs on the decode thread,
+// the result is then passed to the handler on the gui thread
+struct GenericReplyHandler {
+    using Decoder = std::function<std::shared_ptr<void>(const GenericReplyType &)>;
+    using Handler = std::function<void(const std::shared_ptr<void> &)>;
+
+    GenericReplyHandler(std::nullptr_t = nullptr)
+    {
+    }
+
+    GenericReplyHandler(Decoder d, Handler h)
+        : decode(std::move(d))
+        , handle(std::move(h))
+    {
+    }
+
+    explicit operator bool() const
+    {
+        return bool(handle);
+    }
+
+    Decoder decode;
+    Handler handle;
+};
+
+// generic convert handler
+// sprinkle some connection-like context safety
+// not so likely relevant/needed due to typical sequence of events,
+// but in case the latter would be changed in surprising ways ...
+template<typename ReplyType> static GenericReplyHandler make_handler(const ReplyHandler<ReplyType> &h, const QObject *context, typename utils::identity<std::function<ReplyType(const GenericReplyType &)>>::type c)
+{
+    // empty provided handler leads to empty handler
+    if (!h || !c)
+        return nullptr;
+
+    QPointer<const QObject> ctx(context);
+    return {[c](const GenericReplyType &m) {
+                return std::make_shared<ReplyType>(c(m));
+            },
+            [ctx, h](const std::shared_ptr<void> &m) {
+                if (ctx)
+                    h(*static_cast<const ReplyType *>(m.get()));
+            }};
+}
+
+// scheduling of requests
+enum RequestPriority {
+    // e.g. document symbols, only sent if few requests are pending
+    BackgroundPriority,
+    NormalPriority,
+    // completion and explicit user actions, always sent right away
+    InteractivePriority
+};
+
+enum {
+    // pending requests before normal and background ones are held back
+    MaxPendingRequests = 4,
+    MaxPendingBackgroundRequests = 1
+};
+
+struct RequestPolicy {
+    RequestPriority priority;
+    // a new request of this kind for a document (or the workspace) supersedes the previous one
+    bool supersede;
+};
+
+static RequestPolicy requestPolicy(const QString &method)
+{
+    static const QHash<QString, RequestPolicy> policies = {
+        {QStringLiteral("textDocument/completion"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/signatureHelp"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/definition"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/declaration"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/implementation"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/references"), {InteractivePriority, true}},
+        {QStringLiteral("textDocument/rename"), {InteractivePriority, false}},
+        {QStringLiteral("textDocument/formatting"), {InteractivePriority, false}},
+        {QStringLiteral("textDocument/rangeFormatting"), {InteractivePriority, false}},
+        {QStringLiteral("textDocument/onTypeFormatting"), {InteractivePriority, false}},
+        {QStringLiteral("textDocument/hover"), {NormalPriority, true}},
+        {QStringLiteral("textDocument/documentHighlight"), {NormalPriority, true}},
+        {QStringLiteral("textDocument/codeAction"), {NormalPriority, true}},
+        {QStringLiteral("textDocument/documentSymbol"), {BackgroundPriority, true}},
+        {QStringLiteral("textDocument/semanticTokens/full"), {BackgroundPriority, true}},
+        {QStringLiteral("textDocument/semanticTokens/full/delta"), {BackgroundPriority, true}},
+        {QStringLiteral("textDocument/semanticTokens/range"), {NormalPriority, true}},
+        {QStringLiteral("workspace/symbol"), {InteractivePriority, true}},
+    };
+    return policies.value(method, {NormalPriority, false});
+}
 
 class LSPClientServer::LSPClientServerPrivate
 {
@@ -771,10 +970,40 @@ class LSPClientServer::LSPClientServerPrivate
     // last msg id
     int m_id = 0;
     // receive buffer
-    QByteArray m_receive;
+    LSPMessageBuffer m_receive;
+    // all traffic, if recording was requested
+    LSPMessageLog m_log;
     // registered reply handlers
     // (result handler, error result handler)
-    QHash<int, std::pair<GenericReplyHandler, GenericReplyHandler>> m_handlers;
+    QHash<int, std::pair<GenericReplyHandler::Handler, GenericReplyHandler::Handler>> m_handlers;
+    // json parsing and reply conversion run in this thread, in the context of m_decoder
+    QThread m_decodeThread;
+    QObject *m_decoder;
+    // reply converters, only used in the decode thread
+    // (result decoder, error result decoder)
+    QHash<int, std::pair<GenericReplyHandler::Decoder, GenericReplyHandler::Decoder>> m_decoders;
+    // requests held back by the scheduler, in order of arrival
+    struct QueuedRequest {
+        int id;
+        RequestPriority priority;
+        QString document;
+        QJsonObject msg;
+        GenericReplyHandler h;
+        GenericReplyHandler eh;
+    };
+    QVector<QueuedRequest> m_queue;
+    // latest request per (method, document) for the superseding kinds
+    QHash<QPair<QString, QString>, int> m_latest;
+    // traffic and timing
+    LSPClientMetrics m_metrics;
+    // workspace symbols seen so far
+    LSPClientSymbolCache m_symbols;
+    // method and send time of the requests written and not yet replied
+    struct SentRequest {
+        QString method;
+        QElapsedTimer timer;
+    };
+    QHash<int, SentRequest> m_sent;
     // pending request responses
     static constexpr int MAX_REQUESTS = 5;
     QVector<int> m_requests {MAX_REQUESTS + 1};
@@ -786,15 +1015,25 @@ public:
         , m_root(root)
         , m_langId(langId)
         , m_init(init)
+        , m_decoder(new QObject)
     {
         // setup async reading
         QObject::connect(&m_sproc, &QProcess::readyRead, utils::mem_fun(&self_type::read, this));
         QObject::connect(&m_sproc, &QProcess::stateChanged, utils::mem_fun(&self_type::onStateChanged, this));
+
+        // setup decoding
+        m_decodeThread.setObjectName(QStringLiteral("LSPClientServer decoder"));
+        m_decoder->moveToThread(&m_decodeThread);
+        QObject::connect(&m_decodeThread, &QThread::finished, m_decoder, &QObject::deleteLater);
+        m_decodeThread.start();
     }
 
     ~LSPClientServerPrivate()
     {
         stop(TIMEOUT_SHUTDOWN, TIMEOUT_SHUTDOWN);
+        // pending decoding no longer matters
+        m_decodeThread.quit();
+        m_decodeThread.wait();
     }
 
     const QStringList &cmdline() const
@@ -822,11 +1061,37 @@ public:
         return m_capabilities;
     }
 
+    LSPClientMetrics &metrics()
+    {
+        return m_metrics;
+    }
+
+    LSPClientSymbolCache &symbols()
+    {
+        return m_symbols;
+    }
+
     int cancel(int reqid)
     {
+        // not sent yet, simply forget about it
+        auto it = std::find_if(m_queue.begin(), m_queue.end(), [reqid](const QueuedRequest &r) {
+            return r.id == reqid;
+        });
+        if (it != m_queue.end()) {
+            m_metrics.requestCancelled(it->msg[MEMBER_METHOD].toString());
+            m_queue.erase(it);
+            return -1;
+        }
+
         if (m_handlers.remove(reqid) > 0) {
+            m_metrics.requestCancelled(m_sent.take(reqid).method);
+            toDecoder([this, reqid]() {
+                m_decoders.remove(reqid);
+            });
             auto params = QJsonObject {{MEMBER_ID, reqid}};
             write(init_request(QStringLiteral("$/cancelRequest"), params));
+            // room for the held back ones
+            dispatch();
         }
         return -1;
     }
@@ -852,9 +1117,16 @@ private:
         ob.insert(QStringLiteral("jsonrpc"), QStringLiteral("2.0"));
         // notification == no handler
         if (h) {
-            ob.insert(MEMBER_ID, ++m_id);
-            ret.m_id = m_id;
-            m_handlers[m_id] = {h, eh};
+            // scheduled requests got their id already
+            const int reqid = id ? *id : ++m_id;
+            ob.insert(MEMBER_ID, reqid);
+            ret.m_id = reqid;
+            m_handlers[reqid] = {h.handle, eh.handle};
+            // registered before the request is written, so before any reply arrives
+            const auto decoders = std::make_pair(h.decode, eh.decode);
+            toDecoder([this, reqid, decoders]() {
+                m_decoders[reqid] = decoders;
+            });
         } else if (id) {
             ob.insert(MEMBER_ID, *id);
         }
@@ -862,7 +1134,8 @@ private:
         QJsonDocument json(ob);
         auto sjson = json.toJson();
 
-        qCInfo(LSPCLIENT) << "calling" << msg[MEMBER_METHOD].toString();
+        const auto method = msg[MEMBER_METHOD].toString();
+        qCInfo(LSPCLIENT) << "calling" << method;
         qCDebug(LSPCLIENT) << "sending message:\n" << QString::fromUtf8(sjson);
         // some simple parsers expect length header first
         auto hdr = QStringLiteral(CONTENT_LENGTH ": %1\r\n").arg(sjson.length());
@@ -870,116 +1143,218 @@ private:
         m_sproc.write(hdr.toLatin1());
         m_sproc.write("\r\n");
         m_sproc.write(sjson);
+        m_log.write(LSPMessageLog::Outgoing, sjson);
+
+        // (responses to server requests have no method)
+        if (h) {
+            m_metrics.requestSent(method, sjson.length());
+            auto &sent = m_sent[ret.m_id];
+            sent.method = method;
+            sent.timer.start();
+        } else if (!method.isEmpty()) {
+            m_metrics.notificationSent(method, sjson.length());
+        }
 
         return ret;
     }
 
     RequestHandle send(const QJsonObject &msg, const GenericReplyHandler &h = nullptr, const GenericReplyHandler &eh = nullptr)
     {
-        if (m_state == State::Running)
-            return write(msg, h, eh);
-        else
+        if (m_state != State::Running) {
             qCWarning(LSPCLIENT) << "send for non-running server";
-        return RequestHandle();
+            return RequestHandle();
+        }
+
+        // notifications go out right away
+        if (!h) {
+            return write(msg);
+        }
+
+        RequestHandle ret;
+        ret.m_server = q;
+        ret.m_id = ++m_id;
+
+        const auto method = msg[MEMBER_METHOD].toString();
+        const auto document = msg[MEMBER_PARAMS].toObject().value(QStringLiteral("textDocument")).toObject().value(MEMBER_URI).toString();
+        const auto policy = requestPolicy(method);
+
+        // a pending request of the same kind for the document is obsolete now
+        // (or for the workspace, if not about a document)
+        if (policy.supersede) {
+            int &latest = m_latest[qMakePair(method, document)];
+            if (latest > 0) {
+                qCDebug(LSPCLIENT) << "superseding" << method << latest;
+                cancel(latest);
+            }
+            latest = ret.m_id;
+        }
+
+        m_queue.push_back({ret.m_id, policy.priority, document, msg, h, eh});
+        dispatch();
+        return ret;
     }
 
-    void read()
+    // write held back requests, highest priority first, as long as there is room
+    void dispatch()
     {
-        // accumulate in buffer
-        m_receive.append(m_sproc.readAllStandardOutput());
-
-        // try to get one (or more) message
-        QByteArray &buffer = m_receive;
-
-        while (true) {
-            qCDebug(LSPCLIENT) << "buffer size" << buffer.length();
-            auto header = QByteArray(CONTENT_LENGTH ":");
-            int index = buffer.indexOf(header);
-            if (index < 0) {
-                // avoid collecting junk
-                if (buffer.length() > 1 << 20)
-                    buffer.clear();
-                break;
-            }
-            index += header.length();
-            int endindex = buffer.indexOf("\r\n", index);
-            auto msgstart = buffer.indexOf("\r\n\r\n", index);
-            if (endindex < 0 || msgstart < 0)
+        while (!m_queue.empty() && running()) {
+            auto it = std::max_element(m_queue.begin(), m_queue.end(), [](const QueuedRequest &a, const QueuedRequest &b) {
+                return a.priority < b.priority;
+            });
+            if ((it->priority == NormalPriority && m_handlers.size() >= MaxPendingRequests)
+                || (it->priority == BackgroundPriority && m_handlers.size() >= MaxPendingBackgroundRequests)) {
                 break;
-            msgstart += 4;
-            bool ok = false;
-            auto length = buffer.mid(index, endindex - index).toInt(&ok, 10);
-            // FIXME perhaps detect if no reply for some time
-            // then again possibly better left to user to restart in such case
-            if (!ok) {
-                qCWarning(LSPCLIENT) << "invalid " CONTENT_LENGTH;
-                // flush and try to carry on to some next header
-                buffer.remove(0, msgstart);
-                continue;
-            }
-            // sanity check to avoid extensive buffering
-            if (length > 1 << 29) {
-                qCWarning(LSPCLIENT) << "excessive size";
-                buffer.clear();
-                continue;
             }
-            if (msgstart + length > buffer.length())
-                break;
-            // now onto payload
-            auto payload = buffer.mid(msgstart, length);
-            buffer.remove(0, msgstart + length);
-            qCInfo(LSPCLIENT) << "got message payload size " << length;
-            qCDebug(LSPCLIENT) << "message payload:\n" << payload;
-            QJsonParseError error {};
-            auto msg = QJsonDocument::fromJson(payload, &error);
-            if (error.error != QJsonParseError::NoError || !msg.isObject()) {
-                qCWarning(LSPCLIENT) << "invalid response payload";
-                continue;
-            }
-            auto result = msg.object();
-            // check if it is the expected result
-            int msgid = -1;
-            if (result.contains(MEMBER_ID)) {
-                // allow id to be returned as a string value, happens e.g. for Perl LSP server
-                const auto idValue = result[MEMBER_ID];
-                if (idValue.isString()) {
-                    msgid = idValue.toString().toInt();
-                } else {
-                    msgid = idValue.toInt();
-                }
+            const auto request = *it;
+            m_queue.erase(it);
+            write(request.msg, request.h, request.eh, &request.id);
+        }
+    }
+
+    // write all held back requests for document, they refer to its current content
+    void flush(const QString &document)
+    {
+        QVector<QueuedRequest> queue;
+        queue.swap(m_queue);
+        for (const auto &request : queue) {
+            if (request.document == document) {
+                write(request.msg, request.h, request.eh, &request.id);
             } else {
-                processNotification(result);
-                continue;
+                m_queue.push_back(request);
             }
-            // could be request
-            if (result.contains(MEMBER_METHOD)) {
-                processRequest(result);
-                continue;
+        }
+    }
+
+    template<typename Function> void toDecoder(Function f)
+    {
+        QMetaObject::invokeMethod(m_decoder, std::move(f), Qt::QueuedConnection);
+    }
+
+    template<typename Function> void toGui(Function f)
+    {
+        QMetaObject::invokeMethod(q, std::move(f), Qt::QueuedConnection);
+    }
+
+    void read()
+    {
+        // a full buffer leaves data in the process, read on once messages were taken
+        bool taken = false;
+        do {
+            // accumulate in buffer
+            m_receive.readFrom(&m_sproc);
+
+            // try to get one (or more) message
+            taken = false;
+            QByteArray payload;
+            while (m_receive.takeMessage(payload)) {
+                qCInfo(LSPCLIENT) << "got message payload size " << payload.size();
+                qCDebug(LSPCLIENT) << "message payload:\n" << payload;
+                m_log.write(LSPMessageLog::Incoming, payload);
+                // parse and convert off the gui thread, results come back in order
+                toDecoder([this, payload]() {
+                    decode(payload);
+                });
+                taken = true;
             }
+        } while (taken && m_sproc.bytesAvailable() > 0);
+    }
 
-            // a valid reply; what to do with it now
-            auto it = m_handlers.find(msgid);
-            if (it != m_handlers.end()) {
-                // copy handler to local storage
-                const auto handler = *it;
-
-                // remove handler from our set, do this pre handler execution to avoid races
-                m_handlers.erase(it);
-
-                // run handler, might e.g. trigger some new LSP actions for this server
-                // process and provide error if caller interested,
-                // otherwise reply will resolve to 'empty' response
-                auto &h = handler.first;
-                auto &eh = handler.second;
-                if (result.contains(MEMBER_ERROR) && eh) {
-                    eh(result.value(MEMBER_ERROR));
-                } else {
-                    h(result.value(MEMBER_RESULT));
-                }
+    // runs in the decode thread
+    void decode(const QByteArray &payload)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const int bytes = payload.size();
+
+        QJsonParseError error {};
+        auto msg = QJsonDocument::fromJson(payload, &error);
+        if (error.error != QJsonParseError::NoError || !msg.isObject()) {
+            qCWarning(LSPCLIENT) << "invalid response payload";
+            return;
+        }
+        auto result = msg.object();
+        // check if it is the expected result
+        int msgid = -1;
+        if (result.contains(MEMBER_ID)) {
+            // allow id to be returned as a string value, happens e.g. for Perl LSP server
+            const auto idValue = result[MEMBER_ID];
+            if (idValue.isString()) {
+                msgid = idValue.toString().toInt();
             } else {
-                // could have been canceled
-                qCDebug(LSPCLIENT) << "unexpected reply id" << msgid;
+                msgid = idValue.toInt();
             }
+        } else {
+            const auto method = result[MEMBER_METHOD].toString();
+            const auto notify = processNotification(result);
+            const auto decodeTime = timer.nsecsElapsed() / 1000;
+            toGui([this, method, notify, bytes, decodeTime]() {
+                QElapsedTimer timer;
+                timer.start();
+                if (notify) {
+                    notify();
+                }
+                m_metrics.notificationReceived(method, bytes, decodeTime, timer.nsecsElapsed() / 1000);
+            });
+            return;
+        }
+        // could be request
+        if (result.contains(MEMBER_METHOD)) {
+            toGui([this, result]() {
+                processRequest(result);
+            });
+            return;
+        }
+
+        // a valid reply; convert it, the handler runs in the gui thread
+        auto it = m_decoders.find(msgid);
+        if (it == m_decoders.end()) {
+            // could have been canceled
+            qCDebug(LSPCLIENT) << "unexpected reply id" << msgid;
+            return;
+        }
+        const auto decoders = *it;
+        m_decoders.erase(it);
+
+        // process and provide error if caller interested,
+        // otherwise reply will resolve to 'empty' response
+        const bool isError = result.contains(MEMBER_ERROR) && decoders.second;
+        const auto value = isError ? decoders.second(result.value(MEMBER_ERROR)) : decoders.first(result.value(MEMBER_RESULT));
+        const auto decodeTime = timer.nsecsElapsed() / 1000;
+        toGui([this, msgid, isError, value, bytes, decodeTime]() {
+            deliver(msgid, isError, value, bytes, decodeTime);
+        });
+    }
+
+    void deliver(int msgid, bool isError, const std::shared_ptr<void> &value, int bytes, qint64 decodeTime)
+    {
+        auto it = m_handlers.find(msgid);
+        if (it == m_handlers.end()) {
+            // canceled while being decoded
+            qCDebug(LSPCLIENT) << "unexpected reply id" << msgid;
+            return;
+        }
+
+        // copy handler to local storage
+        const auto handler = *it;
+
+        // remove handler from our set, do this pre handler execution to avoid races
+        m_handlers.erase(it);
+        const auto sent = m_sent.take(msgid);
+        const auto latency = sent.timer.isValid() ? sent.timer.nsecsElapsed() / 1000 : 0;
+
+        // room for the held back ones
+        dispatch();
+
+        // run handler, might e.g. trigger some new LSP actions for this server
+        QElapsedTimer timer;
+        timer.start();
+        if (isError) {
+            handler.second(value);
+        } else {
+            handler.first(value);
+        }
+        if (!sent.method.isEmpty()) {
+            m_metrics.replyReceived(sent.method, bytes, latency, decodeTime, timer.nsecsElapsed() / 1000, isError);
         }
     }
 
@@ -1006,6 +1381,8 @@ private:
     void onStateChanged(QProcess::ProcessState nstate)
     {
         if (nstate == QProcess::NotRunning) {
+            m_queue.clear();
+            m_latest.clear();
             setState(State::None);
         }
     }
@@ -1015,7 +1392,13 @@ private:
         if (m_state == State::Running) {
             qCInfo(LSPCLIENT) << "shutting down" << m_server;
             // cancel all pending
+            m_queue.clear();
+            m_latest.clear();
             m_handlers.clear();
+            m_sent.clear();
+            toDecoder([this]() {
+                m_decoders.clear();
+            });
             // shutdown sequence
             send(init_request(QStringLiteral("shutdown")));
             // maybe we will get/see reply on the above, maybe not
@@ -1026,10 +1409,9 @@ private:
         }
     }
 
-    void onInitializeReply(const QJsonValue &value)
+    void onInitializeReply(const LSPServerCapabilities &capabilities)
     {
-        // only parse parts that we use later on
-        from_json(m_capabilities, value.toObject().value(QStringLiteral("capabilities")).toObject());
+        m_capabilities = capabilities;
         // finish init
         initialized();
     }
@@ -1037,6 +1419,15 @@ private:
     void initialize(LSPClientPlugin *plugin)
     {
         QJsonObject codeAction {{QStringLiteral("codeActionLiteralSupport"), QJsonObject {{QStringLiteral("codeActionKind"), QJsonObject {{QStringLiteral("valueSet"), QJsonArray()}}}}}};
+        // tokens are only requested if enabled, so no need to hide the capability
+        QJsonArray tokenTypes;
+        for (const char *type : {"namespace", "type", "class", "enum", "interface", "struct", "typeParameter", "parameter", "variable", "property", "enumMember", "event", "function", "method", "macro", "keyword", "modifier", "comment", "string", "number", "regexp", "operator"}) {
+            tokenTypes.push_back(QLatin1String(type));
+        }
+        QJsonObject semanticTokens {{QStringLiteral("requests"), QJsonObject {{QStringLiteral("range"), true}, {QStringLiteral("full"), QJsonObject {{QStringLiteral("delta"), true}}}}},
+                                    {QStringLiteral("tokenTypes"), tokenTypes},
+                                    {QStringLiteral("tokenModifiers"), QJsonArray()},
+                                    {QStringLiteral("formats"), QJsonArray {QStringLiteral("relative")}}};
         QJsonObject capabilities {{QStringLiteral("textDocument"),
                                    QJsonObject {{
                                                     QStringLiteral("documentSymbol"),
@@ -1044,6 +1435,7 @@ private:
                                                 },
                                                 {QStringLiteral("publishDiagnostics"), QJsonObject {{QStringLiteral("relatedInformation"), true}}},
                                                 {QStringLiteral("codeAction"), codeAction},
+                                                {QStringLiteral("semanticTokens"), semanticTokens},
                                                 {QStringLiteral("semanticHighlightingCapabilities"), QJsonObject {{QStringLiteral("semanticHighlighting"), !plugin || plugin->m_semanticHighlighting}}}}}};
         // NOTE a typical server does not use root all that much,
         // other than for some corner case (in) requests
@@ -1053,7 +1445,7 @@ private:
                             {QStringLiteral("capabilities"), capabilities},
                             {QStringLiteral("initializationOptions"), m_init}};
         //
-        write(init_request(QStringLiteral("initialize"), params), utils::mem_fun(&self_type::onInitializeReply, this));
+        write(init_request(QStringLiteral("initialize"), params), make_handler<LSPServerCapabilities>(utils::mem_fun(&self_type::onInitializeReply, this), q, parseServerCapabilities));
     }
 
     void initialized()
@@ -1076,6 +1468,14 @@ public:
         // start LSP server in project root
         m_sproc.setWorkingDirectory(m_root.toLocalFile());
 
+        // record the session, e.g. for replay by lspreplayserver
+        const auto recordDir = QString::fromLocal8Bit(qgetenv("LSPCLIENT_RECORD"));
+        if (!recordDir.isEmpty()) {
+            static int count = 0;
+            const auto name = QStringLiteral("%1-%2-%3.lsplog").arg(QFileInfo(program).fileName()).arg(QCoreApplication::applicationPid()).arg(++count);
+            m_log.open(QDir(recordDir).filePath(name));
+        }
+
         // at least we see some errors somewhere then
         m_sproc.setProcessChannelMode(QProcess::ForwardedErrorChannel);
         m_sproc.setReadChannel(QProcess::QProcess::StandardOutput);
@@ -1186,6 +1586,30 @@ public:
         return send(init_request(QStringLiteral("textDocument/codeAction"), params), h);
     }
 
+    RequestHandle workspaceSymbol(const QString &query, const GenericReplyHandler &h)
+    {
+        auto params = QJsonObject {{QStringLiteral("query"), query}};
+        return send(init_request(QStringLiteral("workspace/symbol"), params), h);
+    }
+
+    RequestHandle documentSemanticTokensFull(const QUrl &document, const GenericReplyHandler &h)
+    {
+        auto params = textDocumentParams(document);
+        return send(init_request(QStringLiteral("textDocument/semanticTokens/full"), params), h);
+    }
+
+    RequestHandle documentSemanticTokensFullDelta(const QUrl &document, const QString &previousResultId, const GenericReplyHandler &h)
+    {
+        auto params = semanticTokensDeltaParams(document, previousResultId);
+        return send(init_request(QStringLiteral("textDocument/semanticTokens/full/delta"), params), h);
+    }
+
+    RequestHandle documentSemanticTokensRange(const QUrl &document, const LSPRange &range, const GenericReplyHandler &h)
+    {
+        auto params = semanticTokensRangeParams(document, range);
+        return send(init_request(QStringLiteral("textDocument/semanticTokens/range"), params), h);
+    }
+
     void executeCommand(const QString &command, const QJsonValue &args)
     {
         auto params = executeCommandParams(command, args);
@@ -1201,6 +1625,7 @@ public:
     void didChange(const QUrl &document, int version, const QString &text, const QList<LSPTextDocumentContentChangeEvent> &changes)
     {
         Q_ASSERT(text.isEmpty() || changes.empty());
+        flush(document.toString());
         auto params = textDocumentParams(document, version);
         params[QStringLiteral("contentChanges")] = text.size() ? QJsonArray {QJsonObject {{MEMBER_TEXT, text}}} : to_json(changes);
         send(init_request(QStringLiteral("textDocument/didChange"), params));
@@ -1208,6 +1633,7 @@ public:
 
     void didSave(const QUrl &document, const QString &text)
     {
+        flush(document.toString());
         auto params = textDocumentParams(document);
         params[QStringLiteral("text")] = text;
         send(init_request(QStringLiteral("textDocument/didSave"), params));
@@ -1215,6 +1641,11 @@ public:
 
     void didClose(const QUrl &document)
     {
+        const auto uri = document.toString();
+        flush(uri);
+        for (auto it = m_latest.begin(); it != m_latest.end();) {
+            it = (it.key().second == uri) ? m_latest.erase(it) : std::next(it);
+        }
         auto params = textDocumentParams(document);
         send(init_request(QStringLiteral("textDocument/didClose"), params));
     }
@@ -1225,23 +1656,38 @@ public:
         send(init_request(QStringLiteral("workspace/didChangeConfiguration"), params));
     }
 
-    void processNotification(const QJsonObject &msg)
+    // runs in the decode thread,
+    // returns what emits the corresponding signal, to be run in the gui thread
+    std::function<void()> processNotification(const QJsonObject &msg)
     {
         auto method = msg[MEMBER_METHOD].toString();
         if (method == QLatin1String("textDocument/publishDiagnostics")) {
-            emit q->publishDiagnostics(parseDiagnostics(msg[MEMBER_PARAMS].toObject()));
+            const auto diagnostics = parseDiagnostics(msg[MEMBER_PARAMS].toObject());
+            return [this, diagnostics]() {
+                emit q->publishDiagnostics(diagnostics);
+            };
         } else if (method == QLatin1String("textDocument/semanticHighlighting")) {
-            emit q->semanticHighlighting(parseSemanticHighlighting(msg[MEMBER_PARAMS].toObject()));
+            const auto highlighting = parseSemanticHighlighting(msg[MEMBER_PARAMS].toObject());
+            return [this, highlighting]() {
+                emit q->semanticHighlighting(highlighting);
+            };
         } else if (method == QLatin1String("window/showMessage")) {
-            emit q->showMessage(parseMessage(msg[MEMBER_PARAMS].toObject()));
+            const auto message = parseMessage(msg[MEMBER_PARAMS].toObject());
+            return [this, message]() {
+                emit q->showMessage(message);
+            };
         } else if (method == QLatin1String("window/logMessage")) {
-            emit q->logMessage(parseMessage(msg[MEMBER_PARAMS].toObject()));
+            const auto message = parseMessage(msg[MEMBER_PARAMS].toObject());
+            return [this, message]() {
+                emit q->logMessage(message);
+            };
         } else {
             qCWarning(LSPCLIENT) << "discarding notification" << method;
         }
+        return nullptr;
     }
 
-    GenericReplyHandler prepareResponse(int msgid)
+    ReplyHandler<GenericReplyType> prepareResponse(int msgid)
     {
         // allow limited number of outstanding requests
         auto ctx = QPointer<LSPClientServer>(q);
@@ -1264,7 +1710,7 @@ public:
         return h;
     }
 
-    template<typename ReplyType> static ReplyHandler<ReplyType> responseHandler(const GenericReplyHandler &h, typename utils::identity<std::function<GenericReplyType(const ReplyType &)>>::type c)
+    template<typename ReplyType> static ReplyHandler<ReplyType> responseHandler(const ReplyHandler<GenericReplyType> &h, typename utils::identity<std::function<GenericReplyType(const ReplyType &)>>::type c)
     {
         return [h, c](const ReplyType &m) { h(c(m)); };
     }
@@ -1286,22 +1732,6 @@ public:
     }
 };
 
-// generic convert handler
-// sprinkle some connection-like context safety
-// not so likely relevant/needed due to typical sequence of events,
-// but in case the latter would be changed in surprising ways ...
-template<typename ReplyType> static GenericReplyHandler make_handler(const ReplyHandler<ReplyType> &h, const QObject *context, typename utils::identity<std::function<ReplyType(const GenericReplyType &)>>::type c)
-{
-    // empty provided handler leads to empty handler
-    if (!h || !c)
-        return nullptr;
-
-    QPointer<const QObject> ctx(context);
-    return [ctx, h, c](const GenericReplyType &m) {
-        if (ctx)
-            h(c(m));
-    };
-}
 
 LSPClientServer::LSPClientServer(const QStringList &server, const QUrl &root, const QString &langId, const QJsonValue &init)
     : d(new LSPClientServerPrivate(this, server, root, langId, init))
@@ -1333,6 +1763,21 @@ LSPClientServer::State LSPClientServer::state() const
     return d->state();
 }
 
+const LSPClientMetrics &LSPClientServer::metrics() const
+{
+    return d->metrics();
+}
+
+void LSPClientServer::clearMetrics()
+{
+    d->metrics().clear();
+}
+
+const LSPClientSymbolCache &LSPClientServer::symbols() const
+{
+    return d->symbols();
+}
+
 const LSPServerCapabilities &LSPClientServer::capabilities() const
 {
     return d->capabilities();
@@ -1355,7 +1800,13 @@ int LSPClientServer::cancel(int reqid)
 
 LSPClientServer::RequestHandle LSPClientServer::documentSymbols(const QUrl &document, const QObject *context, const DocumentSymbolsReplyHandler &h, const ErrorReplyHandler &eh)
 {
-    return d->documentSymbols(document, make_handler(h, context, parseDocumentSymbols), make_handler(eh, context, parseResponseError));
+    // also keep them for local workspace symbol queries
+    const DocumentSymbolsReplyHandler handler = [this, document, h](const QList<LSPSymbolInformation> &symbols) {
+        d->symbols().setDocument(normalizeUrl(document), symbols);
+        if (h)
+            h(symbols);
+    };
+    return d->documentSymbols(document, make_handler(handler, context, parseDocumentSymbols), make_handler(eh, context, parseResponseError));
 }
 
 LSPClientServer::RequestHandle LSPClientServer::documentDefinition(const QUrl &document, const LSPPosition &pos, const QObject *context, const DocumentDefinitionReplyHandler &h)
@@ -1423,6 +1874,32 @@ LSPClientServer::RequestHandle LSPClientServer::documentCodeAction(const QUrl &d
     return d->documentCodeAction(document, range, kinds, std::move(diagnostics), make_handler(h, context, parseCodeAction));
 }
 
+LSPClientServer::RequestHandle LSPClientServer::workspaceSymbol(const QString &query, const QObject *context, const WorkspaceSymbolsReplyHandler &h)
+{
+    // results are kept, so later queries can be answered locally right away
+    const WorkspaceSymbolsReplyHandler handler = [this, h](const QList<LSPWorkspaceSymbol> &symbols) {
+        d->symbols().add(symbols);
+        if (h)
+            h(symbols);
+    };
+    return d->workspaceSymbol(query, make_handler(handler, context, parseWorkspaceSymbols));
+}
+
+LSPClientServer::RequestHandle LSPClientServer::documentSemanticTokensFull(const QUrl &document, const QObject *context, const SemanticTokensDeltaReplyHandler &h)
+{
+    return d->documentSemanticTokensFull(document, make_handler(h, context, parseSemanticTokensDelta));
+}
+
+LSPClientServer::RequestHandle LSPClientServer::documentSemanticTokensFullDelta(const QUrl &document, const QString &previousResultId, const QObject *context, const SemanticTokensDeltaReplyHandler &h)
+{
+    return d->documentSemanticTokensFullDelta(document, previousResultId, make_handler(h, context, parseSemanticTokensDelta));
+}
+
+LSPClientServer::RequestHandle LSPClientServer::documentSemanticTokensRange(const QUrl &document, const LSPRange &range, const QObject *context, const SemanticTokensDeltaReplyHandler &h)
+{
+    return d->documentSemanticTokensRange(document, range, make_handler(h, context, parseSemanticTokensDelta));
+}
+
 void LSPClientServer::executeCommand(const QString &command, const QJsonValue &args)
 {
     return d->executeCommand(command, args);
@@ -1435,6 +1912,8 @@ void LSPClientServer::didOpen(const QUrl &document, int version, const QString &
 
 void LSPClientServer::didChange(const QUrl &document, int version, const QString &text, const QList<LSPTextDocumentContentChangeEvent> &changes)
 {
+    // cached symbols stay, slightly off positions until the next documentSymbol reply
+    // still beat nothing; that reply replaces them
     return d->didChange(document, version, text, changes);
 }
 
@@ -1445,6 +1924,8 @@ void LSPClientServer::didSave(const QUrl &document, const QString &text)
 
 void LSPClientServer::didClose(const QUrl &document)
 {
+    // may have been edited without saving, so nothing to rely on
+    d->symbols().removeDocument(normalizeUrl(document));
     return d->didClose(document);
 }
 
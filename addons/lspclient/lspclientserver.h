@@ -8,7 +8,9 @@
 #ifndef LSPCLIENTSERVER_H
 #define LSPCLIENTSERVER_H
 
+#include "lspclientmetrics.h"
 #include "lspclientprotocol.h"
+#include "lspclientsymbolcache.h"
 
 #include <QJsonValue>
 #include <QList>
@@ -50,12 +52,14 @@ using DocumentSymbolsReplyHandler = ReplyHandler<QList<LSPSymbolInformation>>;
 using DocumentDefinitionReplyHandler = ReplyHandler<QList<LSPLocation>>;
 using DocumentHighlightReplyHandler = ReplyHandler<QList<LSPDocumentHighlight>>;
 using DocumentHoverReplyHandler = ReplyHandler<LSPHover>;
-using DocumentCompletionReplyHandler = ReplyHandler<QList<LSPCompletionItem>>;
+using DocumentCompletionReplyHandler = ReplyHandler<LSPCompletionList>;
 using SignatureHelpReplyHandler = ReplyHandler<LSPSignatureHelp>;
 using FormattingReplyHandler = ReplyHandler<QList<LSPTextEdit>>;
 using CodeActionReplyHandler = ReplyHandler<QList<LSPCodeAction>>;
 using WorkspaceEditReplyHandler = ReplyHandler<LSPWorkspaceEdit>;
 using ApplyEditReplyHandler = ReplyHandler<LSPApplyWorkspaceEditResponse>;
+using SemanticTokensDeltaReplyHandler = ReplyHandler<LSPSemanticTokensDelta>;
+using WorkspaceSymbolsReplyHandler = ReplyHandler<QList<LSPWorkspaceSymbol>>;
 
 class LSPClientPlugin;
 
@@ -102,6 +106,13 @@ public:
 
     const LSPServerCapabilities &capabilities() const;
 
+    // traffic and timing of requests and notifications so far
+    const LSPClientMetrics &metrics() const;
+    void clearMetrics();
+
+    // workspace symbols seen in replies so far
+    const LSPClientSymbolCache &symbols() const;
+
     // language
     RequestHandle documentSymbols(const QUrl &document, const QObject *context, const DocumentSymbolsReplyHandler &h, const ErrorReplyHandler &eh = nullptr);
     RequestHandle documentDefinition(const QUrl &document, const LSPPosition &pos, const QObject *context, const DocumentDefinitionReplyHandler &h);
@@ -121,6 +132,12 @@ public:
     RequestHandle documentCodeAction(const QUrl &document, const LSPRange &range, const QList<QString> &kinds, QList<LSPDiagnostic> diagnostics, const QObject *context, const CodeActionReplyHandler &h);
     void executeCommand(const QString &command, const QJsonValue &args);
 
+    RequestHandle workspaceSymbol(const QString &query, const QObject *context, const WorkspaceSymbolsReplyHandler &h);
+
+    RequestHandle documentSemanticTokensFull(const QUrl &document, const QObject *context, const SemanticTokensDeltaReplyHandler &h);
+    RequestHandle documentSemanticTokensFullDelta(const QUrl &document, const QString &previousResultId, const QObject *context, const SemanticTokensDeltaReplyHandler &h);
+    RequestHandle documentSemanticTokensRange(const QUrl &document, const LSPRange &range, const QObject *context, const SemanticTokensDeltaReplyHandler &h);
+
     // sync
     void didOpen(const QUrl &document, int version, const QString &langId, const QString &text);
     // only 1 of text or changes should be non-empty and is considered
@@ -12,9 +12,12 @@
 #include "lspclientservermanager.h"
 
 #include "lspclient_debug.h"
+#include "lspclientcontentchanges.h"
 
 #include <KLocalizedString>
+#include <KTextEditor/Application>
 #include <KTextEditor/Document>
+#include <KTextEditor/Editor>
 #include <KTextEditor/MainWindow>
 #include <KTextEditor/MovingInterface>
 #include <KTextEditor/View>
@@ -31,24 +34,31 @@
 #include <QTime>
 #include <QTimer>
 
-// helper to find a proper root dir for the given document & file name that indicate the root dir
-static QString rootForDocumentAndRootIndicationFileName(KTextEditor::Document *document, const QString &rootIndicationFileName)
-{
-    // search only feasible if document is local file
-    if (!document->url().isLocalFile()) {
-        return QString();
-    }
+// (directory, root indication file name) -> root dir (empty if none)
+typedef QHash<QPair<QString, QString>, QString> RootCache;
 
+// helper to find a proper root dir, starting from the given dir, for file name that indicate the root dir
+static QString rootForDirectoryAndRootIndicationFileName(const QString &path, const QString &rootIndicationFileName, RootCache &cache)
+{
     // search root upwards
-    QDir dir(QFileInfo(document->url().toLocalFile()).absolutePath());
+    QDir dir(path);
     QSet<QString> seenDirectories;
+    QString root;
     while (!seenDirectories.contains(dir.absolutePath())) {
+        // some earlier search came along here already
+        const auto cached = cache.constFind(qMakePair(dir.absolutePath(), rootIndicationFileName));
+        if (cached != cache.constEnd()) {
+            root = *cached;
+            break;
+        }
+
         // update guard
         seenDirectories.insert(dir.absolutePath());
 
         // the file that indicates the root dir is there => all fine
         if (dir.exists(rootIndicationFileName)) {
-            return dir.absolutePath();
+            root = dir.absolutePath();
+            break;
         }
 
         // else: cd up, if possible or abort
@@ -57,8 +67,11 @@ static QString rootForDocumentAndRootIndicationFileName(KTextEditor::Document *d
         }
     }
 
-    // no root found, bad luck
-    return QString();
+    // all directories on the way have the same root (or none, bad luck)
+    for (const auto &path : qAsConst(seenDirectories)) {
+        cache.insert(qMakePair(path, rootIndicationFileName), root);
+    }
+    return root;
 }
 
 #include <memory>
@@ -85,6 +98,11 @@ static QJsonObject merge(const QJsonObject &bottom, const QJsonObject &top)
     return result;
 }
 
+// documents whose full text is only sent when a request needs it, not while editing
+static const int LARGE_DOCUMENT_SIZE = 256 * 1024;
+// interval between syncs of edited documents while no request needs them
+static const int EDIT_SYNC_INTERVAL = 500;
+
 // helper guard to handle revision (un)lock
 struct RevisionGuard {
     QPointer<KTextEditor::Document> m_doc;
@@ -194,18 +212,22 @@ class LSPClientServerManagerImpl : public LSPClientServerManager
         qint64 version;
         bool open : 1;
         bool modified : 1;
+        // changes were dropped in favour of a full text sync
+        bool fullSync : 1;
         // used for incremental update (if non-empty)
         QList<LSPTextDocumentContentChangeEvent> changes;
     };
 
     LSPClientPlugin *m_plugin;
-    KTextEditor::MainWindow *m_mainWindow;
     // merged default and user config
     QJsonObject m_serverConfig;
     // root -> (mode -> server)
     QMap<QUrl, QMap<QString, ServerInfo>> m_servers;
     QHash<KTextEditor::Document *, DocumentInfo> m_docs;
     bool m_incrementalSync = false;
+    // edited documents, synced once the interval has passed (or a request needs them)
+    QSet<KTextEditor::Document *> m_deferredSync;
+    QTimer m_syncTimer;
 
     // highlightingModeRegex => language id
     std::vector<std::pair<QRegularExpression, QString>> m_highlightingModeRegexToLanguageId;
@@ -216,15 +238,42 @@ class LSPClientServerManagerImpl : public LSPClientServerManager
     // (and might get confused if we pass a not so accurate one)
     QHash<QString, bool> m_documentLanguageId;
 
+    // server config as resolved for a language id within a project
+    struct ResolvedServerConfig {
+        bool valid = false;
+        // project config it was resolved with
+        QVariantMap projectMap;
+        // language id after following 'use'
+        QString langId;
+        // merged with global settings, if any config found
+        bool found = false;
+        QJsonObject config;
+    };
+    // (project base dir, language id) -> config
+    QHash<QPair<QString, QString>, ResolvedServerConfig> m_serverConfigCache;
+    // root detection probes the file system, and mostly for documents of the same few dirs
+    RootCache m_rootCache;
+    // project base dir -> project map, of projects to start servers for once config is loaded
+    QHash<QString, QVariantMap> m_pendingProjects;
+
     typedef QVector<QSharedPointer<LSPClientServer>> ServerList;
 
 public:
-    LSPClientServerManagerImpl(LSPClientPlugin *plugin, KTextEditor::MainWindow *mainWin)
+    LSPClientServerManagerImpl(LSPClientPlugin *plugin)
         : m_plugin(plugin)
-        , m_mainWindow(mainWin)
     {
         connect(plugin, &LSPClientPlugin::update, this, &self_type::updateServerConfig);
         QTimer::singleShot(100, this, &self_type::updateServerConfig);
+
+        // a plugin setting, as the manager is shared by all windows
+        m_incrementalSync = plugin->m_incrementalSync;
+        connect(plugin, &LSPClientPlugin::update, this, [this]() {
+            m_incrementalSync = m_plugin->m_incrementalSync;
+        });
+
+        m_syncTimer.setSingleShot(true);
+        m_syncTimer.setInterval(EDIT_SYNC_INTERVAL);
+        connect(&m_syncTimer, &QTimer::timeout, this, &self_type::onSyncTimeout);
     }
 
     ~LSPClientServerManagerImpl() override
@@ -327,9 +376,16 @@ public:
         return useId ? langId : QString();
     }
 
-    void setIncrementalSync(bool inc) override
+    ServerList servers() const override
     {
-        m_incrementalSync = inc;
+        ServerList result;
+        for (const auto &el : m_servers) {
+            for (const auto &si : el) {
+                if (si.server)
+                    result.push_back(si.server);
+            }
+        }
+        return result;
     }
 
     QSharedPointer<LSPClientServer> findServer(KTextEditor::Document *document, bool updatedoc = true) override
@@ -357,6 +413,9 @@ public:
     // restart a specific server or all servers if server == nullptr
     void restart(LSPClientServer *server) override
     {
+        // root indication files may have been added meanwhile
+        m_rootCache.clear();
+
         ServerList servers;
         // find entry for server(s) and move out
         for (auto &m : m_servers) {
@@ -372,6 +431,27 @@ public:
         restart(servers);
     }
 
+    void startServers(const QString &projectBaseDir, const QVariantMap &projectMap) override
+    {
+        // config is loaded a bit after construction
+        if (m_serverConfig.isEmpty()) {
+            m_pendingProjects.insert(projectBaseDir, projectMap);
+            return;
+        }
+
+        const auto projectConfig = QJsonDocument::fromVariant(projectMap).object().value(QStringLiteral("lspclient")).toObject();
+        const auto servers = projectConfig.value(QStringLiteral("servers")).toObject();
+        for (auto it = servers.begin(); it != servers.end(); ++it) {
+            const auto &resolved = serverConfig(projectBaseDir, projectMap, it.key());
+            if (!resolved.found)
+                continue;
+            // same root as a document in the project's base dir ends up with
+            // (which is the one that matters for most servers)
+            const auto root = QUrl::fromLocalFile(serverRoot(resolved.config, projectBaseDir, projectBaseDir));
+            startServer(root, resolved.langId, it.key(), resolved.config);
+        }
+    }
+
     qint64 revision(KTextEditor::Document *doc) override
     {
         auto it = m_docs.find(doc);
@@ -489,55 +569,50 @@ private:
         }
     }
 
-    QSharedPointer<LSPClientServer> _findServer(KTextEditor::Document *document)
+    // the project plugin view of the window showing the document (the active one preferably)
+    static QObject *projectPluginView(KTextEditor::Document *document)
     {
-        // compute the LSP standardized language id, none found => no change
-        auto langId = languageId(document->highlightingMode());
-        if (langId.isEmpty())
-            return nullptr;
-
-        QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
-        const auto projectBase = QDir(projectView ? projectView->property("projectBaseDir").toString() : QString());
-        const auto &projectMap = projectView ? projectView->property("projectMap").toMap() : QVariantMap();
-
-        // merge with project specific
-        auto projectConfig = QJsonDocument::fromVariant(projectMap).object().value(QStringLiteral("lspclient")).toObject();
-        auto serverConfig = merge(m_serverConfig, projectConfig);
-
-        // locate server config
-        QJsonValue config;
-        QSet<QString> used;
-        // reduce langId
-        auto realLangId = langId;
-        while (true) {
-            qCInfo(LSPCLIENT) << "language id " << langId;
-            used << langId;
-            config = serverConfig.value(QStringLiteral("servers")).toObject().value(langId);
-            if (config.isObject()) {
-                const auto &base = config.toObject().value(QStringLiteral("use")).toString();
-                // basic cycle detection
-                if (!base.isEmpty() && !used.contains(base)) {
-                    langId = base;
-                    continue;
+        auto app = KTextEditor::Editor::instance()->application();
+        auto mainWindows = app->mainWindows();
+        auto active = app->activeMainWindow();
+        if (mainWindows.removeOne(active)) {
+            mainWindows.prepend(active);
+        }
+        for (auto mainWindow : qAsConst(mainWindows)) {
+            const auto views = mainWindow->views();
+            for (auto view : views) {
+                if (view->document() == document) {
+                    return mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
                 }
             }
-            break;
         }
+        return active ? active->pluginView(QStringLiteral("kateprojectplugin")) : nullptr;
+    }
 
-        if (!config.isObject())
-            return nullptr;
-
-        // merge global settings
-        serverConfig = merge(serverConfig.value(QStringLiteral("global")).toObject(), config.toObject());
+    // same for all documents of a project, so only resolve again if the project config changed
+    // (comparing is cheap as long as the project did not reload it)
+    const ResolvedServerConfig &serverConfig(const QString &projectBaseDir, const QVariantMap &projectMap, const QString &langId)
+    {
+        auto &resolved = m_serverConfigCache[qMakePair(projectBaseDir, langId)];
+        if (!resolved.valid || resolved.projectMap != projectMap) {
+            resolved = resolveServerConfig(projectMap, langId);
+            resolved.projectMap = projectMap;
+            resolved.valid = true;
+        }
+        return resolved;
+    }
 
+    // root for a server, as configured or as found starting from dir (if any)
+    QString serverRoot(const QJsonObject &serverConfig, const QString &projectBaseDir, const QString &dir)
+    {
         QString rootpath;
         auto rootv = serverConfig.value(QStringLiteral("root"));
         if (rootv.isString()) {
             auto sroot = rootv.toString();
             if (QDir::isAbsolutePath(sroot)) {
                 rootpath = sroot;
-            } else if (!projectBase.isEmpty()) {
-                rootpath = QDir(projectBase).absoluteFilePath(sroot);
+            } else if (!projectBaseDir.isEmpty()) {
+                rootpath = QDir(projectBaseDir).absoluteFilePath(sroot);
             }
         }
 
@@ -546,14 +621,14 @@ private:
          * this is required for some LSP servers like rls that don't handle that on their own like
          * clangd does
          */
-        if (rootpath.isEmpty()) {
+        if (rootpath.isEmpty() && !dir.isEmpty()) {
             const auto fileNamesForDetection = serverConfig.value(QStringLiteral("rootIndicationFileNames"));
             if (fileNamesForDetection.isArray()) {
                 // we try each file name alternative in the listed order
                 // this allows to have preferences
                 for (auto name : fileNamesForDetection.toArray()) {
                     if (name.isString()) {
-                        rootpath = rootForDocumentAndRootIndicationFileName(document, name.toString());
+                        rootpath = rootForDirectoryAndRootIndicationFileName(dir, name.toString(), m_rootCache);
                         if (!rootpath.isEmpty()) {
                             break;
                         }
@@ -566,8 +641,34 @@ private:
         if (rootpath.isEmpty()) {
             rootpath = QDir::homePath();
         }
+        return rootpath;
+    }
 
-        auto root = QUrl::fromLocalFile(rootpath);
+    QSharedPointer<LSPClientServer> _findServer(KTextEditor::Document *document)
+    {
+        // compute the LSP standardized language id, none found => no change
+        auto langId = languageId(document->highlightingMode());
+        if (langId.isEmpty())
+            return nullptr;
+
+        QObject *projectView = projectPluginView(document);
+        const auto projectBaseDir = projectView ? projectView->property("projectBaseDir").toString() : QString();
+        const auto projectMap = projectView ? projectView->property("projectMap").toMap() : QVariantMap();
+
+        const auto &resolved = serverConfig(projectBaseDir, projectMap, langId);
+        if (!resolved.found)
+            return nullptr;
+
+        // search only feasible if document is local file
+        const auto dir = document->url().isLocalFile() ? QFileInfo(document->url().toLocalFile()).absolutePath() : QString();
+        const auto root = QUrl::fromLocalFile(serverRoot(resolved.config, projectBaseDir, dir));
+        const auto &server = startServer(root, resolved.langId, langId, resolved.config);
+        return (server && server->state() == LSPClientServer::State::Running) ? server : nullptr;
+    }
+
+    // the server for root and (resolved) langId, started if not yet so
+    const QSharedPointer<LSPClientServer> &startServer(const QUrl &root, const QString &langId, const QString &realLangId, const QJsonObject &serverConfig)
+    {
         auto &serverinfo = m_servers[root][langId];
         auto &server = serverinfo.server;
         if (!server) {
@@ -601,11 +702,51 @@ private:
                 // leave failcount as-is
             }
         }
-        return (server && server->state() == LSPClientServer::State::Running) ? server : nullptr;
+        return server;
+    }
+
+    ResolvedServerConfig resolveServerConfig(const QVariantMap &projectMap, QString langId)
+    {
+        ResolvedServerConfig result;
+
+        // merge with project specific
+        auto projectConfig = QJsonDocument::fromVariant(projectMap).object().value(QStringLiteral("lspclient")).toObject();
+        auto serverConfig = merge(m_serverConfig, projectConfig);
+
+        // locate server config
+        QJsonValue config;
+        QSet<QString> used;
+        // reduce langId
+        while (true) {
+            qCInfo(LSPCLIENT) << "language id " << langId;
+            used << langId;
+            config = serverConfig.value(QStringLiteral("servers")).toObject().value(langId);
+            if (config.isObject()) {
+                const auto &base = config.toObject().value(QStringLiteral("use")).toString();
+                // basic cycle detection
+                if (!base.isEmpty() && !used.contains(base)) {
+                    langId = base;
+                    continue;
+                }
+            }
+            break;
+        }
+
+        if (config.isObject()) {
+            // merge global settings
+            result.found = true;
+            result.langId = langId;
+            result.config = merge(serverConfig.value(QStringLiteral("global")).toObject(), config.toObject());
+        }
+        return result;
     }
 
     void updateServerConfig()
     {
+        // resolved against the previous config
+        m_serverConfigCache.clear();
+        m_rootCache.clear();
+
         // default configuration, compiled into plugin resource, reading can't fail
         QFile defaultConfigFile(QStringLiteral(":/lspclient/settings.json"));
         defaultConfigFile.open(QIODevice::ReadOnly);
@@ -655,6 +796,13 @@ private:
             }
         }
 
+        // projects loaded meanwhile
+        const auto pending = m_pendingProjects;
+        m_pendingProjects.clear();
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            startServers(it.key(), it.value());
+        }
+
         // we could (but do not) perform restartAll here;
         // for now let's leave that up to user
         // but maybe we do have a server now where not before, so let's signal
@@ -666,7 +814,7 @@ private:
         auto it = m_docs.find(doc);
         if (it == m_docs.end()) {
             KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
-            it = m_docs.insert(doc, {server, miface, doc->url(), 0, false, false, {}});
+            it = m_docs.insert(doc, {server, miface, doc->url(), 0, false, false, false, {}});
             // track document
             connect(doc, &KTextEditor::Document::documentUrlChanged, this, &self_type::untrack, Qt::UniqueConnection);
             connect(doc, &KTextEditor::Document::highlightingModeChanged, this, &self_type::untrack, Qt::UniqueConnection);
@@ -692,6 +840,7 @@ private:
                 it->open = false;
             }
             if (remove) {
+                m_deferredSync.remove(it.key());
                 disconnect(it.key(), nullptr, this, nullptr);
                 it = m_docs.erase(it);
             }
@@ -718,15 +867,31 @@ private:
         _close(doc, false);
     }
 
-    void update(const decltype(m_docs)::iterator &it, bool force)
+    // edit is set for the syncs driven by editing only, other ones precede a request
+    // and always bring the server up to date
+    void update(const decltype(m_docs)::iterator &it, bool force, bool edit = false)
     {
         auto doc = it.key();
         if (it != m_docs.end() && it->server) {
-            it->version = it->movingInterface->revision();
-
             if (!m_incrementalSync) {
                 it->changes.clear();
             }
+            if (it->open && (it->modified || force)) {
+                const int size = doc->totalCharacters();
+                // no use sending pieces that add up to more than the whole
+                if (exceedsFullText(it->changes, size)) {
+                    it->changes.clear();
+                    it->fullSync = true;
+                }
+                // the full text of a large document is left to the next request
+                if (edit && it->changes.empty() && size > LARGE_DOCUMENT_SIZE) {
+                    m_deferredSync.remove(doc);
+                    return;
+                }
+            }
+            m_deferredSync.remove(doc);
+
+            it->version = it->movingInterface->revision();
             if (it->open) {
                 if (it->modified || force) {
                     (it->server)->didChange(it->url, it->version, (it->changes.empty()) ? doc->text() : QString(), it->changes);
@@ -736,6 +901,7 @@ private:
                 it->open = true;
             }
             it->modified = false;
+            it->fullSync = false;
             it->changes.clear();
         }
     }
@@ -759,6 +925,20 @@ private:
         auto it = m_docs.find(doc);
         if (it != m_docs.end()) {
             it->modified = true;
+            // sync at most once per interval while typing
+            if (it->open) {
+                m_deferredSync.insert(doc);
+                if (!m_syncTimer.isActive())
+                    m_syncTimer.start();
+            }
+        }
+    }
+
+    void onSyncTimeout()
+    {
+        const auto docs = m_deferredSync;
+        for (auto doc : docs) {
+            update(m_docs.find(doc), false, true);
         }
     }
 
@@ -768,7 +948,7 @@ private:
             return nullptr;
 
         auto it = m_docs.find(doc);
-        if (it != m_docs.end() && it->server) {
+        if (it != m_docs.end() && it->server && !it->fullSync) {
             const auto &caps = it->server->capabilities();
             if (caps.textDocumentSync == LSPDocumentSyncKind::Incremental) {
                 return &(*it);
@@ -781,16 +961,15 @@ private:
     {
         auto info = getDocumentInfo(doc);
         if (info) {
-            info->changes.push_back({LSPRange {position, position}, text});
+            addChange(info->changes, {position, position}, text, QString());
         }
     }
 
     void onTextRemoved(KTextEditor::Document *doc, const KTextEditor::Range &range, const QString &text)
     {
-        (void)text;
         auto info = getDocumentInfo(doc);
         if (info) {
-            info->changes.push_back({range, QString()});
+            addChange(info->changes, range, QString(), text);
         }
     }
 
@@ -811,14 +990,14 @@ private:
             LSPRange oldrange {{line - 1, 0}, {line + 1, 0}};
             LSPRange newrange {{line - 1, 0}, {line, 0}};
             auto text = doc->text(newrange);
-            info->changes.push_back({oldrange, text});
+            addChange(info->changes, oldrange, text, QString());
         }
     }
 };
 
-QSharedPointer<LSPClientServerManager> LSPClientServerManager::new_(LSPClientPlugin *plugin, KTextEditor::MainWindow *mainWin)
+QSharedPointer<LSPClientServerManager> LSPClientServerManager::new_(LSPClientPlugin *plugin)
 {
-    return QSharedPointer<LSPClientServerManager>(new LSPClientServerManagerImpl(plugin, mainWin));
+    return QSharedPointer<LSPClientServerManager>(new LSPClientServerManagerImpl(plugin));
 }
 
 #include "lspclientservermanager.moc"
@@ -17,7 +17,6 @@
 
 namespace KTextEditor
 {
-class MainWindow;
 class Document;
 class View;
 class MovingInterface;
@@ -33,6 +32,7 @@ class LSPClientRevisionSnapshot;
  * to another component performing an LSP request for a document).
  * So, other than managing servers, it also manages the document-server
  * relationship (and document), what's in a name ...
+ * One instance is shared by all main windows (see LSPClientPlugin::serverManager).
  */
 class LSPClientServerManager : public QObject
 {
@@ -40,7 +40,7 @@ class LSPClientServerManager : public QObject
 
 public:
     // factory method; private implementation by interface
-    static QSharedPointer<LSPClientServerManager> new_(LSPClientPlugin *plugin, KTextEditor::MainWindow *mainWin);
+    static QSharedPointer<LSPClientServerManager> new_(LSPClientPlugin *plugin);
 
     virtual QSharedPointer<LSPClientServer> findServer(KTextEditor::Document *document, bool updatedoc = true) = 0;
 
@@ -50,7 +50,12 @@ public:
 
     virtual void restart(LSPClientServer *server) = 0;
 
-    virtual void setIncrementalSync(bool inc) = 0;
+    // start the servers configured in a project's lspclient section,
+    // so they are up by the time a document needs them
+    virtual void startServers(const QString &projectBaseDir, const QVariantMap &projectMap) = 0;
+
+    // all servers currently managed (some may not be running)
+    virtual QVector<QSharedPointer<LSPClientServer>> servers() const = 0;
 
     // latest sync'ed revision of doc (-1 if N/A)
     virtual qint64 revision(KTextEditor::Document *doc) = 0;
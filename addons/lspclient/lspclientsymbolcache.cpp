@@ -0,0 +1,106 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientsymbolcache.h"
+
+#include <kfts_fuzzy_match.h>
+
+#include <algorithm>
+#include <functional>
+
+LSPClientSymbolCache::Key LSPClientSymbolCache::key(const LSPWorkspaceSymbol &symbol)
+{
+    const auto start = symbol.location.range.start();
+    return {symbol.name, symbol.kind, start.line(), start.column()};
+}
+
+LSPClientSymbolCache::Symbol LSPClientSymbolCache::make(const LSPWorkspaceSymbol &symbol)
+{
+    return {symbol, kfts::fuzzy_char_mask(symbol.name)};
+}
+
+void LSPClientSymbolCache::add(const QList<LSPWorkspaceSymbol> &symbols)
+{
+    for (const auto &symbol : symbols) {
+        auto &known = m_symbols[symbol.location.uri];
+        // typically seen before by a similar query, then only the details may have changed
+        const auto k = key(symbol);
+        auto it = known.find(k);
+        if (it != known.end()) {
+            it->symbol = symbol;
+        } else {
+            known.insert(k, make(symbol));
+            ++m_size;
+        }
+    }
+}
+
+void LSPClientSymbolCache::setDocument(const QUrl &document, const QList<LSPSymbolInformation> &symbols)
+{
+    auto &known = m_symbols[document];
+    m_size -= known.size();
+    known.clear();
+
+    // flatten the hierarchy, a parent is the container of its children
+    std::function<void(const QList<LSPSymbolInformation> &, const QString &)> addSymbols = [&](const QList<LSPSymbolInformation> &list, const QString &container) {
+        for (const auto &symbol : list) {
+            const LSPWorkspaceSymbol s {symbol.name, symbol.kind, {document, symbol.range}, container};
+            known.insert(key(s), make(s));
+            addSymbols(symbol.children, symbol.name);
+        }
+    };
+    addSymbols(symbols, QString());
+
+    m_size += known.size();
+    if (known.isEmpty()) {
+        m_symbols.remove(document);
+    }
+}
+
+void LSPClientSymbolCache::removeDocument(const QUrl &document)
+{
+    auto it = m_symbols.find(document);
+    if (it != m_symbols.end()) {
+        m_size -= it->size();
+        m_symbols.erase(it);
+    }
+}
+
+QVector<LSPClientSymbolCache::Match> LSPClientSymbolCache::find(const QString &pattern, int maxResults) const
+{
+    QVector<Match> matches;
+    if (pattern.isEmpty()) {
+        return matches;
+    }
+
+    const auto mask = kfts::fuzzy_char_mask(pattern);
+    for (const auto &symbols : m_symbols) {
+        for (const auto &symbol : symbols) {
+            int score = 0;
+            if (kfts::fuzzy_match(pattern, mask, symbol.symbol.name, symbol.mask, score)) {
+                matches.push_back({symbol.symbol, score});
+            }
+        }
+    }
+
+    const auto better = [](const Match &a, const Match &b) {
+        return a.score != b.score ? a.score > b.score : a.symbol.name < b.symbol.name;
+    };
+    if (maxResults >= 0 && matches.size() > maxResults) {
+        std::partial_sort(matches.begin(), matches.begin() + maxResults, matches.end(), better);
+        matches.resize(maxResults);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+void LSPClientSymbolCache::clear()
+{
+    m_symbols.clear();
+    m_size = 0;
+}
@@ -0,0 +1,83 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTSYMBOLCACHE_H
+#define LSPCLIENTSYMBOLCACHE_H
+
+#include "lspclientprotocol.h"
+
+#include <QHash>
+#include <QUrl>
+#include <QVector>
+
+/*
+ * The symbols of a server's workspace seen so far, as reported by
+ * workspace/symbol and documentSymbol replies, to answer symbol
+ * queries locally while the server is still busy with them.
+ * Symbols are kept per document; a documentSymbol reply replaces
+ * whatever was known about its document. Edits keep them, positions
+ * may be stale until the next reply; closing the document drops them.
+ */
+class LSPClientSymbolCache
+{
+public:
+    struct Match {
+        LSPWorkspaceSymbol symbol;
+        // see kfts::fuzzy_match
+        int score;
+    };
+
+    // symbols found by a workspace/symbol query
+    void add(const QList<LSPWorkspaceSymbol> &symbols);
+    // all symbols of a document
+    void setDocument(const QUrl &document, const QList<LSPSymbolInformation> &symbols);
+    // forget the symbols of a document, e.g. once it is closed
+    void removeDocument(const QUrl &document);
+
+    // symbols fuzzy matching pattern, best first, at most maxResults
+    QVector<Match> find(const QString &pattern, int maxResults) const;
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    void clear();
+
+private:
+    struct Symbol {
+        LSPWorkspaceSymbol symbol;
+        // see kfts::fuzzy_char_mask
+        quint64 mask;
+    };
+
+    // identifies a symbol within its document
+    struct Key {
+        QString name;
+        LSPSymbolKind kind;
+        int line;
+        int column;
+
+        bool operator==(const Key &other) const
+        {
+            return line == other.line && column == other.column && kind == other.kind && name == other.name;
+        }
+    };
+
+    friend uint qHash(const Key &key, uint seed)
+    {
+        return qHash(key.name, seed) ^ qHash((uint(key.line) << 12) ^ uint(key.column) ^ (uint(key.kind) << 26), seed);
+    }
+
+    static Key key(const LSPWorkspaceSymbol &symbol);
+    static Symbol make(const LSPWorkspaceSymbol &symbol);
+
+    QHash<QUrl, QHash<Key, Symbol>> m_symbols;
+    int m_size = 0;
+};
+
+#endif
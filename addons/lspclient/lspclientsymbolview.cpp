@@ -26,6 +26,7 @@
 #include <memory>
 #include <utility>
 
+#include <fuzzyhighlightdelegate.h>
 #include <kfts_fuzzy_match.h>
 
 class LSPClientViewTrackerImpl : public LSPClientViewTracker
@@ -161,6 +162,7 @@ class LSPClientSymbolViewImpl : public QObject, public LSPClientSymbolView
     // parent ownership
     QPointer<QTreeView> m_symbols;
     QPointer<KLineEdit> m_filter;
+    QPointer<FuzzyHighlightDelegate> m_symbolsDelegate;
     QScopedPointer<QMenu> m_popup;
     // initialized/updated from plugin settings
     // managed by context menu later on
@@ -222,6 +224,10 @@ public:
         m_symbols->setEditTriggers(QAbstractItemView::NoEditTriggers);
         m_symbols->setAllColumnsShowFocus(true);
 
+        // highlight the letters matching the filter in the names
+        m_symbolsDelegate = new FuzzyHighlightDelegate(m_symbols);
+        m_symbols->setItemDelegateForColumn(0, m_symbolsDelegate);
+
         // init filter model once, later we only swap the source model!
         QItemSelectionModel *m = m_symbols->selectionModel();
         m_filterModel.setFilterCaseSensitivity(Qt::CaseInsensitive);
@@ -570,6 +576,8 @@ private Q_SLOTS:
          * filter
          */
         m_filterModel.setFilterString(filterText);
+        m_symbolsDelegate->setFilterString(filterText);
+        m_symbols->viewport()->update();
 
         /**
          * expand
@@ -0,0 +1,238 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclienttransport.h"
+
+#include "lspclient_debug.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+enum {
+    // capacity to start with and to return to once a big message is done
+    InitialCapacity = 1 << 16,
+    ShrinkCapacity = 1 << 22,
+    // sanity checks to avoid extensive buffering
+    MaxHeaderLength = 1 << 20,
+    MaxContentLength = 1 << 29,
+    // largest capacity, holds at least one complete message of the sizes above
+    // and doubling it would overflow an int
+    MaxCapacity = 1 << 30
+};
+
+static const QByteArray contentLengthHeader = QByteArrayLiteral("content-length:");
+
+LSPMessageBuffer::LSPMessageBuffer()
+    : m_data(InitialCapacity, Qt::Uninitialized)
+{
+}
+
+void LSPMessageBuffer::append(const char *data, int size)
+{
+    if (!reserve(size)) {
+        qCWarning(LSPCLIENT) << "excessive size";
+        clear();
+        return;
+    }
+    const int tail = (m_head + m_size) & (m_data.size() - 1);
+    const int first = std::min(size, m_data.size() - tail);
+    std::memcpy(m_data.data() + tail, data, first);
+    std::memcpy(m_data.data(), data + first, size - first);
+    m_size += size;
+}
+
+void LSPMessageBuffer::readFrom(QIODevice *device)
+{
+    // read into the free space of the buffer, no intermediate copy
+    // a full buffer leaves the rest in the device, to be read once messages were taken
+    for (qint64 available = device->bytesAvailable(); available > 0 && m_size < MaxCapacity; available = device->bytesAvailable()) {
+        reserve(int(std::min<qint64>(available, MaxCapacity - m_size)));
+        const int tail = (m_head + m_size) & (m_data.size() - 1);
+        const int room = (tail >= m_head) ? m_data.size() - tail : m_head - tail;
+        const qint64 count = device->read(m_data.data() + tail, std::min<qint64>(available, room));
+        if (count <= 0) {
+            break;
+        }
+        m_size += int(count);
+    }
+}
+
+bool LSPMessageBuffer::takeMessage(QByteArray &payload)
+{
+    while (m_contentLength < 0) {
+        const int headerLength = findHeaderEnd();
+        if (headerLength < 0) {
+            return false;
+        }
+
+        // header is small, take it out and look for the length
+        QByteArray header(headerLength, Qt::Uninitialized);
+        take(header.data(), headerLength);
+        m_scanned = 0;
+        for (const QByteArray &line : header.split('\n')) {
+            const QByteArray field = line.trimmed();
+            if (field.size() > contentLengthHeader.size() && field.left(contentLengthHeader.size()).toLower() == contentLengthHeader) {
+                bool ok = false;
+                m_contentLength = field.mid(contentLengthHeader.size()).trimmed().toInt(&ok, 10);
+                if (!ok) {
+                    m_contentLength = -1;
+                }
+            }
+        }
+
+        if (m_contentLength < 0) {
+            // carry on to some next header
+            qCWarning(LSPCLIENT) << "invalid Content-Length";
+        } else if (m_contentLength > MaxContentLength) {
+            qCWarning(LSPCLIENT) << "excessive size";
+            clear();
+            return false;
+        }
+    }
+
+    if (m_size < m_contentLength) {
+        return false;
+    }
+
+    payload = QByteArray(m_contentLength, Qt::Uninitialized);
+    take(payload.data(), m_contentLength);
+    m_contentLength = -1;
+    return true;
+}
+
+void LSPMessageBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+    m_scanned = 0;
+    m_contentLength = -1;
+    if (m_data.size() > ShrinkCapacity) {
+        m_data = QByteArray(InitialCapacity, Qt::Uninitialized);
+    }
+}
+
+void LSPMessageBuffer::take(char *target, int size)
+{
+    const int first = std::min(size, m_data.size() - m_head);
+    std::memcpy(target, m_data.constData() + m_head, first);
+    std::memcpy(target + first, m_data.constData(), size - first);
+    m_head = (m_head + size) & (m_data.size() - 1);
+    m_size -= size;
+
+    // a big message is done, give back its memory
+    if (m_size == 0) {
+        clear();
+    }
+}
+
+bool LSPMessageBuffer::reserve(int size)
+{
+    // no int overflow in here
+    const qint64 required = qint64(m_size) + size;
+    if (required <= m_data.size()) {
+        return true;
+    }
+    if (required > MaxCapacity) {
+        return false;
+    }
+
+    int capacity = m_data.size();
+    while (capacity < required) {
+        capacity *= 2;
+    }
+
+    // unwrap the content into the new buffer
+    QByteArray data(capacity, Qt::Uninitialized);
+    const int first = std::min(m_size, m_data.size() - m_head);
+    std::memcpy(data.data(), m_data.constData() + m_head, first);
+    std::memcpy(data.data() + first, m_data.constData(), m_size - first);
+    m_data.swap(data);
+    m_head = 0;
+    return true;
+}
+
+int LSPMessageBuffer::findHeaderEnd()
+{
+    // resume the search, the terminator may have started in the part already searched
+    for (int i = std::max(0, m_scanned - 3); i + 3 < m_size; ++i) {
+        if (at(i) == '\r' && at(i + 1) == '\n' && at(i + 2) == '\r' && at(i + 3) == '\n') {
+            return i + 4;
+        }
+    }
+    m_scanned = m_size;
+
+    // avoid collecting junk
+    if (m_size > MaxHeaderLength) {
+        qCWarning(LSPCLIENT) << "discarding data without header";
+        clear();
+    }
+    return -1;
+}
+
+bool LSPMessageLog::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(LSPCLIENT) << "failed to open message log" << fileName << m_file.errorString();
+        return false;
+    }
+    m_timer.start();
+    return true;
+}
+
+void LSPMessageLog::write(Direction direction, const QByteArray &payload)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    const auto header = QByteArray::number(m_timer.elapsed()) + (direction == Incoming ? " in " : " out ") + QByteArray::number(payload.size()) + '\n';
+    m_file.write(header);
+    m_file.write(payload);
+    m_file.write("\n");
+    // so the log is of use even if we do not get to close it
+    m_file.flush();
+}
+
+QVector<LSPMessageLog::Record> LSPMessageLog::read(const QString &fileName, bool *ok)
+{
+    QVector<Record> records;
+    if (ok) {
+        *ok = false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return records;
+    }
+
+    while (!file.atEnd()) {
+        const auto fields = file.readLine().trimmed().split(' ');
+        if (fields.size() != 3 || (fields[1] != "in" && fields[1] != "out")) {
+            return records;
+        }
+        bool okTime = false;
+        bool okLength = false;
+        const qint64 time = fields[0].toLongLong(&okTime);
+        const int length = fields[2].toInt(&okLength);
+        if (!okTime || !okLength || length < 0) {
+            return records;
+        }
+        auto payload = file.read(length);
+        if (payload.size() != length || !file.getChar(nullptr)) {
+            return records;
+        }
+        records.push_back({time, fields[1] == "in" ? Incoming : Outgoing, payload});
+    }
+
+    if (ok) {
+        *ok = true;
+    }
+    return records;
+}
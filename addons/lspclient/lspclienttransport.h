@@ -0,0 +1,110 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTTRANSPORT_H
+#define LSPCLIENTTRANSPORT_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+
+class QIODevice;
+
+/*
+ * Receive side of the JSON-RPC base protocol: a growable ring buffer
+ * that splits the incoming bytes into message payloads.
+ * Header parsing is incremental, it resumes where the last call stopped,
+ * so a big message arriving in many small chunks is scanned only once.
+ * Each payload is copied once, out of the buffer; the buffer itself is never shifted.
+ */
+class LSPMessageBuffer
+{
+public:
+    LSPMessageBuffer();
+
+    // append received data
+    void append(const char *data, int size);
+
+    // read all available data of device into the buffer
+    void readFrom(QIODevice *device);
+
+    // next complete message payload, if any
+    bool takeMessage(QByteArray &payload);
+
+    // buffered bytes
+    int size() const
+    {
+        return m_size;
+    }
+
+    void clear();
+
+private:
+    // byte at offset from the first buffered one
+    char at(int offset) const
+    {
+        return m_data[(m_head + offset) & (m_data.size() - 1)];
+    }
+
+    // copy and drop size bytes from the front
+    void take(char *target, int size);
+
+    // ensure room for size more bytes, false if that would exceed the maximal capacity
+    bool reserve(int size);
+
+    // length of the header including the terminating empty line, -1 if not complete yet
+    int findHeaderEnd();
+
+private:
+    // capacity is a power of 2
+    QByteArray m_data;
+    int m_head = 0;
+    int m_size = 0;
+
+    // header bytes already searched for the terminating empty line
+    int m_scanned = 0;
+    // payload length of the current message, -1 while its header is incomplete
+    int m_contentLength = -1;
+};
+
+/*
+ * Log of the messages exchanged with a server, e.g. to replay a session later on.
+ * Each record is a text line with the time (ms since the log was opened),
+ * the direction (in or out, as seen by the client) and the payload length,
+ * followed by the payload itself and a newline.
+ */
+class LSPMessageLog
+{
+public:
+    enum Direction { Outgoing, Incoming };
+
+    struct Record {
+        qint64 time;
+        Direction direction;
+        QByteArray payload;
+    };
+
+    // start a new log, replacing an existing one
+    bool open(const QString &fileName);
+
+    bool isOpen() const
+    {
+        return m_file.isOpen();
+    }
+
+    void write(Direction direction, const QByteArray &payload);
+
+    // all records of a log, in order
+    static QVector<Record> read(const QString &fileName, bool *ok = nullptr);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_timer;
+};
+
+#endif
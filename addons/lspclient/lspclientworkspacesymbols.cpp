@@ -0,0 +1,285 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspclientworkspacesymbols.h"
+
+#include <KLocalizedString>
+#include <KTextEditor/MainWindow>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QSet>
+#include <QStandardItemModel>
+#include <QTimer>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+#include <fuzzyhighlightdelegate.h>
+
+#include <algorithm>
+
+class LSPClientWorkspaceSymbolsImpl : public LSPClientWorkspaceSymbols
+{
+    Q_OBJECT
+
+    typedef LSPClientWorkspaceSymbolsImpl self_type;
+
+    // results shown, enough to find what one is looking for
+    enum { MaxResults = 200 };
+    // roles of the result items
+    enum { UrlRole = Qt::UserRole, RangeRole, LocationRole };
+
+    QSharedPointer<LSPClientServerManager> m_serverManager;
+    QLineEdit *m_lineEdit;
+    QTreeView *m_treeView;
+    QStandardItemModel *m_model;
+    FuzzyHighlightDelegate *m_delegate;
+    // the servers are only asked once typing pauses
+    QTimer m_requestTimer;
+    QVector<LSPClientServer::RequestHandle> m_handles;
+    // symbols the servers replied for the current query
+    QList<LSPWorkspaceSymbol> m_replied;
+
+    const QIcon m_icon_pkg = QIcon::fromTheme(QStringLiteral("code-block"));
+    const QIcon m_icon_class = QIcon::fromTheme(QStringLiteral("code-class"));
+    const QIcon m_icon_typedef = QIcon::fromTheme(QStringLiteral("code-typedef"));
+    const QIcon m_icon_function = QIcon::fromTheme(QStringLiteral("code-function"));
+    const QIcon m_icon_var = QIcon::fromTheme(QStringLiteral("code-variable"));
+
+public:
+    LSPClientWorkspaceSymbolsImpl(KTextEditor::MainWindow *mainWin, QSharedPointer<LSPClientServerManager> manager)
+        : LSPClientWorkspaceSymbols(mainWin->window())
+        , m_serverManager(std::move(manager))
+    {
+        setWindowFlags(Qt::FramelessWindowHint);
+        setAutoFillBackground(true);
+
+        m_lineEdit = new QLineEdit(this);
+        m_lineEdit->setPlaceholderText(i18n("Workspace symbol"));
+        m_treeView = new QTreeView(this);
+        m_treeView->setHeaderHidden(true);
+        m_treeView->setRootIsDecorated(false);
+        m_treeView->setUniformRowHeights(true);
+        m_treeView->setTextElideMode(Qt::ElideRight);
+        m_model = new QStandardItemModel(this);
+        m_treeView->setModel(m_model);
+        m_delegate = new FuzzyHighlightDelegate(m_treeView);
+        m_delegate->setSecondaryText([](const QModelIndex &index) {
+            return index.data(LocationRole).toString();
+        });
+        m_treeView->setItemDelegate(m_delegate);
+
+        auto layout = new QVBoxLayout(this);
+        layout->setSpacing(0);
+        layout->setContentsMargins(4, 4, 4, 4);
+        layout->addWidget(m_lineEdit);
+        layout->addWidget(m_treeView);
+        setFocusProxy(m_lineEdit);
+
+        m_requestTimer.setSingleShot(true);
+        m_requestTimer.setInterval(100);
+        connect(&m_requestTimer, &QTimer::timeout, this, &self_type::request);
+
+        connect(m_lineEdit, &QLineEdit::textChanged, this, &self_type::onTextChanged);
+        connect(m_lineEdit, &QLineEdit::returnPressed, this, &self_type::activate);
+        connect(m_treeView, &QTreeView::activated, this, &self_type::activate);
+
+        m_lineEdit->installEventFilter(this);
+        m_treeView->installEventFilter(this);
+        hide();
+    }
+
+    void popup() override
+    {
+        // central over the editor area; wide, half as high
+        auto window = parentWidget();
+        const int width = int(window->width() / 2.4);
+        const int height = window->height() / 2;
+        setGeometry((window->width() - width) / 2, (window->height() - height) / 4, width, height);
+
+        m_lineEdit->clear();
+        show();
+        raise();
+        setFocus();
+    }
+
+    bool eventFilter(QObject *obj, QEvent *event) override
+    {
+        if (event->type() == QEvent::KeyPress || event->type() == QEvent::ShortcutOverride) {
+            auto keyEvent = static_cast<QKeyEvent *>(event);
+            const int key = keyEvent->key();
+            const bool navigation = key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown;
+            if (key == Qt::Key_Escape) {
+                keyEvent->accept();
+                dismiss();
+                return true;
+            }
+            // typing goes to the input, navigation to the list
+            if (obj == m_lineEdit && navigation) {
+                QCoreApplication::sendEvent(m_treeView, event);
+                return true;
+            } else if (obj == m_treeView && !navigation && key != Qt::Key_Tab && key != Qt::Key_Backtab && key != Qt::Key_Return && key != Qt::Key_Enter) {
+                QCoreApplication::sendEvent(m_lineEdit, event);
+                return true;
+            }
+        } else if (event->type() == QEvent::FocusOut && !(m_lineEdit->hasFocus() || m_treeView->hasFocus())) {
+            dismiss();
+            return true;
+        }
+        return LSPClientWorkspaceSymbols::eventFilter(obj, event);
+    }
+
+private:
+    // servers that can be asked, running ones only
+    QVector<QSharedPointer<LSPClientServer>> servers() const
+    {
+        QVector<QSharedPointer<LSPClientServer>> result;
+        for (const auto &server : m_serverManager->servers()) {
+            if (server->state() == LSPClientServer::State::Running && server->capabilities().workspaceSymbolProvider) {
+                result.push_back(server);
+            }
+        }
+        return result;
+    }
+
+    void cancel()
+    {
+        m_requestTimer.stop();
+        for (auto &handle : m_handles) {
+            handle.cancel();
+        }
+        m_handles.clear();
+    }
+
+    void dismiss()
+    {
+        cancel();
+        m_replied.clear();
+        m_model->clear();
+        hide();
+    }
+
+    void onTextChanged(const QString &text)
+    {
+        cancel();
+        m_replied.clear();
+        m_delegate->setFilterString(text);
+        // whatever is known already is shown right away
+        refresh();
+        if (!text.isEmpty()) {
+            m_requestTimer.start();
+        }
+    }
+
+    void request()
+    {
+        const auto query = m_lineEdit->text();
+        for (const auto &server : servers()) {
+            m_handles.push_back(server->workspaceSymbol(query, this, [this, query](const QList<LSPWorkspaceSymbol> &symbols) {
+                // the reply also landed in the server's cache
+                if (query == m_lineEdit->text()) {
+                    m_replied += symbols;
+                    refresh();
+                }
+            }));
+        }
+    }
+
+    const QIcon &icon(LSPSymbolKind kind) const
+    {
+        switch (kind) {
+        case LSPSymbolKind::File:
+        case LSPSymbolKind::Module:
+        case LSPSymbolKind::Namespace:
+        case LSPSymbolKind::Package:
+            return m_icon_pkg;
+        case LSPSymbolKind::Class:
+        case LSPSymbolKind::Interface:
+            return m_icon_class;
+        case LSPSymbolKind::Enum:
+            return m_icon_typedef;
+        case LSPSymbolKind::Method:
+        case LSPSymbolKind::Function:
+        case LSPSymbolKind::Constructor:
+            return m_icon_function;
+        default:
+            return m_icon_var;
+        }
+    }
+
+    // fill the list with the best matches from the caches of all servers,
+    // then whatever else the servers consider a match
+    void refresh()
+    {
+        const auto pattern = m_lineEdit->text();
+        QVector<LSPClientSymbolCache::Match> matches;
+        for (const auto &server : servers()) {
+            matches += server->symbols().find(pattern, MaxResults);
+        }
+        std::stable_sort(matches.begin(), matches.end(), [](const LSPClientSymbolCache::Match &a, const LSPClientSymbolCache::Match &b) {
+            return a.score > b.score;
+        });
+        if (matches.size() > MaxResults) {
+            matches.resize(MaxResults);
+        }
+
+        QList<LSPWorkspaceSymbol> symbols;
+        QSet<QString> seen;
+        const auto add = [&symbols, &seen](const LSPWorkspaceSymbol &symbol) {
+            const auto start = symbol.location.range.start();
+            const auto key = QStringLiteral("%1:%2:%3:%4").arg(symbol.location.uri.toString()).arg(start.line()).arg(start.column()).arg(symbol.name);
+            if (!seen.contains(key)) {
+                seen.insert(key);
+                symbols.push_back(symbol);
+            }
+        };
+        for (const auto &match : qAsConst(matches)) {
+            add(match.symbol);
+        }
+        for (const auto &symbol : qAsConst(m_replied)) {
+            if (symbols.size() >= MaxResults) {
+                break;
+            }
+            add(symbol);
+        }
+
+        m_model->clear();
+        for (const auto &symbol : qAsConst(symbols)) {
+            auto item = new QStandardItem(icon(symbol.kind), symbol.name);
+            const auto fileName = QFileInfo(symbol.location.uri.path()).fileName();
+            const auto location = QStringLiteral("%1:%2").arg(fileName).arg(symbol.location.range.start().line() + 1);
+            item->setData(symbol.containerName.isEmpty() ? location : symbol.containerName + QLatin1Char(' ') + location, LocationRole);
+            item->setData(symbol.location.uri, UrlRole);
+            item->setData(QVariant::fromValue<KTextEditor::Range>(symbol.location.range), RangeRole);
+            item->setToolTip(symbol.location.uri.toDisplayString(QUrl::PreferLocalFile));
+            item->setEditable(false);
+            m_model->appendRow(item);
+        }
+        m_treeView->setCurrentIndex(m_model->index(0, 0));
+    }
+
+    void activate()
+    {
+        const auto index = m_treeView->currentIndex();
+        if (!index.isValid()) {
+            return;
+        }
+        const auto url = index.data(UrlRole).toUrl();
+        const auto range = index.data(RangeRole).value<KTextEditor::Range>();
+        dismiss();
+        emit symbolActivated(url, range);
+    }
+};
+
+LSPClientWorkspaceSymbols *LSPClientWorkspaceSymbols::new_(KTextEditor::MainWindow *mainWin, QSharedPointer<LSPClientServerManager> manager)
+{
+    return new LSPClientWorkspaceSymbolsImpl(mainWin, std::move(manager));
+}
+
+#include "lspclientworkspacesymbols.moc"
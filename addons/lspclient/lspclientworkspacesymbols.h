@@ -0,0 +1,38 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPCLIENTWORKSPACESYMBOLS_H
+#define LSPCLIENTWORKSPACESYMBOLS_H
+
+#include "lspclientservermanager.h"
+
+#include <QWidget>
+
+/*
+ * Popup to search the workspace symbols of all running servers.
+ * Answers right away from the servers' symbol caches, and refines
+ * as the servers reply to the workspace/symbol query.
+ */
+class LSPClientWorkspaceSymbols : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // factory method; private implementation by interface
+    static LSPClientWorkspaceSymbols *new_(KTextEditor::MainWindow *mainWin, QSharedPointer<LSPClientServerManager> manager);
+
+    // show over the main window, ready for a new query
+    virtual void popup() = 0;
+
+Q_SIGNALS:
+    void symbolActivated(const QUrl &url, const LSPRange &range);
+
+protected:
+    using QWidget::QWidget;
+};
+
+#endif
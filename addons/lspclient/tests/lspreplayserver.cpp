@@ -0,0 +1,146 @@
+/*  SPDX-License-Identifier: MIT
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+// Plays back a session recorded by the client (see LSPCLIENT_RECORD),
+// acting as the server on stdin/stdout.
+//
+// usage: lspreplayserver <log> [speed]
+//
+// Messages of the client are awaited in the recorded order (matching on method),
+// and the messages of the server are sent with the recorded delays divided by speed
+// (0 for no delays at all). Reply ids are mapped to the ones the client actually used,
+// so the playback does not depend on how many requests the client sent before.
+
+#include "../lspclienttransport.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+static const QString MEMBER_ID = QStringLiteral("id");
+static const QString MEMBER_METHOD = QStringLiteral("method");
+
+// blocks until the client sent a message, false once input is closed
+static bool readMessage(LSPMessageBuffer &buffer, QJsonObject &msg)
+{
+    QByteArray payload;
+    while (!buffer.takeMessage(payload)) {
+        const int c = std::getchar();
+        if (c == EOF) {
+            return false;
+        }
+        const char ch = char(c);
+        buffer.append(&ch, 1);
+    }
+    msg = QJsonDocument::fromJson(payload).object();
+    return true;
+}
+
+static void writeMessage(const QByteArray &payload)
+{
+    std::printf("Content-Length: %d\r\n\r\n", payload.size());
+    std::fwrite(payload.constData(), 1, payload.size(), stdout);
+    std::fflush(stdout);
+}
+
+// ids may be numbers or strings
+static QString idKey(const QJsonValue &id)
+{
+    return id.isString() ? id.toString() : QString::number(id.toInt());
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "usage: lspreplayserver <log> [speed]" << std::endl;
+        return -1;
+    }
+
+    bool ok = false;
+    const auto records = LSPMessageLog::read(QString::fromLocal8Bit(argv[1]), &ok);
+    if (!ok) {
+        std::cerr << "invalid log " << argv[1] << std::endl;
+        return -1;
+    }
+    const double speed = argc > 2 ? QByteArray(argv[2]).toDouble() : 1.0;
+
+    // recorded id of the server's replies, looked up front to keep parsing out of the playback
+    QVector<QJsonValue> replyIds(records.size(), QJsonValue(QJsonValue::Undefined));
+    for (int i = 0; i < records.size(); ++i) {
+        if (records[i].direction == LSPMessageLog::Incoming) {
+            const auto reply = QJsonDocument::fromJson(records[i].payload).object();
+            if (!reply.contains(MEMBER_METHOD)) {
+                replyIds[i] = reply.value(MEMBER_ID);
+            }
+        }
+    }
+
+    LSPMessageBuffer input;
+    QJsonObject msg;
+    // recorded id -> id used by client
+    QHash<QString, QJsonValue> ids;
+    qint64 last = 0;
+
+    for (int i = 0; i < records.size(); ++i) {
+        const auto &record = records[i];
+        if (record.direction == LSPMessageLog::Outgoing) {
+            // wait for the client's counterpart, anything else it sends is of no concern
+            const auto recorded = QJsonDocument::fromJson(record.payload).object();
+            const auto method = recorded.value(MEMBER_METHOD).toString();
+            do {
+                if (!readMessage(input, msg)) {
+                    return 0;
+                }
+            } while (msg.value(MEMBER_METHOD).toString() != method);
+            if (!method.isEmpty() && recorded.contains(MEMBER_ID)) {
+                ids[idKey(recorded.value(MEMBER_ID))] = msg.value(MEMBER_ID);
+            }
+            // the server's reaction is timed from here on
+            last = record.time;
+            continue;
+        }
+
+        if (speed > 0 && record.time > last) {
+            QThread::msleep(static_cast<unsigned long>((record.time - last) / speed));
+        }
+        last = std::max(last, record.time);
+
+        // replies go to the request as the client numbered it
+        // (rewriting a big payload takes a while, so only if really needed)
+        auto payload = record.payload;
+        const auto &replyId = replyIds[i];
+        if (!replyId.isUndefined()) {
+            const auto it = ids.find(idKey(replyId));
+            if (it != ids.end()) {
+                if (*it != replyId) {
+                    auto reply = QJsonDocument::fromJson(payload).object();
+                    reply[MEMBER_ID] = *it;
+                    payload = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+                }
+                ids.erase(it);
+            }
+        }
+        writeMessage(payload);
+    }
+
+    // session done, wait for the client to go away
+    while (readMessage(input, msg)) {
+        if (msg.value(MEMBER_METHOD).toString() == QLatin1String("exit")) {
+            break;
+        }
+    }
+    return 0;
+}
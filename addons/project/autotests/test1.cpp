@@ -7,11 +7,14 @@
 
 #include "test1.h"
 #include "fileutil.h"
+#include "kateprojectcodeanalysiscache.h"
 #include "tools/kateprojectcodeanalysistoolshellcheck.h"
 
 #include <QtTest>
 
+#include <QFile>
 #include <QString>
+#include <QTemporaryDir>
 
 QTEST_MAIN(Test1)
 
@@ -39,4 +42,42 @@ void Test1::testShellCheckParsing()
     QCOMPARE(outList.size(), 4);
 }
 
+void Test1::testCodeAnalysisCache()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString script = dir.filePath(QStringLiteral("script.sh"));
+    const QString cacheFile = dir.filePath(QStringLiteral("cache"));
+
+    QFile file(script);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("echo *\n");
+    file.close();
+
+    const KateProjectCodeAnalysisCache::Diagnostics diagnostics{QStringList{script, QStringLiteral("1"), QStringLiteral("note"), QStringLiteral("glob")}};
+
+    // stored results survive save and load
+    {
+        KateProjectCodeAnalysisCache cache(cacheFile, "shellcheck --format=gcc");
+        cache.store(script, diagnostics);
+        QVERIFY(cache.save());
+    }
+    KateProjectCodeAnalysisCache cache(cacheFile, "shellcheck --format=gcc");
+    QVERIFY(cache.load());
+    KateProjectCodeAnalysisCache::Diagnostics cached;
+    QVERIFY(cache.lookup(script, cached));
+    QCOMPARE(cached, diagnostics);
+
+    // other tool arguments => nothing cached
+    KateProjectCodeAnalysisCache otherCache(cacheFile, "shellcheck --format=tty");
+    QVERIFY(!otherCache.load());
+    QVERIFY(!otherCache.lookup(script, cached));
+
+    // changed content => results are outdated
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write("echo done\n");
+    file.close();
+    QVERIFY(!cache.lookup(script, cached));
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
@@ -21,6 +21,7 @@ public Q_SLOTS:
 private Q_SLOTS:
     void testCommonParent();
     void testShellCheckParsing();
+    void testCodeAnalysisCache();
 };
 
 #endif
@@ -23,8 +23,19 @@
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QPlainTextDocumentLayout>
+#include <QProcess>
 #include <utility>
 
+/**
+ * number of updated files in the index overlay that triggers a compaction
+ */
+static const int IndexOverlayCompactionThreshold = 64;
+
+/**
+ * last files version handed out, shared by all projects
+ */
+static quint64 LastFilesVersion = 0;
+
 KateProject::KateProject(ThreadWeaver::Queue *weaver, KateProjectPlugin *plugin)
     : m_notesDocument(nullptr)
     , m_untrackedDocumentsRoot(nullptr)
@@ -35,6 +46,11 @@ KateProject::KateProject(ThreadWeaver::Queue *weaver, KateProjectPlugin *plugin)
 
 KateProject::~KateProject()
 {
+    /**
+     * abort running background work, it would be discarded anyway
+     */
+    cancelLoad();
+
     saveNotesDocument();
 }
 
@@ -170,21 +186,90 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
             indexDir = QDir::tempPath();
         }
     }
-    auto w = new KateProjectWorker(m_baseDir, indexDir, m_projectMap, force);
-    connect(w, &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone);
-    connect(w, &KateProjectWorker::loadIndexDone, this, &KateProject::loadIndexDone);
-    m_weaver->stream() << w;
+
+    // abort the previous load, if still running
+    cancelLoad();
+    m_loadCancel.reset(new QAtomicInt(0));
+    m_loadIndexDir = indexDir;
+    m_loadForce = force;
+
+    // the index is created in an own job once the tree is there
+    m_loadJob.reset(new KateProjectWorker(m_baseDir, m_projectMap, m_loadCancel));
+    m_loadJob->setPriority(TreeJobPriority + (m_active ? ActiveProjectPriorityBoost : 0));
+    connect(m_loadJob.data(), &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone);
+    m_weaver->enqueue(m_loadJob);
 
     // we are done here
     return true;
 }
 
-void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item)
+void KateProject::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+    rescheduleLoad();
+}
+
+void KateProject::cancelLoad()
+{
+    if (m_loadCancel) {
+        m_loadCancel->storeRelease(1);
+    }
+
+    if (m_loadJob) {
+        m_weaver->dequeue(m_loadJob);
+        m_loadJob.reset();
+    }
+
+    if (m_indexJob) {
+        m_weaver->dequeue(m_indexJob);
+        m_indexJob.reset();
+    }
+}
+
+void KateProject::rescheduleLoad()
 {
+    /**
+     * the queue orders jobs by priority when they are enqueued
+     * jobs that already run are not dequeued and stay as they are
+     */
+    const int boost = m_active ? ActiveProjectPriorityBoost : 0;
+    if (m_loadJob && m_weaver->dequeue(m_loadJob)) {
+        m_loadJob->setPriority(TreeJobPriority + boost);
+        m_weaver->enqueue(m_loadJob);
+    }
+
+    if (m_indexJob && m_weaver->dequeue(m_indexJob)) {
+        m_indexJob->setPriority(IndexJobPriority + boost);
+        m_weaver->enqueue(m_indexJob);
+    }
+}
+
+void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item, KateProjectSharedFilterList filterList)
+{
+    /**
+     * ignore results of an outdated load
+     */
+    if (sender() != m_loadJob.data()) {
+        return;
+    }
+    m_loadJob.reset();
+
     m_model.clear();
     m_model.invisibleRootItem()->appendColumn(topLevel->takeColumn(0));
 
     m_file2Item = std::move(file2Item);
+    m_model.setFileMapping(m_file2Item.data());
+    m_filterList = std::move(filterList);
+    filesChanged();
+
+    /**
+     * only the files of the project are indexed, not the untracked documents added below
+     */
+    const QStringList indexFiles = m_file2Item->keys();
 
     /**
      * readd the documents that are open atm
@@ -195,10 +280,29 @@ void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel
     }
 
     emit modelChanged();
+
+    /**
+     * schedule the index creation, only one index job runs at a time
+     * it shares the queue with the tree jobs of other projects, they have precedence
+     */
+    m_indexJob.reset(new KateProjectIndexWorker(m_baseDir, m_loadIndexDir, m_projectMap, indexFiles, m_loadForce, m_loadCancel));
+    m_indexJob->setPriority(IndexJobPriority + (m_active ? ActiveProjectPriorityBoost : 0));
+    m_indexJob->assignQueuePolicy(m_plugin->indexQueuePolicy());
+    connect(m_indexJob.data(), &KateProjectIndexWorker::loadIndexDone, this, &KateProject::loadIndexDone);
+    connect(m_indexJob.data(), &KateProjectIndexWorker::loadIndexProgress, this, &KateProject::loadIndexProgress);
+    m_weaver->enqueue(m_indexJob);
 }
 
 void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
 {
+    /**
+     * ignore results of an outdated load
+     */
+    if (sender() != m_indexJob.data()) {
+        return;
+    }
+    m_indexJob.reset();
+
     /**
      * move to our project
      */
@@ -210,6 +314,15 @@ void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
     emit indexChanged();
 }
 
+void KateProject::loadIndexProgress(int done, int total)
+{
+    if (sender() != m_indexJob.data()) {
+        return;
+    }
+
+    emit indexProgress(done, total);
+}
+
 QString KateProject::projectLocalFileName(const QString &suffix) const
 {
     /**
@@ -324,6 +437,90 @@ void KateProject::slotModifiedOnDisk(KTextEditor::Document *document, bool isMod
     }
 
     item->slotModifiedOnDisk(document, isModified, reason);
+
+    // changed or created on disk => index is outdated for that file
+    if (reason != KTextEditor::ModificationInterface::OnDiskUnmodified) {
+        updateIndexForFile(m_documents.value(document));
+    }
+}
+
+void KateProject::slotDocumentSaved(KTextEditor::Document *document)
+{
+    updateIndexForFile(m_documents.value(document));
+}
+
+void KateProject::updateIndexForFile(const QString &file)
+{
+    /**
+     * only for files of this project, if we have a valid index
+     */
+    KateProjectItem *item = itemForFile(file);
+    if (!item || item->data(Qt::UserRole + 3).toBool() || !m_projectIndex || !m_projectIndex->isValid()) {
+        return;
+    }
+
+    /**
+     * an older update for this file is obsolete
+     */
+    if (QProcess *running = m_indexUpdates.value(file)) {
+        running->disconnect(this);
+        running->kill();
+        running->deleteLater();
+    }
+
+    /**
+     * run ctags async for just this file, the result is spliced into the index
+     * ignore the result if the index got replaced meanwhile
+     */
+    auto ctags = new QProcess(this);
+    m_indexUpdates[file] = ctags;
+    const KateProjectSharedProjectIndex index = m_projectIndex;
+    connect(ctags, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this, ctags, index, file](int, QProcess::ExitStatus exitStatus) {
+        m_indexUpdates.remove(file);
+        ctags->deleteLater();
+        if (exitStatus != QProcess::NormalExit || index != m_projectIndex) {
+            return;
+        }
+
+        index->updateFile(file, ctags->readAllStandardOutput());
+        if (index->overlaySize() >= IndexOverlayCompactionThreshold) {
+            compactIndex();
+        }
+    });
+    connect(ctags, &QProcess::errorOccurred, this, [this, ctags, file](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            m_indexUpdates.remove(file);
+            ctags->deleteLater();
+        }
+    });
+    ctags->setProcessChannelMode(QProcess::SeparateChannels);
+    ctags->start(QStringLiteral("ctags"), index->updateFileArguments(file));
+}
+
+void KateProject::compactIndex()
+{
+    if (m_indexCompactionRunning || !m_projectIndex) {
+        return;
+    }
+    m_indexCompactionRunning = true;
+
+    /**
+     * write the compacted index in the background from a snapshot of the overlay
+     * switch over in the main thread, if the index is still the same
+     */
+    const KateProjectSharedProjectIndex index = m_projectIndex;
+    const KateProjectIndexOverlay overlay = index->overlaySnapshot();
+    const QString target = index->indexFileName() + QStringLiteral(".compact");
+    auto job = new KateProjectIndexCompactJob(index->indexFileName(), target, overlay);
+    connect(job, &KateProjectIndexCompactJob::compactionDone, this, [this, index, overlay, target](KateProjectSharedSymbolTable symbols) {
+        m_indexCompactionRunning = false;
+        if (symbols && index == m_projectIndex) {
+            index->finishCompaction(target, symbols, overlay);
+        } else {
+            QFile::remove(target);
+        }
+    });
+    m_weaver->stream() << job;
 }
 
 void KateProject::registerDocument(KTextEditor::Document *document)
@@ -339,6 +536,7 @@ void KateProject::registerDocument(KTextEditor::Document *document)
     // if we got one, we are done, else create a dummy!
     if (item) {
         disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+        disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
         disconnect(document,
                    SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
                    this,
@@ -352,6 +550,7 @@ void KateProject::registerDocument(KTextEditor::Document *document)
                 SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
                 this,
                 SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
+        connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
 
         return;
     }
@@ -395,8 +594,10 @@ void KateProject::registerUntrackedDocument(KTextEditor::Document *document)
 
     if (!m_file2Item) {
         m_file2Item = KateProjectSharedQMapStringItem(new QMap<QString, KateProjectItem *>());
+        m_model.setFileMapping(m_file2Item.data());
     }
     (*m_file2Item)[document->url().toLocalFile()] = fileItem;
+    filesChanged();
 }
 
 void KateProject::unregisterDocument(KTextEditor::Document *document)
@@ -406,6 +607,7 @@ void KateProject::unregisterDocument(KTextEditor::Document *document)
     }
 
     disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
 
     const QString &file = m_documents.value(document);
 
@@ -414,12 +616,18 @@ void KateProject::unregisterDocument(KTextEditor::Document *document)
         if (item && item->data(Qt::UserRole + 3).toBool()) {
             unregisterUntrackedItem(item);
             m_file2Item->remove(file);
+            filesChanged();
         }
     }
 
     m_documents.remove(document);
 }
 
+void KateProject::filesChanged()
+{
+    m_filesVersion = ++LastFilesVersion;
+}
+
 void KateProject::unregisterUntrackedItem(const KateProjectItem *item)
 {
     for (int i = 0; i < m_untrackedDocumentsRoot->rowCount(); ++i) {
@@ -8,12 +8,15 @@
 #ifndef KATE_PROJECT_H
 #define KATE_PROJECT_H
 
+#include "kateprojectfiltermodel.h"
 #include "kateprojectindex.h"
 #include "kateprojectitem.h"
 #include <KTextEditor/ModificationInterface>
 #include <QDateTime>
 #include <QMap>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QStandardItemModel>
 #include <QTextDocument>
 
 /**
@@ -29,12 +32,19 @@ Q_DECLARE_METATYPE(KateProjectSharedQMapStringItem)
 typedef QSharedPointer<KateProjectIndex> KateProjectSharedProjectIndex;
 Q_DECLARE_METATYPE(KateProjectSharedProjectIndex)
 
+Q_DECLARE_METATYPE(KateProjectSharedSymbolTable)
+
+Q_DECLARE_METATYPE(KateProjectSharedFilterList)
+
 namespace ThreadWeaver
 {
 class Queue;
 }
 
 class KateProjectPlugin;
+class KateProjectWorker;
+class KateProjectIndexWorker;
+class QProcess;
 
 /**
  * Class representing a project.
@@ -72,6 +82,13 @@ public:
      */
     bool reload(bool force = false);
 
+    /**
+     * Mark this project as the one of the active document.
+     * Its pending loading jobs are started before the ones of other projects.
+     * @param active is this project active?
+     */
+    void setActive(bool active);
+
     /**
      * Accessor to file name.
      * @return file name
@@ -122,7 +139,7 @@ public:
      * Accessor for the model.
      * @return model of this project
      */
-    QStandardItemModel *model()
+    KateProjectModel *model()
     {
         return &m_model;
     }
@@ -136,14 +153,44 @@ public:
         return m_file2Item ? m_file2Item->keys() : QStringList();
     }
 
+    /**
+     * Version of the file list, changes whenever files() changes.
+     * Versions are unique over all projects, allows users of files() to cache derived data.
+     * @return version of the file list
+     */
+    quint64 filesVersion() const
+    {
+        return m_filesVersion;
+    }
+
+    /**
+     * Flat list of the items of the loaded project tree, to filter it in the background.
+     * Does not cover the untracked documents.
+     * @return filter list, null if the project is not loaded yet
+     */
+    KateProjectSharedFilterList filterList() const
+    {
+        return m_filterList;
+    }
+
+    /**
+     * Queue for the background jobs of this project.
+     * @return job queue
+     */
+    ThreadWeaver::Queue *weaver() const
+    {
+        return m_weaver;
+    }
+
     /**
      * get item for file
+     * creates the item and its parent directories, if not already done
      * @param file file to get item for
      * @return item for given file or 0
      */
     KateProjectItem *itemForFile(const QString &file)
     {
-        return m_file2Item ? m_file2Item->value(file) : nullptr;
+        return m_model.itemForFile(file);
     }
 
     /**
@@ -197,8 +244,9 @@ private Q_SLOTS:
      * Used for worker to send back the results of project loading
      * @param topLevel new toplevel element for model
      * @param file2Item new file => item mapping
+     * @param filterList flat list of the items of topLevel
      */
-    void loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item);
+    void loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item, KateProjectSharedFilterList filterList);
 
     /**
      * Used for worker to send back the results of index loading
@@ -206,10 +254,19 @@ private Q_SLOTS:
      */
     void loadIndexDone(KateProjectSharedProjectIndex projectIndex);
 
+    /**
+     * Used for worker to report index creation progress
+     * @param done finished ctags runs
+     * @param total total ctags runs
+     */
+    void loadIndexProgress(int done, int total);
+
     void slotModifiedChanged(KTextEditor::Document *);
 
     void slotModifiedOnDisk(KTextEditor::Document *document, bool isModified, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason);
 
+    void slotDocumentSaved(KTextEditor::Document *document);
+
 Q_SIGNALS:
     /**
      * Emitted on project map changes.
@@ -229,11 +286,45 @@ Q_SIGNALS:
      */
     void indexChanged();
 
+    /**
+     * Emitted while the index is created.
+     * @param done finished ctags runs
+     * @param total total ctags runs
+     */
+    void indexProgress(int done, int total);
+
 private:
     void registerUntrackedDocument(KTextEditor::Document *document);
     void unregisterUntrackedItem(const KateProjectItem *item);
+
+    /**
+     * the file list did change, new files version
+     */
+    void filesChanged();
+
     QVariantMap readProjectFile() const;
 
+    /**
+     * Re-run ctags for one file and update the index with the result.
+     * @param file file that changed
+     */
+    void updateIndexForFile(const QString &file);
+
+    /**
+     * Fold the updated files into the index file in the background.
+     */
+    void compactIndex();
+
+    /**
+     * Stop pending loading jobs, running ones will discard their results.
+     */
+    void cancelLoad();
+
+    /**
+     * Requeue pending loading jobs with priorities matching our active state.
+     */
+    void rescheduleLoad();
+
 private:
     /**
      * Last modification time of the project file
@@ -263,13 +354,24 @@ private:
     /**
      * standard item model with content of this project
      */
-    QStandardItemModel m_model;
+    KateProjectModel m_model;
 
     /**
      * mapping files => items
+     * files without item yet map to the directory that will create it
      */
     KateProjectSharedQMapStringItem m_file2Item;
 
+    /**
+     * version of the file list, see filesVersion()
+     */
+    quint64 m_filesVersion = 0;
+
+    /**
+     * flat list of the project tree, see filterList()
+     */
+    KateProjectSharedFilterList m_filterList;
+
     /**
      * project index, if any
      */
@@ -292,6 +394,42 @@ private:
 
     ThreadWeaver::Queue *m_weaver;
 
+    /**
+     * cancel flag of the currently running worker, if any
+     */
+    KateProjectIndexCancelFlag m_loadCancel;
+
+    /**
+     * pending or running job building the project tree
+     */
+    QSharedPointer<KateProjectWorker> m_loadJob;
+
+    /**
+     * pending or running job creating the index
+     */
+    QSharedPointer<KateProjectIndexWorker> m_indexJob;
+
+    /**
+     * index settings of the current load, used once the tree is there
+     */
+    QString m_loadIndexDir;
+    bool m_loadForce = false;
+
+    /**
+     * is this the project of the active document?
+     */
+    bool m_active = false;
+
+    /**
+     * running ctags processes for updates of single files
+     */
+    QHash<QString, QPointer<QProcess>> m_indexUpdates;
+
+    /**
+     * is an index compaction running?
+     */
+    bool m_indexCompactionRunning = false;
+
     /**
      * project configuration (read from file or injected)
      */
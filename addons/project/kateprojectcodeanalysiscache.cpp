@@ -0,0 +1,147 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2021 agent <agent@local>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "kateprojectcodeanalysiscache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+
+/**
+ * bump if the file format changes
+ */
+static const quint32 CacheVersion = 1;
+
+KateProjectCodeAnalysisCache::KateProjectCodeAnalysisCache(const QString &fileName, const QByteArray &toolKey)
+    : m_fileName(fileName)
+    , m_toolKey(toolKey)
+{
+}
+
+bool KateProjectCodeAnalysisCache::load()
+{
+    m_entries.clear();
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 version = 0;
+    QByteArray toolKey;
+    stream >> version >> toolKey;
+    if (version != CacheVersion || toolKey != m_toolKey) {
+        return false;
+    }
+
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString fileName;
+        Entry entry;
+        stream >> fileName >> entry.size >> entry.modified >> entry.hash >> entry.diagnostics;
+        m_entries.insert(fileName, entry);
+    }
+
+    /**
+     * truncated or corrupt => start from scratch
+     */
+    if (stream.status() != QDataStream::Ok) {
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool KateProjectCodeAnalysisCache::save() const
+{
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << CacheVersion << m_toolKey << quint32(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        stream << it.key() << it->size << it->modified << it->hash << it->diagnostics;
+    }
+    return file.commit();
+}
+
+bool KateProjectCodeAnalysisCache::lookup(const QString &file, Diagnostics &diagnostics)
+{
+    auto it = m_entries.find(file);
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    /**
+     * same size and time => unchanged, else compare the content
+     */
+    const QFileInfo info(file);
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    if (info.size() != it->size || modified != it->modified) {
+        if (contentHash(file) != it->hash) {
+            m_entries.erase(it);
+            return false;
+        }
+        it->size = info.size();
+        it->modified = modified;
+    }
+
+    diagnostics = it->diagnostics;
+    return true;
+}
+
+void KateProjectCodeAnalysisCache::store(const QString &file, const Diagnostics &diagnostics)
+{
+    const QFileInfo info(file);
+    const QByteArray hash = contentHash(file);
+    if (hash.isEmpty()) {
+        m_entries.remove(file);
+        return;
+    }
+
+    m_entries.insert(file, {info.size(), info.lastModified().toMSecsSinceEpoch(), hash, diagnostics});
+}
+
+void KateProjectCodeAnalysisCache::retain(const QStringList &files)
+{
+    QSet<QString> keep;
+    keep.reserve(files.size());
+    for (const QString &file : files) {
+        keep.insert(file);
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (keep.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_entries.erase(it);
+        }
+    }
+}
+
+QByteArray KateProjectCodeAnalysisCache::contentHash(const QString &file)
+{
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&input);
+    return hash.result();
+}
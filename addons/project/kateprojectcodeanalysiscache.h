@@ -0,0 +1,92 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2021 agent <agent@local>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef KATE_PROJECT_CODE_ANALYSIS_CACHE_H
+#define KATE_PROJECT_CODE_ANALYSIS_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Persistent cache of code analysis results per file.
+ * Results stay valid as long as the file content and the tool arguments are the same.
+ */
+class KateProjectCodeAnalysisCache
+{
+public:
+    /**
+     * parsed tool output lines: file, line, severity, message
+     */
+    typedef QVector<QStringList> Diagnostics;
+
+    /**
+     * Construct empty cache.
+     * @param fileName file to load the cache from and save it to
+     * @param toolKey tool and its arguments, a cache file written for another key is ignored
+     */
+    KateProjectCodeAnalysisCache(const QString &fileName, const QByteArray &toolKey);
+
+    /**
+     * Load the cache file, if any.
+     * @return success, false if not readable or written for another tool key
+     */
+    bool load();
+
+    /**
+     * Save the cache file.
+     * @return success
+     */
+    bool save() const;
+
+    /**
+     * Get the cached results of a file, if it did not change since they were stored.
+     * @param file file to get results for
+     * @param diagnostics cached results
+     * @return true if the cached results are valid
+     */
+    bool lookup(const QString &file, Diagnostics &diagnostics);
+
+    /**
+     * Store the results of a file for its current content.
+     * @param file analyzed file
+     * @param diagnostics results of the analysis
+     */
+    void store(const QString &file, const Diagnostics &diagnostics);
+
+    /**
+     * Drop the entries of all other files, e.g. removed from the project.
+     * @param files files to keep
+     */
+    void retain(const QStringList &files);
+
+private:
+    /**
+     * cached results of one file
+     * size and modification time avoid to hash unchanged files
+     */
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        QByteArray hash;
+        Diagnostics diagnostics;
+    };
+
+    /**
+     * hash of the content of the given file, empty if not readable
+     */
+    static QByteArray contentHash(const QString &file);
+
+private:
+    const QString m_fileName;
+    const QByteArray m_toolKey;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif
@@ -35,3 +35,18 @@ void KateProjectCodeAnalysisTool::setActualFilesCount(int count)
 {
     m_filesCount = count;
 }
+
+void KateProjectCodeAnalysisTool::setFiles(const QStringList &files)
+{
+    m_files = files;
+    m_hasFiles = true;
+}
+
+QStringList KateProjectCodeAnalysisTool::filesToAnalyze() const
+{
+    if (m_hasFiles) {
+        return m_files;
+    }
+
+    return m_project ? filter(m_project->files()) : QStringList();
+}
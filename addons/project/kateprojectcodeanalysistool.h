@@ -116,8 +116,28 @@ public:
      */
     void setActualFilesCount(int count);
 
+    /**
+     * Restrict arguments() and stdinMessages() to the given files,
+     * e.g. to run the tool in parallel on parts of the project.
+     * Without this, all relevant project files are analyzed.
+     * @param files files to analyze, already filtered
+     */
+    void setFiles(const QStringList &files);
+
+protected:
+    /**
+     * @return files to analyze, the ones passed to setFiles() or else the filtered project files
+     */
+    QStringList filesToAnalyze() const;
+
 private:
     int m_filesCount = 0;
+
+    /**
+     * files passed to setFiles(), if any
+     */
+    QStringList m_files;
+    bool m_hasFiles = false;
 };
 
 Q_DECLARE_METATYPE(KateProjectCodeAnalysisTool *)
@@ -12,6 +12,7 @@
 #include <KLocalizedString>
 
 #include <QIcon>
+#include <QSet>
 
 KateProjectCompletion::KateProjectCompletion(KateProjectPlugin *plugin)
     : KTextEditor::CodeCompletionModel(nullptr)
@@ -46,7 +47,7 @@ QVariant KateProjectCompletion::data(const QModelIndex &index, int role) const
     }
 
     if (index.column() == KTextEditor::CodeCompletionModel::Name && role == Qt::DisplayRole) {
-        return m_matches.item(index.row())->data(Qt::DisplayRole);
+        return m_matches.at(index.row());
     }
 
     if (index.column() == KTextEditor::CodeCompletionModel::Icon && role == Qt::DecorationRole) {
@@ -79,7 +80,7 @@ QModelIndex KateProjectCompletion::index(int row, int column, const QModelIndex
         return QModelIndex();
     }
 
-    if (row < 0 || row >= m_matches.rowCount() || column < 0 || column >= ColumnCount) {
+    if (row < 0 || row >= m_matches.size() || column < 0 || column >= ColumnCount) {
         return QModelIndex();
     }
 
@@ -88,12 +89,12 @@ QModelIndex KateProjectCompletion::index(int row, int column, const QModelIndex
 
 int KateProjectCompletion::rowCount(const QModelIndex &parent) const
 {
-    if (!parent.isValid() && !(m_matches.rowCount() == 0)) {
+    if (!parent.isValid() && !m_matches.isEmpty()) {
         return 1; // One root node to define the custom group
     } else if (parent.parent().isValid()) {
         return 0; // Completion-items have no children
     } else {
-        return m_matches.rowCount();
+        return m_matches.size();
     }
 }
 
@@ -164,7 +165,7 @@ void KateProjectCompletion::completionInvoked(KTextEditor::View *view, const KTe
 
 // Scan throughout the entire document for possible completions,
 // ignoring any dublets
-void KateProjectCompletion::allMatches(QStandardItemModel &model, KTextEditor::View *view, const KTextEditor::Range &range) const
+void KateProjectCompletion::allMatches(QStringList &matches, KTextEditor::View *view, const KTextEditor::Range &range) const
 {
     /**
      * get project scope for this document, else fail
@@ -181,10 +182,21 @@ void KateProjectCompletion::allMatches(QStandardItemModel &model, KTextEditor::V
 
     /**
      * let project index fill the completion for this document
+     * names can be in multiple projects, show them once
      */
+    const QString word = view->document()->text(range);
+    QSet<QString> guard;
     for (const auto &project : projects) {
-        if (project->projectIndex()) {
-            project->projectIndex()->findMatches(model, view->document()->text(range), KateProjectIndex::CompletionMatches);
+        if (!project->projectIndex()) {
+            continue;
+        }
+
+        const auto symbols = project->projectIndex()->findSymbols(word, KateProjectSymbolTable::PrefixMatch | KateProjectSymbolTable::UniqueNames);
+        for (const auto &symbol : symbols) {
+            if (!guard.contains(symbol.name)) {
+                guard.insert(symbol.name);
+                matches.append(symbol.name);
+            }
         }
     }
 }
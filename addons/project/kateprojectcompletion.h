@@ -13,7 +13,7 @@
 #include <ktexteditor/codecompletionmodelcontrollerinterface.h>
 #include <ktexteditor/view.h>
 
-#include <QStandardItemModel>
+#include <QStringList>
 
 /**
  * Project wide completion support.
@@ -62,7 +62,7 @@ public:
 
     KTextEditor::Range completionRange(KTextEditor::View *view, const KTextEditor::Cursor &position) override;
 
-    void allMatches(QStandardItemModel &model, KTextEditor::View *view, const KTextEditor::Range &range) const;
+    void allMatches(QStringList &matches, KTextEditor::View *view, const KTextEditor::Range &range) const;
 
 private:
     /**
@@ -71,9 +71,9 @@ private:
     KateProjectPlugin *m_plugin;
 
     /**
-     * model with matching data
+     * matching names, each only once
      */
-    QStandardItemModel m_matches;
+    QStringList m_matches;
 
     /**
      * automatic invocation?
@@ -0,0 +1,129 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2021 agent <agent@local>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "kateprojectfiltermodel.h"
+#include "kateprojectitem.h"
+
+#include <QStandardItem>
+
+#include <kfts_fuzzy_match.h>
+
+KateProjectSharedFilterList KateProjectFilterList::build(QStandardItem *root)
+{
+    QSharedPointer<KateProjectFilterList> list(new KateProjectFilterList());
+
+    QVector<QPair<QStandardItem *, int>> stack;
+    stack.append(qMakePair(root, -1));
+    while (!stack.isEmpty()) {
+        const auto parent = stack.takeLast();
+        for (int row = 0; row < parent.first->rowCount(); ++row) {
+            KateProjectItem *item = static_cast<KateProjectItem *>(parent.first->child(row));
+            const int id = list->add(parent.second, item->text());
+            stack.append(qMakePair(static_cast<QStandardItem *>(item), id));
+
+            /**
+             * files without items yet, one item per path component, like fetchChildren() would create them
+             */
+            for (const auto &lazyFile : item->lazyFiles()) {
+                int pathId = id;
+                for (const auto &name : lazyFile.path.split(QLatin1Char('/'))) {
+                    pathId = list->add(pathId, name);
+                }
+            }
+        }
+    }
+
+    return list;
+}
+
+int KateProjectFilterList::add(int parent, const QString &name)
+{
+    const auto key = qMakePair(parent, name);
+    const auto it = ids.constFind(key);
+    if (it != ids.constEnd()) {
+        return *it;
+    }
+
+    const int id = names.size();
+    names.append(name);
+    masks.append(kfts::fuzzy_char_mask(name));
+    parents.append(parent);
+    ids.insert(key, id);
+    return id;
+}
+
+void KateProjectFilterProxyModel::setFilter(const KateProjectSharedFilterList &list, std::vector<quint64> accepted, const QString &pattern)
+{
+    m_list = list;
+    m_accepted = std::move(accepted);
+    m_pattern = pattern;
+    m_patternMask = kfts::fuzzy_char_mask(pattern);
+    invalidateFilter();
+}
+
+void KateProjectFilterProxyModel::clearFilter()
+{
+    if (!m_list) {
+        return;
+    }
+
+    m_list.clear();
+    m_accepted.clear();
+    m_pattern.clear();
+    invalidateFilter();
+}
+
+void KateProjectFilterProxyModel::refilter()
+{
+    if (m_list) {
+        invalidateFilter();
+    }
+}
+
+int KateProjectFilterProxyModel::itemId(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) {
+        return -1;
+    }
+
+    const int parent = itemId(sourceIndex.parent());
+    if (parent < -1) {
+        return parent;
+    }
+
+    const int id = m_list->find(parent, sourceIndex.data(Qt::DisplayRole).toString());
+    return (id < 0) ? -2 : id;
+}
+
+bool KateProjectFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (!m_list) {
+        return true;
+    }
+
+    const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    const int id = itemId(index);
+    if (id >= 0) {
+        return (m_accepted[id / 64] >> (id % 64)) & 1;
+    }
+
+    /**
+     * items not in the list, e.g. untracked documents, are few: match them here
+     * shown if they match or one of their children does
+     */
+    const QString name = index.data(Qt::DisplayRole).toString();
+    int score = 0;
+    if (kfts::fuzzy_match(m_pattern, m_patternMask, name, kfts::fuzzy_char_mask(name), score)) {
+        return true;
+    }
+    for (int row = 0; row < sourceModel()->rowCount(index); ++row) {
+        if (filterAcceptsRow(row, index)) {
+            return true;
+        }
+    }
+    return false;
+}
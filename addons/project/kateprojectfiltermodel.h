@@ -9,38 +9,121 @@
 #ifndef KATEPROJECTFILTERMODEL_H
 #define KATEPROJECTFILTERMODEL_H
 
+#include <QHash>
+#include <QPair>
+#include <QSharedPointer>
 #include <QSortFilterProxyModel>
-#include <QDebug>
+#include <QVector>
 
-#include <kfts_fuzzy_match.h>
+#include <vector>
 
-class KateProjectFilterProxyModel : public QSortFilterProxyModel
-{
+class QStandardItem;
 
+/**
+ * Flat list of all items of the project tree, to filter them in the background.
+ * Items are identified by their names and their parent, not by the model items,
+ * so it also covers the files of directories whose items are not created yet.
+ * Parents have smaller ids than their children.
+ */
+class KateProjectFilterList
+{
 public:
-    KateProjectFilterProxyModel(QObject* parent = nullptr) :
-        QSortFilterProxyModel(parent)
-    {}
+    /**
+     * Create the list for all items below root, including the files kept by lazy directories.
+     * To be called by the thread owning the items, the returned list can be read by any thread.
+     * @param root root item of the project tree
+     * @return new list
+     */
+    static QSharedPointer<const KateProjectFilterList> build(QStandardItem *root);
 
-    void setFilterString(const QString& string)
+    /**
+     * Get the id of an item.
+     * @param parent id of the parent item, -1 for the root
+     * @param name name of the item, as shown in the tree
+     * @return id of the item, -1 if unknown
+     */
+    int find(int parent, const QString &name) const
     {
-        m_pattern = string;
-        invalidateFilter();
+        return ids.value(qMakePair(parent, name), -1);
     }
 
-protected:
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
-    {
-        if (m_pattern.isEmpty())
-            return true;
+    /**
+     * names of the items, as shown in the tree
+     */
+    QVector<QString> names;
+
+    /**
+     * character masks of the names, see kfts::fuzzy_char_mask
+     */
+    QVector<quint64> masks;
+
+    /**
+     * id of the parent item, -1 for items directly below the root
+     */
+    QVector<int> parents;
+
+    /**
+     * (parent id, name) => id, siblings with the same name share their id
+     */
+    QHash<QPair<int, QString>, int> ids;
+
+private:
+    /**
+     * Get the id of an item, adds it if not there yet.
+     */
+    int add(int parent, const QString &name);
+};
+
+typedef QSharedPointer<const KateProjectFilterList> KateProjectSharedFilterList;
 
-        int score = 0; // unused intentionally
-        QString file = sourceModel()->index(sourceRow, 0, sourceParent).data().toString();
-        return kfts::fuzzy_match(m_pattern, file, score);
+/**
+ * Proxy model for the project tree.
+ * The filtering itself is done in the background over a KateProjectFilterList,
+ * the proxy only gets a bitmap of the accepted items, including their ancestors.
+ * Items the list does not know, like untracked documents, are matched by the proxy.
+ */
+class KateProjectFilterProxyModel : public QSortFilterProxyModel
+{
+public:
+    KateProjectFilterProxyModel(QObject *parent = nullptr)
+        : QSortFilterProxyModel(parent)
+    {
     }
 
+    /**
+     * Show only the accepted items.
+     * @param list list the bitmap is for
+     * @param accepted bit per item id of list
+     * @param pattern pattern the bitmap was matched with
+     */
+    void setFilter(const KateProjectSharedFilterList &list, std::vector<quint64> accepted, const QString &pattern);
+
+    /**
+     * Show all items.
+     */
+    void clearFilter();
+
+    /**
+     * Filter again after items unknown to the list were added or removed.
+     */
+    void refilter();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    /**
+     * Get the list id of an item of the source model.
+     * @param sourceIndex item to get the id for
+     * @return id, -1 for the root, -2 if unknown
+     */
+    int itemId(const QModelIndex &sourceIndex) const;
+
 private:
+    KateProjectSharedFilterList m_list;
+    std::vector<quint64> m_accepted;
     QString m_pattern;
+    quint64 m_patternMask = 0;
 };
 
 #endif // KATEPROJECTFILTERMODEL_H
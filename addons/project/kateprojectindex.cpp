@@ -8,15 +8,29 @@
 #include "kateprojectindex.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QProcess>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <vector>
 
 /**
- * include ctags reading
+ * minimal number of files worth an own ctags process
  */
-#include "ctags/readtags.c"
+static const int MinFilesPerShard = 256;
 
-KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force)
-    : m_ctagsIndexHandle(nullptr)
+KateProjectIndex::KateProjectIndex(const QString &baseDir,
+                                   const QString &indexDir,
+                                   const QStringList &files,
+                                   const QVariantMap &ctagsMap,
+                                   bool force,
+                                   const KateProjectIndexCancelFlag &cancel,
+                                   const KateProjectIndexProgress &progress)
+    : m_cancel(cancel)
+    , m_progress(progress)
 {
     // allow project to override and specify a (re-usable) indexfile
     // otherwise fall-back to a temporary file if nothing specified
@@ -32,21 +46,28 @@ KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexD
         m_ctagsIndexFile.reset(new QTemporaryFile(indexDir + QStringLiteral("/kate.project.ctags")));
     }
 
+    /**
+     * remember extra options, needed for updates of single files, too
+     */
+    const QString keyOptions = QStringLiteral("options");
+    for (const QVariant &optVariant : ctagsMap[keyOptions].toList()) {
+        m_ctagsOptions << optVariant.toString();
+    }
+
     /**
      * load ctags
      */
     loadCtags(files, ctagsMap, force);
+
+    /**
+     * only needed during construction
+     */
+    m_cancel.reset();
+    m_progress = KateProjectIndexProgress();
 }
 
 KateProjectIndex::~KateProjectIndex()
 {
-    /**
-     * delete ctags handle if any
-     */
-    if (m_ctagsIndexHandle) {
-        tagsClose(m_ctagsIndexHandle);
-        m_ctagsIndexHandle = nullptr;
-    }
 }
 
 void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force)
@@ -61,48 +82,251 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
     }
 
     /**
-     * create temporary file
-     * if not possible, fail
+     * a configured index file is reused by later loads, so it must never be left incomplete:
+     * write to a temporary file next to it, that replaces it only once complete
+     * a failed or cancelled run removes the temporary file and keeps the previous index, if any
+     * our own temporary index is not reused, it is written directly
+     */
+    std::unique_ptr<QTemporaryFile> output;
+    if (qobject_cast<QTemporaryFile *>(m_ctagsIndexFile.data())) {
+        if (!m_ctagsIndexFile->open(QIODevice::ReadWrite)) {
+            return;
+        }
+        m_ctagsIndexFile->close();
+    } else {
+        output.reset(new QTemporaryFile(m_ctagsIndexFile->fileName() + QStringLiteral(".XXXXXX")));
+        if (!output->open()) {
+            return;
+        }
+        output->close();
+    }
+    const QString outputName = output ? output->fileName() : m_ctagsIndexFile->fileName();
+    const auto finish = [this, &output]() {
+        if (output) {
+            QFile::remove(m_ctagsIndexFile->fileName());
+            if (!output->rename(m_ctagsIndexFile->fileName())) {
+                return;
+            }
+        }
+        openCtags();
+    };
+
+    /**
+     * split the files into shards, one ctags process per shard
+     * round robin distribution spreads large directories over all shards
+     * allow the project to limit the number of parallel jobs
+     */
+    int jobs = QThread::idealThreadCount();
+    const QVariant jobsValue = ctagsMap.value(QStringLiteral("jobs"));
+    if (!jobsValue.isNull()) {
+        jobs = jobsValue.toInt();
+    }
+    const int shardCount = qBound(1, files.size() / MinFilesPerShard, qMax(1, jobs));
+    QVector<QStringList> shards(shardCount);
+    for (int i = 0; i < files.size(); ++i) {
+        shards[i % shardCount].append(files[i]);
+    }
+
+    /**
+     * one shard: let ctags write the output directly
      */
-    if (!m_ctagsIndexFile->open(QIODevice::ReadWrite)) {
+    if (shardCount == 1) {
+        if (runCtags(shards, QStringList(outputName))) {
+            finish();
+        }
         return;
     }
 
     /**
-     * close file again, other process will use it
+     * else: each shard writes to an own temporary file next to the index
+     * the sorted results are merged afterwards
      */
-    m_ctagsIndexFile->close();
+    const QString shardTemplate = QFileInfo(m_ctagsIndexFile->fileName()).absolutePath() + QStringLiteral("/kate.project.ctags.shard");
+    std::vector<std::unique_ptr<QTemporaryFile>> shardFiles;
+    QStringList outputs;
+    for (int i = 0; i < shardCount; ++i) {
+        shardFiles.emplace_back(new QTemporaryFile(shardTemplate));
+        if (!shardFiles.back()->open()) {
+            return;
+        }
+        shardFiles.back()->close();
+        outputs.append(shardFiles.back()->fileName());
+    }
+
+    if (runCtags(shards, outputs) && mergeCtags(outputs, outputName)) {
+        finish();
+    }
+}
 
+bool KateProjectIndex::runCtags(const QVector<QStringList> &shards, const QStringList &outputs)
+{
     /**
-     * try to run ctags for all files in this project
-     * output to our ctags index file
+     * common arguments, the output file is appended per process
      */
-    QProcess ctags;
     QStringList args;
-    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << m_ctagsIndexFile->fileName() << QStringLiteral("--fields=+K+n");
-    const QString keyOptions = QStringLiteral("options");
-    for (const QVariant &optVariant : ctagsMap[keyOptions].toList()) {
-        args << optVariant.toString();
+    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("--fields=+K+n") << m_ctagsOptions;
+
+    /**
+     * start all processes first, they run in parallel
+     */
+    std::vector<std::unique_ptr<QProcess>> processes;
+    const auto killAll = [&processes]() {
+        for (const auto &ctags : processes) {
+            ctags->kill();
+            ctags->waitForFinished();
+        }
+    };
+    for (int i = 0; i < shards.size(); ++i) {
+        processes.emplace_back(new QProcess());
+        QProcess *ctags = processes.back().get();
+        ctags->start(QStringLiteral("ctags"), QStringList(args) << QStringLiteral("-f") << outputs[i]);
+        if (!ctags->waitForStarted()) {
+            killAll();
+            return false;
+        }
+
+        /**
+         * write files list and close write channel
+         */
+        ctags->write(shards[i].join(QLatin1Char('\n')).toLocal8Bit());
+        ctags->closeWriteChannel();
     }
-    ctags.start(QStringLiteral("ctags"), args);
-    if (!ctags.waitForStarted()) {
-        return;
+
+    /**
+     * wait for done, poll to be able to react on cancel
+     */
+    int done = 0;
+    const int total = processes.size();
+    if (m_progress) {
+        m_progress(done, total);
+    }
+    while (done < total) {
+        if (isCanceled()) {
+            killAll();
+            return false;
+        }
+
+        for (const auto &ctags : processes) {
+            if (ctags->state() == QProcess::NotRunning) {
+                continue;
+            }
+
+            if (ctags->waitForFinished(100 / total + 1) || ctags->state() == QProcess::NotRunning) {
+                ++done;
+                if (m_progress) {
+                    m_progress(done, total);
+                }
+            }
+        }
     }
 
     /**
-     * write files list and close write channel
+     * all processes must have exited normally and successfully
      */
-    ctags.write(files.join(QLatin1Char('\n')).toLocal8Bit());
-    ctags.closeWriteChannel();
+    for (const auto &ctags : processes) {
+        if (ctags->exitStatus() != QProcess::NormalExit || ctags->exitCode() != 0) {
+            return false;
+        }
+    }
+    return true;
+}
 
+/**
+ * compare two tag lines the way ctags sorted them
+ * @param sorted value of the !_TAG_FILE_SORTED pseudo tag, 0 unsorted, 1 sorted, 2 case folded
+ */
+static int compareTagLines(const QByteArray &a, const QByteArray &b, int sorted)
+{
+    return (sorted == 2) ? qstricmp(a.constData(), b.constData()) : qstrcmp(a, b);
+}
+
+/**
+ * sort mode of a tags file, parsed from its !_TAG_FILE_SORTED pseudo tag
+ * @param line pseudo tag line
+ * @param sorted sort mode, unchanged if line is no sort pseudo tag
+ */
+static void parseSortMode(const QByteArray &line, int &sorted)
+{
+    static const QByteArray sortedTag("!_TAG_FILE_SORTED\t");
+    if (line.startsWith(sortedTag)) {
+        sorted = line.mid(sortedTag.size(), 1).toInt();
+    }
+}
+
+/**
+ * one input of the k-way merge
+ */
+struct CtagsShardReader {
+    std::unique_ptr<QFile> file;
+    QByteArray line;
+
+    bool next()
+    {
+        line = file->readLine();
+        return !line.isEmpty();
+    }
+};
+
+bool KateProjectIndex::mergeCtags(const QStringList &inputs, const QString &output)
+{
     /**
-     * wait for done
+     * open all inputs
+     * the pseudo tags (!_TAG_...) are at the start of each file, take them from the first one
+     * remember how the shards are sorted, we must merge the same way
      */
-    if (!ctags.waitForFinished(-1)) {
-        return;
+    std::vector<CtagsShardReader> readers(inputs.size());
+    QByteArray header;
+    int sorted = 1;
+    for (int i = 0; i < inputs.size(); ++i) {
+        readers[i].file.reset(new QFile(inputs[i]));
+        if (!readers[i].file->open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        while (readers[i].next() && readers[i].line.startsWith("!_")) {
+            if (i == 0) {
+                header += readers[i].line;
+                parseSortMode(readers[i].line, sorted);
+            }
+        }
+    }
+
+    QFile outputFile(output);
+    if (isCanceled() || !outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    outputFile.write(header);
+
+    /**
+     * k-way merge via min heap of reader indices
+     * sorted == 2 means case folded sorting
+     * unsorted inputs are just concatenated, the heap then degrades to input order
+     */
+    auto greater = [&readers, sorted](int a, int b) {
+        const int res = compareTagLines(readers[a].line, readers[b].line, sorted);
+        return (sorted == 0) ? (a > b) : (res > 0 || (res == 0 && a > b));
+    };
+    std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+    for (int i = 0; i < int(readers.size()); ++i) {
+        if (!readers[i].line.isEmpty()) {
+            heap.push(i);
+        }
     }
 
-    openCtags();
+    while (!heap.empty()) {
+        const int i = heap.top();
+        heap.pop();
+        outputFile.write(readers[i].line);
+        if (readers[i].next()) {
+            heap.push(i);
+        }
+    }
+
+    /**
+     * e.g. disk full
+     */
+    outputFile.close();
+    return outputFile.error() == QFileDevice::NoError;
 }
 
 void KateProjectIndex::openCtags()
@@ -132,98 +356,185 @@ void KateProjectIndex::openCtags()
     }
 
     /**
-     * close current
+     * load the whole index into memory, queries are answered from there
      */
-    if (m_ctagsIndexHandle) {
-        tagsClose(m_ctagsIndexHandle);
-        m_ctagsIndexHandle = nullptr;
+    KateProjectSharedSymbolTable symbols(new KateProjectSymbolTable());
+    if (symbols->load(m_ctagsIndexFile->fileName())) {
+        m_symbols = symbols;
     }
+}
 
+QVector<KateProjectSymbol> KateProjectIndex::findSymbols(const QString &searchWord, int options, int maxResults, quint64 kindMask) const
+{
     /**
-     * try to open ctags file
+     * abort if no ctags index or empty word
      */
-    tagFileInfo info;
-    memset(&info, 0, sizeof(tagFileInfo));
-    m_ctagsIndexHandle = tagsOpen(m_ctagsIndexFile->fileName().toLocal8Bit().constData(), &info);
+    if (!m_symbols || searchWord.isEmpty()) {
+        return QVector<KateProjectSymbol>();
+    }
+
+    /**
+     * without updated files, the table has all we need
+     */
+    if (m_overlay.isEmpty()) {
+        return m_symbols->find(searchWord, options, maxResults, kindMask);
+    }
+
+    /**
+     * else hide the symbols of updated files in the table and rank the current ones together with the rest
+     */
+    QVector<KateProjectSymbol> overlaySymbols;
+    for (const auto &tags : m_overlay) {
+        for (const auto &tag : tags) {
+            overlaySymbols.append(tag.symbol);
+        }
+    }
+    return m_symbols->find(
+        searchWord,
+        options,
+        maxResults,
+        kindMask,
+        [this](const QString &file) {
+            return !m_overlay.contains(file);
+        },
+        overlaySymbols);
 }
 
-void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &searchWord, MatchType type, int options)
+QStringList KateProjectIndex::updateFileArguments(const QString &file) const
 {
     /**
-     * abort if no ctags index
+     * line numbers as address, keeps the overlay lines simple to parse
      */
-    if (!m_ctagsIndexHandle) {
-        return;
-    }
+    QStringList args;
+    args << QStringLiteral("-f") << QStringLiteral("-") << QStringLiteral("--excmd=number") << QStringLiteral("--fields=+K+n") << m_ctagsOptions << file;
+    return args;
+}
 
+void KateProjectIndex::updateFile(const QString &file, const QByteArray &ctagsOutput)
+{
     /**
-     * word to complete
-     * abort if empty
+     * parse the tag lines, keep the raw line for compaction
      */
-    QByteArray word = searchWord.toLocal8Bit();
-    if (word.isEmpty()) {
-        return;
+    QVector<OverlayTag> tags;
+    for (const QByteArray &rawLine : ctagsOutput.split('\n')) {
+        OverlayTag tag;
+        const QByteArray line = rawLine.endsWith('\r') ? rawLine.chopped(1) : rawLine;
+        if (!KateProjectSymbolTable::parseLine(line, tag.symbol)) {
+            continue;
+        }
+
+        tag.raw = line + '\n';
+        tags.append(tag);
     }
 
     /**
-     * try to search entry
-     * fail if none found
+     * sorted like the index file, needed for compaction
      */
-    tagEntry entry;
-    if (options == -1) {
-        options = TAG_PARTIALMATCH | TAG_OBSERVECASE;
+    std::sort(tags.begin(), tags.end(), [](const OverlayTag &a, const OverlayTag &b) {
+        return a.raw < b.raw;
+    });
+
+    m_overlay[file] = tags;
+}
+
+KateProjectIndexOverlay KateProjectIndex::overlaySnapshot() const
+{
+    KateProjectIndexOverlay overlay;
+    for (auto it = m_overlay.cbegin(); it != m_overlay.cend(); ++it) {
+        QVector<QByteArray> &lines = overlay[it.key()];
+        for (const auto &tag : it.value()) {
+            lines.append(tag.raw);
+        }
     }
-    if (tagsFind(m_ctagsIndexHandle, &entry, word.constData(), options) != TagSuccess) {
-        return;
+    return overlay;
+}
+
+bool KateProjectIndex::writeCompactedIndex(const QString &indexFile, const QString &target, const KateProjectIndexOverlay &overlay)
+{
+    QFile input(indexFile);
+    QFile output(target);
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
     }
 
     /**
-     * set to show words only once for completion matches
+     * all overlay lines, sorted like the index once we know how, to merge them with the index
      */
-    QSet<QString> guard;
+    std::vector<QByteArray> overlayLines;
+    for (const auto &lines : overlay) {
+        overlayLines.insert(overlayLines.end(), lines.begin(), lines.end());
+    }
+    auto overlayIt = overlayLines.cbegin();
+    bool overlaySorted = false;
 
     /**
-     * loop over all found tags
-     * first one is filled by above find, others by find next
+     * copy the pseudo tags, drop lines of updated files, merge in the overlay lines
      */
-    do {
-        /**
-         * skip if no name
-         */
-        if (!entry.name) {
+    int sorted = 1;
+    QByteArray line;
+    while (!(line = input.readLine()).isEmpty()) {
+        if (line.startsWith("!_")) {
+            parseSortMode(line, sorted);
+            output.write(line);
             continue;
         }
 
-        /**
-         * get name
-         */
-        QString name(QString::fromLocal8Bit(entry.name));
+        if (!overlaySorted) {
+            std::sort(overlayLines.begin(), overlayLines.end(), [sorted](const QByteArray &a, const QByteArray &b) {
+                return compareTagLines(a, b, sorted) < 0;
+            });
+            overlayIt = overlayLines.cbegin();
+            overlaySorted = true;
+        }
 
-        /**
-         * construct right items
-         */
-        switch (type) {
-        case CompletionMatches:
-            /**
-             * add new completion item, if new name
-             */
-            if (!guard.contains(name)) {
-                model.appendRow(new QStandardItem(name));
-                guard.insert(name);
-            }
-            break;
-
-        case FindMatches:
-            /**
-             * add new find item, contains of multiple columns
-             */
-            QList<QStandardItem *> items;
-            items << new QStandardItem(name);
-            items << new QStandardItem(entry.kind ? QString::fromLocal8Bit(entry.kind) : QString());
-            items << new QStandardItem(entry.file ? QString::fromLocal8Bit(entry.file) : QString());
-            items << new QStandardItem(QString::number(entry.address.lineNumber));
-            model.appendRow(items);
-            break;
-        }
-    } while (tagsFindNext(m_ctagsIndexHandle, &entry) == TagSuccess);
+        const int fileStart = line.indexOf('\t') + 1;
+        const int fileEnd = line.indexOf('\t', fileStart);
+        if (fileStart > 0 && fileEnd > fileStart && overlay.contains(QString::fromLocal8Bit(line.constData() + fileStart, fileEnd - fileStart))) {
+            continue;
+        }
+
+        while (sorted != 0 && overlayIt != overlayLines.cend() && compareTagLines(*overlayIt, line, sorted) < 0) {
+            output.write(*overlayIt++);
+        }
+        output.write(line);
+    }
+
+    while (overlayIt != overlayLines.cend()) {
+        output.write(*overlayIt++);
+    }
+
+    return output.flush();
+}
+
+void KateProjectIndex::finishCompaction(const QString &compactedFile, const KateProjectSharedSymbolTable &symbols, const KateProjectIndexOverlay &overlay)
+{
+    /**
+     * move compacted file in place and use the table loaded from it
+     */
+    const QString fileName = m_ctagsIndexFile->fileName();
+    QFile::remove(fileName);
+    if (!QFile::rename(compactedFile, fileName)) {
+        QFile::remove(compactedFile);
+        return;
+    }
+    m_symbols = symbols;
+
+    /**
+     * drop overlay entries that are now part of the index
+     * keep the ones updated again during compaction
+     */
+    for (auto it = overlay.cbegin(); it != overlay.cend(); ++it) {
+        auto current = m_overlay.find(it.key());
+        if (current == m_overlay.end() || current->size() != it->size()) {
+            continue;
+        }
+
+        bool unchanged = true;
+        for (int i = 0; i < current->size() && unchanged; ++i) {
+            unchanged = current->at(i).raw == it->at(i);
+        }
+        if (unchanged) {
+            m_overlay.erase(current);
+        }
+    }
 }
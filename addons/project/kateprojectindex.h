@@ -11,14 +11,32 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
-#include <QStandardItemModel>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QTemporaryFile>
+#include <QVector>
+
+#include <functional>
+
+#include "kateprojectsymboltable.h"
+
+/**
+ * Shared flag to abort a running index creation.
+ * Set to non-zero by the project if it is reloaded or closed.
+ */
+typedef QSharedPointer<QAtomicInt> KateProjectIndexCancelFlag;
 
 /**
- * ctags reading
+ * Callback to report index creation progress, done and total are counted in ctags runs.
  */
-#include "ctags/readtags.h"
+typedef std::function<void(int done, int total)> KateProjectIndexProgress;
+
+/**
+ * Raw ctags lines per file, used to pass the overlay of updated files to the compaction.
+ */
+typedef QHash<QString, QVector<QByteArray>> KateProjectIndexOverlay;
 
 /**
  * Class representing the index of a project.
@@ -34,8 +52,16 @@ public:
      * construct new index for given files
      * @param files files to index
      * @param ctagsMap ctags section for extra options
+     * @param cancel flag to abort the ctags runs, may be null
+     * @param progress progress callback, may be empty
      */
-    KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force);
+    KateProjectIndex(const QString &baseDir,
+                     const QString &indexDir,
+                     const QStringList &files,
+                     const QVariantMap &ctagsMap,
+                     bool force,
+                     const KateProjectIndexCancelFlag &cancel = KateProjectIndexCancelFlag(),
+                     const KateProjectIndexProgress &progress = KateProjectIndexProgress());
 
     /**
      * deconstruct project
@@ -43,30 +69,18 @@ public:
     ~KateProjectIndex();
 
     /**
-     * Which kind of match items should be created in the passed model
-     * of the findMatches function?
-     */
-    enum MatchType {
-        /**
-         * Completion matches, containing only name and same name only once
-         */
-        CompletionMatches,
-
-        /**
-         * Find matches, containing name, kind, file, line, ...
-         */
-        FindMatches
-    };
-
-    /**
-     * Fill in completion matches for given view/range.
-     * Uses e.g. ctags index.
-     * @param model model to fill with matches
+     * Search symbols, e.g. for completion or goto symbol.
+     * Uses the in-memory copy of the ctags index plus the tags of updated files.
      * @param searchWord word to search for
-     * @param type type of matches
-     * @param options ctags find options (use default if -1)
+     * @param options combination of KateProjectSymbolTable::MatchOption
+     * @param maxResults maximal number of results, -1 for all
+     * @param kindMask kinds to report, see KateProjectSymbolTable::kindMask()
+     * @return matching symbols
      */
-    void findMatches(QStandardItemModel &model, const QString &searchWord, MatchType type, int options = -1);
+    QVector<KateProjectSymbol> findSymbols(const QString &searchWord,
+                                           int options = KateProjectSymbolTable::PrefixMatch,
+                                           int maxResults = -1,
+                                           quint64 kindMask = KateProjectSymbolTable::AllKinds) const;
 
     /**
      * Check if running ctags was successful. This can be used
@@ -75,9 +89,68 @@ public:
      */
     bool isValid() const
     {
-        return m_ctagsIndexHandle;
+        return !m_symbols.isNull();
     }
 
+    /**
+     * Replace the tags of one file with freshly generated ones.
+     * The new tags are kept in an in-memory overlay that hides the entries
+     * of that file in the index file, until the overlay is compacted.
+     * @param file file the tags belong to, as passed to ctags
+     * @param ctagsOutput output of ctags for this file only, empty if the file is gone
+     */
+    void updateFile(const QString &file, const QByteArray &ctagsOutput);
+
+    /**
+     * Arguments to run ctags for a single file, output to stdout.
+     * @param file file to index
+     * @return arguments for ctags
+     */
+    QStringList updateFileArguments(const QString &file) const;
+
+    /**
+     * Number of files with updated tags in the overlay.
+     * @return overlay size
+     */
+    int overlaySize() const
+    {
+        return m_overlay.size();
+    }
+
+    /**
+     * Snapshot of the overlay for compaction.
+     * @return raw ctags lines per updated file
+     */
+    KateProjectIndexOverlay overlaySnapshot() const;
+
+    /**
+     * File name of the ctags index file.
+     * @return index file name
+     */
+    QString indexFileName() const
+    {
+        return m_ctagsIndexFile->fileName();
+    }
+
+    /**
+     * Write a new index file with the overlay folded into the current one.
+     * Only reads the index file and writes the target file, safe to run in a background thread.
+     * @param indexFile current index file
+     * @param target file to write
+     * @param overlay overlay snapshot to fold in
+     * @return success
+     */
+    static bool writeCompactedIndex(const QString &indexFile, const QString &target, const KateProjectIndexOverlay &overlay);
+
+    /**
+     * Switch to the compacted index file written by writeCompactedIndex.
+     * Overlay entries that did not change since the snapshot are dropped.
+     * @param compactedFile compacted index file, will be moved over our index file
+     * @param symbols symbol table loaded from the compacted file
+     * @param overlay overlay snapshot used for compaction
+     */
+    void finishCompaction(const QString &compactedFile, const KateProjectSharedSymbolTable &symbols, const KateProjectIndexOverlay &overlay);
+
 private:
     /**
      * Load ctags tags.
@@ -87,10 +160,35 @@ private:
     void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force);
 
     /**
-     * Open ctags tags.
+     * Run ctags for the given shards in parallel, one process per shard.
+     * @param shards files to index, one list per process
+     * @param outputs output file per shard
+     * @return success, false on failure or cancel
+     */
+    bool runCtags(const QVector<QStringList> &shards, const QStringList &outputs);
+
+    /**
+     * Merge the sorted tags files of the shards into one.
+     * @param inputs tags files to merge
+     * @param output file to write the merged tags to
+     * @return success
+     */
+    bool mergeCtags(const QStringList &inputs, const QString &output);
+
+    /**
+     * Load ctags tags into memory.
      */
     void openCtags();
 
+    /**
+     * Was index creation canceled?
+     * @return true if cancel requested
+     */
+    bool isCanceled() const
+    {
+        return m_cancel && m_cancel->loadAcquire();
+    }
+
 private:
     /**
      * ctags index file
@@ -98,9 +196,38 @@ private:
     QScopedPointer<QFile> m_ctagsIndexFile;
 
     /**
-     * handle to ctags file for querying, if possible
+     * in-memory ctags index for querying, if possible
+     */
+    KateProjectSharedSymbolTable m_symbols;
+
+    /**
+     * cancel flag, only used during construction
+     */
+    KateProjectIndexCancelFlag m_cancel;
+
+    /**
+     * progress callback, only used during construction
+     */
+    KateProjectIndexProgress m_progress;
+
+    /**
+     * one tag of an updated file
+     */
+    struct OverlayTag {
+        KateProjectSymbol symbol;
+        QByteArray raw;
+    };
+
+    /**
+     * updated files => their current tags
+     * files in here are hidden in the index file
+     */
+    QHash<QString, QVector<OverlayTag>> m_overlay;
+
+    /**
+     * ctags options of the project, for updates of single files
      */
-    tagFile *m_ctagsIndexHandle;
+    QStringList m_ctagsOptions;
 };
 
 #endif
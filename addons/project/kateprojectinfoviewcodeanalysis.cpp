@@ -10,8 +10,12 @@
 #include "kateprojectpluginview.h"
 #include "tools/kateprojectcodeanalysisselector.h"
 
+#include <QCryptographicHash>
 #include <QFileInfo>
 #include <QHBoxLayout>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
 #include <QToolTip>
 #include <QVBoxLayout>
 
@@ -25,7 +29,6 @@ KateProjectInfoViewCodeAnalysis::KateProjectInfoViewCodeAnalysis(KateProjectPlug
     , m_startStopAnalysis(new QPushButton(i18n("Start Analysis...")))
     , m_treeView(new QTreeView(this))
     , m_model(new QStandardItemModel(m_treeView))
-    , m_analyzer(nullptr)
     , m_analysisTool(nullptr)
     , m_toolSelector(new QComboBox())
 {
@@ -81,11 +84,18 @@ KateProjectInfoViewCodeAnalysis::KateProjectInfoViewCodeAnalysis(KateProjectPlug
      */
     connect(m_startStopAnalysis, &QPushButton::clicked, this, &KateProjectInfoViewCodeAnalysis::slotStartStopClicked);
     connect(m_treeView, &QTreeView::clicked, this, &KateProjectInfoViewCodeAnalysis::slotClicked);
+
+    /**
+     * results are added in batches, not for each line of output
+     */
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(100);
+    connect(&m_flushTimer, &QTimer::timeout, this, &KateProjectInfoViewCodeAnalysis::flushResults);
 }
 
 KateProjectInfoViewCodeAnalysis::~KateProjectInfoViewCodeAnalysis()
 {
-    delete m_analyzer;
+    killAnalyzers();
 }
 
 void KateProjectInfoViewCodeAnalysis::slotToolSelectionChanged(int)
@@ -101,67 +111,145 @@ void KateProjectInfoViewCodeAnalysis::slotStartStopClicked()
      */
     m_analysisTool = m_toolSelector->currentData(Qt::UserRole + 1).value<KateProjectCodeAnalysisTool *>();
     m_analysisTool->setProject(m_project);
+    const QStringList files = m_analysisTool->filter(m_project->files());
 
     /**
      * clear existing entries
      */
+    killAnalyzers();
+    m_flushTimer.stop();
+    m_pendingResults.clear();
+    m_results.clear();
     m_model->removeRows(0, m_model->rowCount(), QModelIndex());
-
-    /**
-     * launch selected tool
-     */
-    delete m_analyzer;
-    m_analyzer = new QProcess;
-    m_analyzer->setProcessChannelMode(QProcess::MergedChannels);
-
-    connect(m_analyzer, &QProcess::readyRead, this, &KateProjectInfoViewCodeAnalysis::slotReadyRead);
-    connect(m_analyzer, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateProjectInfoViewCodeAnalysis::finished);
-
-    m_analyzer->start(m_analysisTool->path(), m_analysisTool->arguments());
+    m_filesCount = files.size();
+    m_failed = false;
 
     if (m_messageWidget) {
         delete m_messageWidget;
         m_messageWidget = nullptr;
     }
 
-    if (!m_analyzer->waitForStarted()) {
-        m_messageWidget = new KMessageWidget(this);
-        m_messageWidget->setCloseButtonVisible(true);
-        m_messageWidget->setMessageType(KMessageWidget::Warning);
-        m_messageWidget->setWordWrap(false);
-        m_messageWidget->setText(m_analysisTool->notInstalledMessage());
-        static_cast<QVBoxLayout *>(layout())->addWidget(m_messageWidget);
-        m_messageWidget->animatedShow();
+    /**
+     * results of former runs stay valid for unchanged files if the tool is called the same way
+     */
+    m_analysisTool->setFiles(QStringList());
+    const QByteArray toolKey = (QStringList(m_analysisTool->path()) + m_analysisTool->arguments()).join(QLatin1Char('\n')).toUtf8();
+    const QString cacheName = QString::fromLatin1(QCryptographicHash::hash((m_project->baseDir() + m_analysisTool->path()).toUtf8(), QCryptographicHash::Sha1).toHex());
+    m_cache.reset(new KateProjectCodeAnalysisCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/codeanalysis/") + cacheName, toolKey));
+    m_cache->load();
+    m_cache->retain(files);
+
+    QStringList changedFiles;
+    for (const QString &file : files) {
+        KateProjectCodeAnalysisCache::Diagnostics diagnostics;
+        if (m_cache->lookup(file, diagnostics)) {
+            m_pendingResults += diagnostics;
+        } else {
+            changedFiles.append(file);
+        }
+    }
+    flushResults();
+
+    if (changedFiles.isEmpty()) {
+        analysisFinished();
         return;
     }
 
-    m_startStopAnalysis->setEnabled(false);
+    /**
+     * split the changed files over one analyzer per core
+     */
+    const int parts = qMin(changedFiles.size(), qMax(1, QThread::idealThreadCount()));
+    QVector<QStringList> partFiles(parts);
+    for (int i = 0; i < changedFiles.size(); ++i) {
+        partFiles[i % parts].append(changedFiles[i]);
+    }
 
     /**
-     * write files list and close write channel
+     * launch selected tool
      */
-    const QString stdinMessage = m_analysisTool->stdinMessages();
-    if (!stdinMessage.isEmpty()) {
-        m_analyzer->write(stdinMessage.toLocal8Bit());
+    for (const QStringList &part : qAsConst(partFiles)) {
+        m_analysisTool->setFiles(part);
+        QProcess *analyzer = new QProcess(this);
+        analyzer->setProcessChannelMode(QProcess::MergedChannels);
+        m_analyzers.insert(analyzer, part);
+
+        connect(analyzer, &QProcess::readyRead, this, &KateProjectInfoViewCodeAnalysis::slotReadyRead);
+        connect(analyzer, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateProjectInfoViewCodeAnalysis::finished);
+
+        analyzer->start(m_analysisTool->path(), m_analysisTool->arguments());
+
+        if (!analyzer->waitForStarted()) {
+            killAnalyzers();
+            m_messageWidget = new KMessageWidget(this);
+            m_messageWidget->setCloseButtonVisible(true);
+            m_messageWidget->setMessageType(KMessageWidget::Warning);
+            m_messageWidget->setWordWrap(false);
+            m_messageWidget->setText(m_analysisTool->notInstalledMessage());
+            static_cast<QVBoxLayout *>(layout())->addWidget(m_messageWidget);
+            m_messageWidget->animatedShow();
+            return;
+        }
+
+        /**
+         * write files list and close write channel
+         */
+        const QString stdinMessage = m_analysisTool->stdinMessages();
+        if (!stdinMessage.isEmpty()) {
+            analyzer->write(stdinMessage.toLocal8Bit());
+        }
+        analyzer->closeWriteChannel();
     }
-    m_analyzer->closeWriteChannel();
+
+    m_startStopAnalysis->setEnabled(false);
 }
 
 void KateProjectInfoViewCodeAnalysis::slotReadyRead()
 {
+    if (QProcess *analyzer = qobject_cast<QProcess *>(sender())) {
+        readOutput(analyzer, false);
+    }
+}
+
+void KateProjectInfoViewCodeAnalysis::readOutput(QProcess *analyzer, bool all)
+{
+    const QStringList &files = m_analyzers[analyzer];
+
     /**
      * get results of analysis
      */
-    while (m_analyzer->canReadLine()) {
+    while (analyzer->canReadLine() || (all && analyzer->bytesAvailable() > 0)) {
         /**
          * get one line, split it, skip it, if too few elements
          */
-        QString line = QString::fromLocal8Bit(m_analyzer->readLine());
+        QString line = QString::fromLocal8Bit(analyzer->readLine());
         QStringList elements = m_analysisTool->parseLine(line);
         if (elements.size() < 4) {
             continue;
         }
 
+        /**
+         * remember per file for the cache
+         * output for other files, like included headers, belongs to the first file of this run
+         */
+        const QString &file = files.contains(elements[0]) ? elements[0] : files.first();
+        m_results[file].append(elements);
+        m_pendingResults.append(elements);
+    }
+
+    if (!m_pendingResults.isEmpty() && !m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void KateProjectInfoViewCodeAnalysis::flushResults()
+{
+    m_flushTimer.stop();
+    if (m_pendingResults.isEmpty()) {
+        return;
+    }
+
+    const bool firstResults = m_model->rowCount() == 0;
+    for (const QStringList &elements : qAsConst(m_pendingResults)) {
         /**
          * feed into model
          */
@@ -177,13 +265,26 @@ void KateProjectInfoViewCodeAnalysis::slotReadyRead()
         items << messageItem;
         m_model->appendRow(items);
     }
+    m_pendingResults.clear();
 
     /**
      * tree view polish ;)
+     * once for the first results, once more at the end
      */
-    m_treeView->resizeColumnToContents(2);
-    m_treeView->resizeColumnToContents(1);
-    m_treeView->resizeColumnToContents(0);
+    if (firstResults || m_analyzers.isEmpty()) {
+        m_treeView->resizeColumnToContents(2);
+        m_treeView->resizeColumnToContents(1);
+        m_treeView->resizeColumnToContents(0);
+    }
+}
+
+void KateProjectInfoViewCodeAnalysis::killAnalyzers()
+{
+    for (auto it = m_analyzers.cbegin(); it != m_analyzers.cend(); ++it) {
+        it.key()->disconnect(this);
+        delete it.key();
+    }
+    m_analyzers.clear();
 }
 
 void KateProjectInfoViewCodeAnalysis::slotClicked(const QModelIndex &index)
@@ -213,22 +314,53 @@ void KateProjectInfoViewCodeAnalysis::slotClicked(const QModelIndex &index)
     }
 }
 
-void KateProjectInfoViewCodeAnalysis::finished(int exitCode, QProcess::ExitStatus)
+void KateProjectInfoViewCodeAnalysis::finished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *analyzer = qobject_cast<QProcess *>(sender());
+    if (!analyzer || !m_analyzers.contains(analyzer)) {
+        return;
+    }
+
+    readOutput(analyzer, true);
+
+    /**
+     * results of a successful run are valid for the analyzed files
+     */
+    const QStringList files = m_analyzers.take(analyzer);
+    analyzer->deleteLater();
+    if (exitStatus == QProcess::NormalExit && m_analysisTool->isSuccessfulExitCode(exitCode)) {
+        for (const QString &file : files) {
+            m_cache->store(file, m_results.take(file));
+        }
+    } else {
+        m_failed = true;
+        m_failedExitCode = exitCode;
+    }
+
+    if (m_analyzers.isEmpty()) {
+        m_cache->save();
+        analysisFinished();
+    }
+}
+
+void KateProjectInfoViewCodeAnalysis::analysisFinished()
 {
+    flushResults();
+
     m_startStopAnalysis->setEnabled(true);
     m_messageWidget = new KMessageWidget(this);
     m_messageWidget->setCloseButtonVisible(true);
     m_messageWidget->setWordWrap(false);
 
-    if (m_analysisTool->isSuccessfulExitCode(exitCode)) {
+    if (!m_failed) {
         // normally 0 is successful but there are exceptions
         m_messageWidget->setMessageType(KMessageWidget::Information);
-        m_messageWidget->setText(i18np("Analysis on %1 file finished.", "Analysis on %1 files finished.", m_analysisTool->getActualFilesCount()));
+        m_messageWidget->setText(i18np("Analysis on %1 file finished.", "Analysis on %1 files finished.", m_filesCount));
     } else {
         // unfortunately, output was eaten by slotReadyRead()
         // TODO: get stderr output, show it here
         m_messageWidget->setMessageType(KMessageWidget::Warning);
-        m_messageWidget->setText(i18np("Analysis on %1 file failed with exit code %2.", "Analysis on %1 files failed with exit code %2.", m_analysisTool->getActualFilesCount(), exitCode));
+        m_messageWidget->setText(i18np("Analysis on %1 file failed with exit code %2.", "Analysis on %1 files failed with exit code %2.", m_filesCount, m_failedExitCode));
     }
     static_cast<QVBoxLayout *>(layout())->addWidget(m_messageWidget);
     m_messageWidget->animatedShow();
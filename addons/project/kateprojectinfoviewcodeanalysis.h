@@ -9,11 +9,15 @@
 #define KATE_PROJECT_INFO_VIEW_CODE_ANALYSIS_H
 
 #include "kateproject.h"
+#include "kateprojectcodeanalysiscache.h"
 
 #include <QComboBox>
+#include <QHash>
 #include <QLabel>
 #include <QProcess>
 #include <QPushButton>
+#include <QScopedPointer>
+#include <QTimer>
 #include <QTreeView>
 
 class KateProjectPluginView;
@@ -66,6 +70,11 @@ private Q_SLOTS:
      */
     void slotReadyRead();
 
+    /**
+     * Move the results collected so far into the model
+     */
+    void flushResults();
+
     /**
      * item got clicked, do stuff, like open document
      * @param index model index of clicked item
@@ -73,12 +82,30 @@ private Q_SLOTS:
     void slotClicked(const QModelIndex &index);
 
     /**
-     * Analysis finished
+     * Analysis of one part of the files finished
      * @param exitCode analyzer process exit code
      * @param exitStatus analyzer process exit status
      */
     void finished(int exitCode, QProcess::ExitStatus exitStatus);
 
+private:
+    /**
+     * Parse the available output of an analyzer.
+     * @param analyzer analyzer process
+     * @param all parse also a last incomplete line, once the process is done
+     */
+    void readOutput(QProcess *analyzer, bool all);
+
+    /**
+     * Stop and delete all running analyzers.
+     */
+    void killAnalyzers();
+
+    /**
+     * Show final status message, once all analyzers are done.
+     */
+    void analysisFinished();
+
 private:
     /**
      * our plugin view
@@ -111,9 +138,36 @@ private:
     QStandardItemModel *m_model;
 
     /**
-     * running analyzer process
+     * running analyzer processes with the files each one analyzes
+     */
+    QHash<QProcess *, QStringList> m_analyzers;
+
+    /**
+     * results per file of the running analysis, stored in the cache once the file is done
+     */
+    QHash<QString, KateProjectCodeAnalysisCache::Diagnostics> m_results;
+
+    /**
+     * results not yet in the model, they are added in batches
+     */
+    KateProjectCodeAnalysisCache::Diagnostics m_pendingResults;
+
+    /**
+     * triggers flushResults()
+     */
+    QTimer m_flushTimer;
+
+    /**
+     * results of former runs, for the current tool and its arguments
+     */
+    QScopedPointer<KateProjectCodeAnalysisCache> m_cache;
+
+    /**
+     * number of files of the current analysis and the failed exit code, if any
      */
-    QProcess *m_analyzer;
+    int m_filesCount = 0;
+    bool m_failed = false;
+    int m_failedExitCode = 0;
 
     /**
      * currently selected tool
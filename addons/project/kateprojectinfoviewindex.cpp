@@ -10,8 +10,112 @@
 
 #include <KLocalizedString>
 #include <KMessageWidget>
+#include <QAbstractTableModel>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
+/**
+ * Table model over search results, rows are only materialized when displayed.
+ */
+class KateProjectSymbolModel : public QAbstractTableModel
+{
+public:
+    enum Column { Name, Kind, File, Line, ColumnCount };
+
+    using QAbstractTableModel::QAbstractTableModel;
+
+    void setSymbols(const QVector<KateProjectSymbol> &symbols)
+    {
+        beginResetModel();
+        m_symbols = symbols;
+        endResetModel();
+    }
+
+    const KateProjectSymbol &symbol(int row) const
+    {
+        return m_symbols.at(row);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_symbols.size();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : ColumnCount;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (!index.isValid() || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        const KateProjectSymbol &symbol = m_symbols.at(index.row());
+        switch (index.column()) {
+        case Name:
+            return symbol.name;
+        case Kind:
+            return symbol.kind;
+        case File:
+            return symbol.file;
+        case Line:
+            return QString::number(symbol.line);
+        }
+        return QVariant();
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        switch (section) {
+        case Name:
+            return i18n("Name");
+        case Kind:
+            return i18n("Kind");
+        case File:
+            return i18n("File");
+        case Line:
+            return i18n("Line");
+        }
+        return QVariant();
+    }
+
+    void sort(int column, Qt::SortOrder order) override
+    {
+        const auto less = [column](const KateProjectSymbol &a, const KateProjectSymbol &b) {
+            switch (column) {
+            case Kind:
+                return a.kind < b.kind;
+            case File:
+                return a.file < b.file;
+            case Line:
+                return a.line < b.line;
+            default:
+                return a.name < b.name;
+            }
+        };
+
+        emit layoutAboutToBeChanged();
+        if (order == Qt::AscendingOrder) {
+            std::stable_sort(m_symbols.begin(), m_symbols.end(), less);
+        } else {
+            std::stable_sort(m_symbols.begin(), m_symbols.end(), [&less](const KateProjectSymbol &a, const KateProjectSymbol &b) {
+                return less(b, a);
+            });
+        }
+        emit layoutChanged();
+    }
+
+private:
+    QVector<KateProjectSymbol> m_symbols;
+};
+
 KateProjectInfoViewIndex::KateProjectInfoViewIndex(KateProjectPluginView *pluginView, KateProject *project, QWidget *parent)
     : QWidget(parent)
     , m_pluginView(pluginView)
@@ -19,7 +123,7 @@ KateProjectInfoViewIndex::KateProjectInfoViewIndex(KateProjectPluginView *plugin
     , m_messageWidget(nullptr)
     , m_lineEdit(new QLineEdit())
     , m_treeView(new QTreeView())
-    , m_model(new QStandardItemModel(m_treeView))
+    , m_model(new KateProjectSymbolModel(m_treeView))
 {
     /**
      * default style
@@ -27,7 +131,6 @@ KateProjectInfoViewIndex::KateProjectInfoViewIndex(KateProjectPluginView *plugin
     m_treeView->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_treeView->setUniformRowHeights(true);
     m_treeView->setRootIsDecorated(false);
-    m_model->setHorizontalHeaderLabels(QStringList() << i18n("Name") << i18n("Kind") << i18n("File") << i18n("Line"));
     m_lineEdit->setPlaceholderText(i18n("Search"));
     m_lineEdit->setClearButtonEnabled(true);
 
@@ -57,6 +160,7 @@ KateProjectInfoViewIndex::KateProjectInfoViewIndex(KateProjectPluginView *plugin
     connect(m_treeView, &QTreeView::clicked, this, &KateProjectInfoViewIndex::slotClicked);
     if (m_project) {
         connect(m_project, &KateProject::indexChanged, this, &KateProjectInfoViewIndex::indexAvailable);
+        connect(m_project, &KateProject::indexProgress, this, &KateProjectInfoViewIndex::indexProgress);
     } else {
         connect(m_pluginView, &KateProjectPluginView::gotoSymbol, this, &KateProjectInfoViewIndex::slotGotoSymbol);
         enableWidgets(true);
@@ -89,20 +193,21 @@ void KateProjectInfoViewIndex::slotTextChanged(const QString &text)
      * init
      */
     m_treeView->setSortingEnabled(false);
-    m_model->setRowCount(0);
 
     /**
      * get results
      */
+    QVector<KateProjectSymbol> symbols;
     if (m_project && m_project->projectIndex() && !text.isEmpty()) {
-        m_project->projectIndex()->findMatches(*m_model, text, KateProjectIndex::FindMatches);
+        symbols = m_project->projectIndex()->findSymbols(text, KateProjectSymbolTable::PrefixMatch);
     } else if (!text.isEmpty()) {
         for (const auto &project : m_pluginView->plugin()->projects()) {
             if (project->projectIndex()) {
-                project->projectIndex()->findMatches(*m_model, text, KateProjectIndex::FindMatches, TAG_FULLMATCH | TAG_OBSERVECASE);
+                symbols += project->projectIndex()->findSymbols(text, KateProjectSymbolTable::FullMatch);
             }
         }
     }
+    m_model->setSymbols(symbols);
 
     /**
      * tree view polish ;)
@@ -118,7 +223,11 @@ void KateProjectInfoViewIndex::slotClicked(const QModelIndex &index)
     /**
      * get path
      */
-    QString filePath = m_model->item(index.row(), 2)->text();
+    if (!index.isValid()) {
+        return;
+    }
+    const KateProjectSymbol symbol = m_model->symbol(index.row());
+    const QString filePath = symbol.file;
     if (filePath.isEmpty()) {
         return;
     }
@@ -134,7 +243,7 @@ void KateProjectInfoViewIndex::slotClicked(const QModelIndex &index)
     /**
      * set cursor, if possible
      */
-    int line = m_model->item(index.row(), 3)->text().toInt();
+    const int line = symbol.line;
     if (line >= 1) {
         view->setCursorPosition(KTextEditor::Cursor(line - 1, 0));
     }
@@ -142,10 +251,16 @@ void KateProjectInfoViewIndex::slotClicked(const QModelIndex &index)
 
 void KateProjectInfoViewIndex::indexAvailable()
 {
+    m_lineEdit->setPlaceholderText(i18n("Search"));
     const bool valid = m_project->projectIndex() && m_project->projectIndex()->isValid();
     enableWidgets(valid);
 }
 
+void KateProjectInfoViewIndex::indexProgress(int done, int total)
+{
+    m_lineEdit->setPlaceholderText(i18n("Indexing (%1/%2)...", done, total));
+}
+
 void KateProjectInfoViewIndex::enableWidgets(bool valid)
 {
     /**
@@ -14,6 +14,7 @@
 #include <QTreeView>
 
 class KateProjectPluginView;
+class KateProjectSymbolModel;
 class KMessageWidget;
 
 /**
@@ -65,6 +66,13 @@ private Q_SLOTS:
      */
     void indexAvailable();
 
+    /**
+     * called while the index of the project is created
+     * @param done finished ctags runs
+     * @param total total ctags runs
+     */
+    void indexProgress(int done, int total);
+
     /**
      * called to enable or disable widgets
      * @param enable
@@ -105,9 +113,9 @@ private:
     QTreeView *m_treeView;
 
     /**
-     * standard item model for results
+     * model for results
      */
-    QStandardItemModel *m_model;
+    KateProjectSymbolModel *m_model;
 };
 
 #endif
@@ -12,6 +12,7 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QIcon>
+#include <QHash>
 #include <QMimeDatabase>
 #include <QThread>
 
@@ -110,3 +111,87 @@ QIcon *KateProjectItem::icon() const
 
     return m_icon;
 }
+
+void KateProjectItem::appendFiles(QStandardItem *parent, const QVector<LazyFile> &files, QMap<QString, KateProjectItem *> *file2Item)
+{
+    /**
+     * group by first path component, directories in order of first occurrence, then the files
+     * directories only get the files below them, their items are created on demand
+     */
+    QList<QStandardItem *> directories;
+    QList<QStandardItem *> fileItems;
+    QHash<QString, KateProjectItem *> name2Directory;
+    for (const LazyFile &lazyFile : files) {
+        const int slashIndex = lazyFile.path.indexOf(QLatin1Char('/'));
+        if (slashIndex < 0) {
+            KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, lazyFile.path);
+            fileItem->setData(lazyFile.file, Qt::ToolTipRole);
+            fileItem->setData(lazyFile.file, Qt::UserRole);
+            fileItems.append(fileItem);
+            (*file2Item)[lazyFile.file] = fileItem;
+            continue;
+        }
+
+        const QString name = lazyFile.path.left(slashIndex);
+        KateProjectItem *&directory = name2Directory[name];
+        if (!directory) {
+            directory = new KateProjectItem(KateProjectItem::Directory, name);
+            directories.append(directory);
+        }
+        directory->m_lazyFiles.append({lazyFile.path.mid(slashIndex + 1), lazyFile.file});
+        (*file2Item)[lazyFile.file] = directory;
+    }
+
+    /**
+     * one insertion per kind, not one per row
+     */
+    if (!directories.isEmpty()) {
+        parent->appendRows(directories);
+    }
+    if (!fileItems.isEmpty()) {
+        parent->appendRows(fileItems);
+    }
+}
+
+void KateProjectItem::fetchChildren(QMap<QString, KateProjectItem *> *file2Item)
+{
+    QVector<LazyFile> files;
+    files.swap(m_lazyFiles);
+    appendFiles(this, files, file2Item);
+}
+
+bool KateProjectModel::hasChildren(const QModelIndex &parent) const
+{
+    return canFetchMore(parent) || QStandardItemModel::hasChildren(parent);
+}
+
+bool KateProjectModel::canFetchMore(const QModelIndex &parent) const
+{
+    const KateProjectItem *item = static_cast<KateProjectItem *>(itemFromIndex(parent));
+    return item && item->canFetchChildren();
+}
+
+void KateProjectModel::fetchMore(const QModelIndex &parent)
+{
+    KateProjectItem *item = static_cast<KateProjectItem *>(itemFromIndex(parent));
+    if (item && item->canFetchChildren() && m_file2Item) {
+        item->fetchChildren(m_file2Item);
+    }
+}
+
+KateProjectItem *KateProjectModel::itemForFile(const QString &file)
+{
+    if (!m_file2Item) {
+        return nullptr;
+    }
+
+    /**
+     * files without item map to the directory keeping them, create the items down to the file
+     */
+    KateProjectItem *item = m_file2Item->value(file);
+    while (item && item->canFetchChildren()) {
+        item->fetchChildren(m_file2Item);
+        item = m_file2Item->value(file);
+    }
+    return item;
+}
@@ -9,7 +9,9 @@
 #define KATE_PROJECT_ITEM_H
 
 #include <KTextEditor/ModificationInterface>
-#include <QStandardItem>
+#include <QMap>
+#include <QStandardItemModel>
+#include <QVector>
 
 namespace KTextEditor
 {
@@ -48,6 +50,55 @@ public:
      */
     QVariant data(int role = Qt::UserRole + 1) const override;
 
+    /**
+     * A file below a directory whose item is not created yet.
+     */
+    struct LazyFile {
+        /**
+         * path relative to the directory that holds the file, '/' separated
+         */
+        QString path;
+
+        /**
+         * absolute file name
+         */
+        QString file;
+    };
+
+    /**
+     * Append items for the given files to parent.
+     * Files directly in parent get an item, for each subdirectory only the directory item
+     * is created, it keeps its files until fetchChildren() is called.
+     * @param parent parent item
+     * @param files files to append, paths relative to parent
+     * @param file2Item mapping file => item, updated, files without item map to the directory keeping them
+     */
+    static void appendFiles(QStandardItem *parent, const QVector<LazyFile> &files, QMap<QString, KateProjectItem *> *file2Item);
+
+    /**
+     * Does this directory keep files without items?
+     * @return true, if fetchChildren() would create items
+     */
+    bool canFetchChildren() const
+    {
+        return !m_lazyFiles.isEmpty();
+    }
+
+    /**
+     * Files this directory keeps without items.
+     * @return files, paths relative to this directory
+     */
+    const QVector<LazyFile> &lazyFiles() const
+    {
+        return m_lazyFiles;
+    }
+
+    /**
+     * Create the items for the files and subdirectories this directory keeps.
+     * @param file2Item mapping file => item, updated
+     */
+    void fetchChildren(QMap<QString, KateProjectItem *> *file2Item);
+
 public:
     void slotModifiedChanged(KTextEditor::Document *);
     void slotModifiedOnDisk(KTextEditor::Document *document, bool isModified, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason);
@@ -70,6 +121,44 @@ private:
      * for document icons
      */
     QString m_emblem;
+
+    /**
+     * files below this directory without items, see appendFiles()
+     */
+    QVector<LazyFile> m_lazyFiles;
+};
+
+/**
+ * Model for the project tree.
+ * Directories create their children only once they are expanded or a file below them is requested.
+ */
+class KateProjectModel : public QStandardItemModel
+{
+public:
+    using QStandardItemModel::QStandardItemModel;
+
+    /**
+     * Set mapping file => item to keep up to date when children are created.
+     * @param file2Item mapping of the project
+     */
+    void setFileMapping(QMap<QString, KateProjectItem *> *file2Item)
+    {
+        m_file2Item = file2Item;
+    }
+
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    /**
+     * Get the item for the given file, creates it and its parents if needed.
+     * @param file file to get item for
+     * @return item for given file or nullptr
+     */
+    KateProjectItem *itemForFile(const QString &file);
+
+private:
+    QMap<QString, KateProjectItem *> *m_file2Item = nullptr;
 };
 
 #endif
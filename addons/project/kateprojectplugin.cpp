@@ -56,10 +56,13 @@ KateProjectPlugin::KateProjectPlugin(QObject *parent, const QList<QVariant> &)
     , m_multiProjectCompletion(false)
     , m_multiProjectGoto(false)
     , m_weaver(new ThreadWeaver::Queue(this))
+    , m_indexQueuePolicy(1)
 {
     qRegisterMetaType<KateProjectSharedQStandardItem>("KateProjectSharedQStandardItem");
     qRegisterMetaType<KateProjectSharedQMapStringItem>("KateProjectSharedQMapStringItem");
     qRegisterMetaType<KateProjectSharedProjectIndex>("KateProjectSharedProjectIndex");
+    qRegisterMetaType<KateProjectSharedSymbolTable>("KateProjectSharedSymbolTable");
+    qRegisterMetaType<KateProjectSharedFilterList>("KateProjectSharedFilterList");
 
     connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentCreated, this, &KateProjectPlugin::slotDocumentCreated);
     connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, this, &KateProjectPlugin::slotDirectoryChanged);
@@ -321,6 +324,23 @@ void KateProjectPlugin::setIndex(bool enabled, const QUrl &directory)
     writeConfig();
 }
 
+void KateProjectPlugin::setActiveProject(KateProject *project)
+{
+    if (m_activeProject == project) {
+        return;
+    }
+
+    if (m_activeProject) {
+        m_activeProject->setActive(false);
+    }
+
+    m_activeProject = project;
+
+    if (m_activeProject) {
+        m_activeProject->setActive(true);
+    }
+}
+
 bool KateProjectPlugin::getIndexEnabled() const
 {
     return m_indexEnabled;
@@ -17,6 +17,8 @@
 
 #include <KXMLGUIClient>
 
+#include <ThreadWeaver/ResourceRestrictionPolicy>
+
 #include "kateproject.h"
 #include "kateprojectcompletion.h"
 
@@ -106,6 +108,22 @@ public:
     bool multiProjectCompletion() const;
     bool multiProjectGoto() const;
 
+    /**
+     * Set the project of the active document, its loading is preferred.
+     * @param project active project, may be null
+     */
+    void setActiveProject(KateProject *project);
+
+    /**
+     * Queue policy for index jobs, they run one after the other.
+     * A single index creation already runs ctags in parallel.
+     * @return policy for index jobs
+     */
+    ThreadWeaver::QueuePolicy *indexQueuePolicy()
+    {
+        return &m_indexQueuePolicy;
+    }
+
 Q_SIGNALS:
     /**
      * Signal that a new project got created.
@@ -185,6 +203,16 @@ private:
     QUrl m_indexDirectory;
 
     ThreadWeaver::Queue *m_weaver;
+
+    /**
+     * allows only one index job at a time, must outlive the jobs
+     */
+    ThreadWeaver::ResourceRestrictionPolicy m_indexQueuePolicy;
+
+    /**
+     * project of the active document, if any
+     */
+    KateProject *m_activeProject = nullptr;
 };
 
 #endif
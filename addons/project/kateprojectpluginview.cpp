@@ -29,6 +29,8 @@
 #include <QMenu>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
 K_PLUGIN_FACTORY_WITH_JSON(KateProjectPluginFactory, "kateprojectplugin.json", registerPlugin<KateProjectPlugin>();)
 
 KateProjectPluginView::KateProjectPluginView(KateProjectPlugin *plugin, KTextEditor::MainWindow *mainWin)
@@ -260,6 +262,16 @@ QStringList KateProjectPluginView::projectFiles() const
     return active->project()->files();
 }
 
+qulonglong KateProjectPluginView::projectFilesVersion() const
+{
+    KateProjectView *active = static_cast<KateProjectView *>(m_stackedProjectViews->currentWidget());
+    if (!active) {
+        return 0;
+    }
+
+    return active->project()->filesVersion();
+}
+
 QString KateProjectPluginView::allProjectsCommonBaseDir() const
 {
     auto projects = m_plugin->projects();
@@ -293,6 +305,21 @@ QStringList KateProjectPluginView::allProjectsFiles() const
     return fileList;
 }
 
+qulonglong KateProjectPluginView::allProjectsFilesVersion() const
+{
+    /**
+     * each change of a file list hands out a new, larger version
+     * the largest version together with the project count identifies the set of file lists
+     */
+    quint64 version = 0;
+    const auto projectList = m_plugin->projects();
+    for (auto project : projectList) {
+        version = std::max(version, project->filesVersion());
+    }
+
+    return (version << 16) | quint64(projectList.size() & 0xffff);
+}
+
 void KateProjectPluginView::slotViewChanged()
 {
     /**
@@ -365,6 +392,11 @@ void KateProjectPluginView::slotDocumentUrlChanged(KTextEditor::Document *docume
         return;
     }
 
+    /**
+     * the loading of this project is the most urgent now
+     */
+    m_plugin->setActiveProject(project);
+
     /**
      * select the file FIRST
      */
@@ -31,9 +31,11 @@ class KateProjectPluginView : public QObject, public KXMLGUIClient
     Q_PROPERTY(QString projectBaseDir READ projectBaseDir)
     Q_PROPERTY(QVariantMap projectMap READ projectMap NOTIFY projectMapChanged)
     Q_PROPERTY(QStringList projectFiles READ projectFiles)
+    Q_PROPERTY(qulonglong projectFilesVersion READ projectFilesVersion)
 
     Q_PROPERTY(QString allProjectsCommonBaseDir READ allProjectsCommonBaseDir)
     Q_PROPERTY(QStringList allProjectsFiles READ allProjectsFiles)
+    Q_PROPERTY(qulonglong allProjectsFilesVersion READ allProjectsFilesVersion)
 
 public:
     KateProjectPluginView(KateProjectPlugin *plugin, KTextEditor::MainWindow *mainWindow);
@@ -67,6 +69,12 @@ public:
      */
     QStringList projectFiles() const;
 
+    /**
+     * version of the files of the current active project, changes if projectFiles() changes
+     * @return 0 if none, else version of the project files
+     */
+    qulonglong projectFilesVersion() const;
+
     /**
      * Example: Two projects are loaded with baseDir1="/home/dev/project1" and
      * baseDir2="/home/dev/project2". Then "/home/dev/" is returned.
@@ -80,6 +88,12 @@ public:
      */
     QStringList allProjectsFiles() const;
 
+    /**
+     * version of the files of all open projects, changes if allProjectsFiles() changes
+     * @return version of the files of all projects
+     */
+    qulonglong allProjectsFilesVersion() const;
+
     /**
      * the main window we belong to
      * @return our main window
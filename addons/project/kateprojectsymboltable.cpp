@@ -0,0 +1,321 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2021 agent <agent@local>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "kateprojectsymboltable.h"
+
+#include <QFile>
+#include <QHash>
+#include <QSet>
+
+#include <kfts_fuzzy_match.h>
+
+#include <algorithm>
+
+bool KateProjectSymbolTable::parseLine(const QByteArray &line, KateProjectSymbol &symbol)
+{
+    /**
+     * skip pseudo tags and empty lines
+     */
+    if (line.isEmpty() || line.startsWith("!_")) {
+        return false;
+    }
+
+    /**
+     * name<TAB>file<TAB>address;"<TAB>fields...
+     */
+    const int nameEnd = line.indexOf('\t');
+    const int fileEnd = (nameEnd > 0) ? line.indexOf('\t', nameEnd + 1) : -1;
+    if (fileEnd < 0) {
+        return false;
+    }
+
+    symbol.name = QString::fromLocal8Bit(line.constData(), nameEnd);
+    symbol.file = QString::fromLocal8Bit(line.constData() + nameEnd + 1, fileEnd - nameEnd - 1);
+    symbol.kind.clear();
+    symbol.line = 0;
+
+    /**
+     * address is either a line number or a search pattern
+     * the pattern may contain tabs, skip it up to the unescaped delimiter
+     */
+    int pos = fileEnd + 1;
+    if (pos < line.size() && (line[pos] == '/' || line[pos] == '?')) {
+        const char delimiter = line[pos++];
+        while (pos < line.size() && line[pos] != delimiter) {
+            if (line[pos] == '\\') {
+                ++pos;
+            }
+            ++pos;
+        }
+        ++pos;
+    } else {
+        int number = 0;
+        while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9') {
+            number = number * 10 + (line[pos++] - '0');
+        }
+        symbol.line = number;
+    }
+
+    /**
+     * extension fields: a field without key is the kind
+     */
+    if (line.mid(pos, 3) != ";\"\t") {
+        return true;
+    }
+
+    for (const QByteArray &field : line.mid(pos + 3).split('\t')) {
+        const int colon = field.indexOf(':');
+        if (colon < 0) {
+            symbol.kind = QString::fromLocal8Bit(field);
+        } else if (field.startsWith("kind:")) {
+            symbol.kind = QString::fromLocal8Bit(field.mid(colon + 1));
+        } else if (field.startsWith("line:")) {
+            symbol.line = field.mid(colon + 1).toInt();
+        }
+    }
+
+    return true;
+}
+
+bool KateProjectSymbolTable::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_strings.clear();
+    m_kinds.clear();
+    m_symbols.clear();
+
+    /**
+     * intern all strings while reading
+     * the maps are only needed during loading
+     */
+    QHash<QString, quint32> stringIds;
+    QHash<QString, quint32> kindIds;
+    const auto intern = [](QHash<QString, quint32> &ids, QVector<QString> &strings, const QString &string) {
+        auto it = ids.constFind(string);
+        if (it != ids.constEnd()) {
+            return it.value();
+        }
+        const quint32 id = strings.size();
+        ids.insert(string, id);
+        strings.append(string);
+        return id;
+    };
+
+    KateProjectSymbol symbol;
+    QByteArray line;
+    while (!(line = file.readLine()).isEmpty()) {
+        line.chop(line.endsWith("\r\n") ? 2 : (line.endsWith('\n') ? 1 : 0));
+        if (!parseLine(line, symbol)) {
+            continue;
+        }
+
+        m_symbols.push_back(
+            {intern(stringIds, m_strings, symbol.name), intern(stringIds, m_strings, symbol.file), quint32(symbol.line), intern(kindIds, m_kinds, symbol.kind)});
+    }
+    m_strings.squeeze();
+    m_symbols.shrink_to_fit();
+
+    /**
+     * sort by name for binary search, keep file order for equal names
+     */
+    std::stable_sort(m_symbols.begin(), m_symbols.end(), [this](const Symbol &a, const Symbol &b) {
+        return a.name != b.name && m_strings[a.name] < m_strings[b.name];
+    });
+
+    /**
+     * case-insensitive order and distinct names
+     */
+    m_caseInsensitiveOrder.resize(m_symbols.size());
+    m_uniqueNames.clear();
+    m_uniqueNameMasks.clear();
+    for (quint32 i = 0; i < m_symbols.size(); ++i) {
+        m_caseInsensitiveOrder[i] = i;
+        if (i == 0 || m_symbols[i].name != m_symbols[i - 1].name) {
+            m_uniqueNames.push_back(i);
+            m_uniqueNameMasks.push_back(kfts::fuzzy_char_mask(m_strings[m_symbols[i].name]));
+        }
+    }
+    std::stable_sort(m_caseInsensitiveOrder.begin(), m_caseInsensitiveOrder.end(), [this](quint32 a, quint32 b) {
+        return m_strings[m_symbols[a].name].compare(m_strings[m_symbols[b].name], Qt::CaseInsensitive) < 0;
+    });
+
+    return true;
+}
+
+QVector<KateProjectSymbol> KateProjectSymbolTable::find(const QString &searchWord,
+                                                        int options,
+                                                        int maxResults,
+                                                        quint64 kindMask,
+                                                        const std::function<bool(const QString &)> &acceptFile,
+                                                        const QVector<KateProjectSymbol> &extraSymbols) const
+{
+    QVector<KateProjectSymbol> results;
+    if (searchWord.isEmpty() || (m_symbols.empty() && extraSymbols.isEmpty())) {
+        return results;
+    }
+
+    const bool unique = options & UniqueNames;
+    const auto full = [&results, maxResults]() {
+        return maxResults >= 0 && results.size() >= maxResults;
+    };
+    const auto accept = [&acceptFile, kindMask, this](const Symbol &symbol) {
+        return acceptKind(symbol, kindMask) && (!acceptFile || acceptFile(m_strings[symbol.file]));
+    };
+
+    /**
+     * extra symbols have no kind index, filter by name
+     */
+    const QStringList kinds = (kindMask != AllKinds && !extraSymbols.isEmpty()) ? kindNames(kindMask) : QStringList();
+    const auto acceptExtra = [&kinds, kindMask](const KateProjectSymbol &symbol) {
+        return kindMask == AllKinds || kinds.contains(symbol.kind);
+    };
+
+    /**
+     * names reported so far, if each name shall only be reported once
+     */
+    QSet<QString> names;
+    const auto add = [&results, &names, unique](const KateProjectSymbol &symbol) {
+        if (unique) {
+            if (names.contains(symbol.name)) {
+                return;
+            }
+            names.insert(symbol.name);
+        }
+        results.append(symbol);
+    };
+
+    /**
+     * fuzzy: score each distinct name once, best first
+     * the extra symbols are ranked in the same list, their index follows the table's
+     */
+    if (options & FuzzyMatch) {
+        std::vector<std::pair<int, quint32>> scored;
+        const quint64 searchMask = kfts::fuzzy_char_mask(searchWord);
+        for (size_t i = 0; i < m_uniqueNames.size(); ++i) {
+            const quint32 first = m_uniqueNames[i];
+            int score = 0;
+            if (kfts::fuzzy_match(searchWord, searchMask, m_strings[m_symbols[first].name], m_uniqueNameMasks[i], score)) {
+                scored.emplace_back(score, first);
+            }
+        }
+        for (int i = 0; i < extraSymbols.size(); ++i) {
+            const KateProjectSymbol &symbol = extraSymbols[i];
+            int score = 0;
+            if (acceptExtra(symbol) && kfts::fuzzy_match(searchWord, searchMask, symbol.name, kfts::fuzzy_char_mask(symbol.name), score)) {
+                scored.emplace_back(score, quint32(m_symbols.size() + i));
+            }
+        }
+        std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, quint32> &a, const std::pair<int, quint32> &b) {
+            return a.first > b.first;
+        });
+
+        for (const auto &match : scored) {
+            if (full()) {
+                break;
+            }
+            if (match.second >= m_symbols.size()) {
+                add(extraSymbols[match.second - m_symbols.size()]);
+                continue;
+            }
+            for (quint32 i = match.second; i < m_symbols.size() && m_symbols[i].name == m_symbols[match.second].name && !full(); ++i) {
+                if (accept(m_symbols[i])) {
+                    add(toSymbol(m_symbols[i]));
+                    if (unique) {
+                        break;
+                    }
+                }
+            }
+        }
+        return results;
+    }
+
+    /**
+     * prefix or full match: binary search for the first candidate, then scan
+     */
+    const Qt::CaseSensitivity cs = (options & IgnoreCase) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+    const bool prefix = options & PrefixMatch;
+    const auto matches = [&searchWord, cs, prefix](const QString &name) {
+        return prefix ? name.startsWith(searchWord, cs) : (name.compare(searchWord, cs) == 0);
+    };
+    const auto before = [cs](const QString &a, const QString &b) {
+        return (cs == Qt::CaseSensitive) ? (a < b) : (a.compare(b, Qt::CaseInsensitive) < 0);
+    };
+
+    /**
+     * matching extra symbols in table order, merged into the scan below
+     */
+    QVector<KateProjectSymbol> extraMatches;
+    for (const auto &symbol : extraSymbols) {
+        if (acceptExtra(symbol) && matches(symbol.name)) {
+            extraMatches.append(symbol);
+        }
+    }
+    std::stable_sort(extraMatches.begin(), extraMatches.end(), [&before](const KateProjectSymbol &a, const KateProjectSymbol &b) {
+        return before(a.name, b.name);
+    });
+    auto extra = extraMatches.cbegin();
+    const auto addSymbol = [&](const Symbol &symbol) {
+        const QString &name = m_strings[symbol.name];
+        for (; extra != extraMatches.cend() && before(extra->name, name) && !full(); ++extra) {
+            add(*extra);
+        }
+        if (accept(symbol) && !full()) {
+            add(toSymbol(symbol));
+        }
+    };
+
+    if (cs == Qt::CaseSensitive) {
+        auto it = std::lower_bound(m_symbols.cbegin(), m_symbols.cend(), searchWord, [this](const Symbol &symbol, const QString &word) {
+            return m_strings[symbol.name] < word;
+        });
+        for (; it != m_symbols.cend() && matches(m_strings[it->name]) && !full(); ++it) {
+            addSymbol(*it);
+        }
+    } else {
+        auto it = std::lower_bound(m_caseInsensitiveOrder.cbegin(), m_caseInsensitiveOrder.cend(), searchWord, [this](quint32 index, const QString &word) {
+            return m_strings[m_symbols[index].name].compare(word, Qt::CaseInsensitive) < 0;
+        });
+        for (; it != m_caseInsensitiveOrder.cend() && matches(m_strings[m_symbols[*it].name]) && !full(); ++it) {
+            addSymbol(m_symbols[*it]);
+        }
+    }
+
+    /**
+     * extra symbols sorting after all table matches
+     */
+    for (; extra != extraMatches.cend() && !full(); ++extra) {
+        add(*extra);
+    }
+
+    return results;
+}
+
+quint64 KateProjectSymbolTable::kindMask(const QStringList &kinds) const
+{
+    quint64 mask = 0;
+    for (int i = 0; i < m_kinds.size() && i < 64; ++i) {
+        if (kinds.contains(m_kinds[i])) {
+            mask |= quint64(1) << i;
+        }
+    }
+    return mask;
+}
+
+QStringList KateProjectSymbolTable::kindNames(quint64 kindMask) const
+{
+    QStringList kinds;
+    for (int i = 0; i < m_kinds.size(); ++i) {
+        if (i >= 64 || (kindMask & (quint64(1) << i))) {
+            kinds.append(m_kinds[i]);
+        }
+    }
+    return kinds;
+}
@@ -0,0 +1,195 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2021 agent <agent@local>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef KATE_PROJECT_SYMBOL_TABLE_H
+#define KATE_PROJECT_SYMBOL_TABLE_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+/**
+ * One symbol, as returned by queries.
+ * The strings are implicitly shared with the table, copying is cheap.
+ */
+struct KateProjectSymbol {
+    QString name;
+    QString kind;
+    QString file;
+    int line;
+};
+
+/**
+ * Compact in-memory representation of a ctags index file.
+ * All strings are interned, symbols are sorted by name to answer prefix queries
+ * via binary search, case-sensitive and case-insensitive.
+ * Is loaded once in a background thread, afterwards only read.
+ */
+class KateProjectSymbolTable
+{
+public:
+    /**
+     * Match options for queries.
+     */
+    enum MatchOption {
+        /**
+         * whole name must match
+         */
+        FullMatch = 0x0,
+
+        /**
+         * name must start with the search word
+         */
+        PrefixMatch = 0x1,
+
+        /**
+         * ignore case for full and prefix matches
+         */
+        IgnoreCase = 0x2,
+
+        /**
+         * fuzzy match, ranked by score
+         */
+        FuzzyMatch = 0x4,
+
+        /**
+         * only report each name once
+         */
+        UniqueNames = 0x8
+    };
+
+    /**
+     * mask accepting all kinds
+     */
+    static constexpr quint64 AllKinds = ~quint64(0);
+
+    /**
+     * Load the given ctags file, replaces the current content.
+     * @param fileName ctags file
+     * @return success, false if not readable
+     */
+    bool load(const QString &fileName);
+
+    /**
+     * Number of symbols.
+     * @return symbol count
+     */
+    int size() const
+    {
+        return int(m_symbols.size());
+    }
+
+    /**
+     * Search symbols.
+     * @param searchWord word to search for, not empty
+     * @param options combination of MatchOption
+     * @param maxResults maximal number of results, -1 for all
+     * @param kindMask kinds to report, see kindMask()
+     * @param acceptFile if set, only symbols of files for which this returns true are reported
+     * @param extraSymbols symbols not in the table, matched and ranked together with the table's own
+     * @return matching symbols, for fuzzy matches best first, else sorted by name
+     */
+    QVector<KateProjectSymbol> find(const QString &searchWord,
+                                    int options,
+                                    int maxResults = -1,
+                                    quint64 kindMask = AllKinds,
+                                    const std::function<bool(const QString &)> &acceptFile = {},
+                                    const QVector<KateProjectSymbol> &extraSymbols = {}) const;
+
+    /**
+     * Filter mask for the given kinds, for use with find.
+     * Kinds not known to this table are ignored.
+     * @param kinds kind names as reported by ctags
+     * @return mask for the kinds
+     */
+    quint64 kindMask(const QStringList &kinds) const;
+
+    /**
+     * Kinds contained in the given mask.
+     * @param kindMask mask, see kindMask()
+     * @return kind names
+     */
+    QStringList kindNames(quint64 kindMask) const;
+
+    /**
+     * Parse one line of a ctags file.
+     * Pseudo tags and malformed lines are rejected.
+     * @param line tags line, without line break
+     * @param symbol parsed symbol
+     * @return success
+     */
+    static bool parseLine(const QByteArray &line, KateProjectSymbol &symbol);
+
+private:
+    /**
+     * one symbol, all strings are indices into m_strings, kind indexes m_kinds
+     */
+    struct Symbol {
+        quint32 name;
+        quint32 file;
+        quint32 line;
+        quint32 kind;
+    };
+
+    /**
+     * create result for given symbol
+     */
+    KateProjectSymbol toSymbol(const Symbol &symbol) const
+    {
+        return {m_strings[symbol.name], m_kinds[symbol.kind], m_strings[symbol.file], int(symbol.line)};
+    }
+
+    /**
+     * is the kind of this symbol part of the mask?
+     */
+    static bool acceptKind(const Symbol &symbol, quint64 kindMask)
+    {
+        return symbol.kind >= 64 || (kindMask & (quint64(1) << symbol.kind));
+    }
+
+private:
+    /**
+     * interned names and file names
+     */
+    QVector<QString> m_strings;
+
+    /**
+     * interned kinds, few, index is the bit in kind masks
+     */
+    QVector<QString> m_kinds;
+
+    /**
+     * symbols, sorted by name
+     */
+    std::vector<Symbol> m_symbols;
+
+    /**
+     * symbol indices sorted by name, case-insensitive
+     */
+    std::vector<quint32> m_caseInsensitiveOrder;
+
+    /**
+     * index of first symbol for each distinct name, for fuzzy matching
+     */
+    std::vector<quint32> m_uniqueNames;
+
+    /**
+     * character mask for each distinct name, to reject fuzzy candidates early
+     */
+    std::vector<quint64> m_uniqueNameMasks;
+};
+
+/**
+ * Shared pointer to pass a loaded table between threads.
+ */
+typedef QSharedPointer<KateProjectSymbolTable> KateProjectSharedSymbolTable;
+
+#endif
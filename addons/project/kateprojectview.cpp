@@ -7,7 +7,7 @@
 
 #include "kateprojectview.h"
 #include "kateprojectpluginview.h"
-#include "kateprojectfiltermodel.h"
+#include "kateprojectworker.h"
 
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
@@ -15,10 +15,14 @@
 #include <KLineEdit>
 #include <KLocalizedString>
 
-#include <QSortFilterProxyModel>
-#include <QTimer>
+#include <ThreadWeaver/Queue>
+
 #include <QVBoxLayout>
 
+#include <kfts_fuzzy_match.h>
+
+#include <algorithm>
+
 KateProjectView::KateProjectView(KateProjectPluginView *pluginView, KateProject *project)
     : m_pluginView(pluginView)
     , m_project(project)
@@ -44,10 +48,37 @@ KateProjectView::KateProjectView(KateProjectPluginView *pluginView, KateProject
     m_filter->setPlaceholderText(i18n("Filter..."));
     m_filter->setClearButtonEnabled(true);
     connect(m_filter, &KLineEdit::textChanged, this, &KateProjectView::filterTextChanged);
+
+    /**
+     * a reloaded tree needs to be filtered again
+     */
+    connect(m_project, &KateProject::modelChanged, this, [this]() {
+        filterTextChanged(m_filter->text());
+    });
+
+    /**
+     * opened or closed untracked documents are not in the filter list, the proxy matches them itself
+     * their parent might need to be shown or hidden now
+     */
+    connect(m_project->model(), &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent, int first) {
+        if (isUntracked(m_project->model()->index(first, 0, parent))) {
+            static_cast<KateProjectFilterProxyModel *>(m_treeView->model())->refilter();
+        }
+    });
+    connect(m_project->model(), &QAbstractItemModel::rowsAboutToBeRemoved, this, [this](const QModelIndex &parent, int first) {
+        m_untrackedRemoved = isUntracked(m_project->model()->index(first, 0, parent));
+    });
+    connect(m_project->model(), &QAbstractItemModel::rowsRemoved, this, [this]() {
+        if (m_untrackedRemoved) {
+            m_untrackedRemoved = false;
+            static_cast<KateProjectFilterProxyModel *>(m_treeView->model())->refilter();
+        }
+    });
 }
 
 KateProjectView::~KateProjectView()
 {
+    cancelFilter();
 }
 
 void KateProjectView::selectFile(const QString &file)
@@ -63,14 +94,89 @@ void KateProjectView::openSelectedDocument()
 void KateProjectView::filterTextChanged(const QString &filterText)
 {
     /**
-     * filter
+     * results for the previous text are not needed anymore
      */
-    static_cast<KateProjectFilterProxyModel*>(m_treeView->model())->setFilterString(filterText);
+    cancelFilter();
 
     /**
-     * expand
+     * the flat list of the tree comes with the loaded project, nothing to filter before
      */
-    if (!filterText.isEmpty()) {
-        QTimer::singleShot(100, m_treeView, &QTreeView::expandAll);
+    KateProjectFilterProxyModel *proxy = static_cast<KateProjectFilterProxyModel *>(m_treeView->model());
+    const KateProjectSharedFilterList list = m_project->filterList();
+    if (filterText.isEmpty() || !list) {
+        proxy->clearFilter();
+        return;
+    }
+
+    /**
+     * match the items in chunks on the job queue, each chunk covers whole words of the bitmap
+     */
+    enum { ChunkSize = 64 * 128 };
+    const int count = list->names.size();
+    const int chunks = std::max(1, (count + ChunkSize - 1) / ChunkSize);
+
+    KateProjectSharedFilterRun filter(new KateProjectFilterRun());
+    filter->list = list;
+    filter->pattern = filterText;
+    filter->patternMask = kfts::fuzzy_char_mask(filterText);
+    filter->accepted.resize((count + 63) / 64, 0);
+    filter->remaining.storeRelease(chunks);
+    filter->cancel.reset(new QAtomicInt(0));
+    m_filterCancel = filter->cancel;
+
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        QSharedPointer<KateProjectFilterJob> job(new KateProjectFilterJob(filter, chunk * ChunkSize, std::min<int>(count, (chunk + 1) * ChunkSize)));
+        connect(job.data(), &KateProjectFilterJob::filterDone, this, [this, filter]() {
+            /**
+             * ignore results of an outdated pattern
+             */
+            if (filter->cancel != m_filterCancel) {
+                return;
+            }
+            m_filterCancel.reset();
+            m_filterJobs.clear();
+
+            static_cast<KateProjectFilterProxyModel *>(m_treeView->model())->setFilter(filter->list, std::move(filter->accepted), filter->pattern);
+            expandAccepted(QModelIndex());
+        });
+        m_filterJobs.append(job);
+    }
+    m_project->weaver()->enqueue(m_filterJobs);
+}
+
+void KateProjectView::expandAccepted(const QModelIndex &parent)
+{
+    /**
+     * the proxy only shows accepted rows, items are created below them only
+     */
+    QAbstractItemModel *proxy = m_treeView->model();
+    if (proxy->canFetchMore(parent)) {
+        proxy->fetchMore(parent);
+    }
+
+    for (int row = 0; row < proxy->rowCount(parent); ++row) {
+        const QModelIndex index = proxy->index(row, 0, parent);
+        if (proxy->hasChildren(index)) {
+            expandAccepted(index);
+            m_treeView->expand(index);
+        }
+    }
+}
+
+bool KateProjectView::isUntracked(const QModelIndex &index)
+{
+    return index.data(Qt::UserRole + 3).toBool();
+}
+
+void KateProjectView::cancelFilter()
+{
+    if (m_filterCancel) {
+        m_filterCancel->storeRelease(1);
+        m_filterCancel.reset();
+    }
+
+    for (const auto &job : qAsConst(m_filterJobs)) {
+        m_project->weaver()->dequeue(job);
     }
+    m_filterJobs.clear();
 }
@@ -9,8 +9,13 @@
 #define KATE_PROJECT_VIEW_H
 
 #include "kateproject.h"
+#include "kateprojectfiltermodel.h"
 #include "kateprojectviewtree.h"
 
+#include <ThreadWeaver/JobPointer>
+
+#include <QVector>
+
 class KLineEdit;
 class KateProjectPluginView;
 
@@ -62,6 +67,25 @@ private Q_SLOTS:
      */
     void filterTextChanged(const QString &filterText);
 
+private:
+    /**
+     * Cancel the running filter jobs, if any.
+     */
+    void cancelFilter();
+
+    /**
+     * Expand the accepted rows below parent, creates the items of lazy directories on the way.
+     * @param parent index of the proxy model
+     */
+    void expandAccepted(const QModelIndex &parent);
+
+    /**
+     * Is the item an untracked document?
+     * @param index index of the project model
+     * @return true, if the item is an untracked document
+     */
+    static bool isUntracked(const QModelIndex &index);
+
 private:
     /**
      * our plugin view
@@ -82,6 +106,17 @@ private:
      * filter
      */
     KLineEdit *m_filter;
+
+    /**
+     * cancel flag and jobs of the running filter
+     */
+    KateProjectIndexCancelFlag m_filterCancel;
+    QVector<ThreadWeaver::JobPointer> m_filterJobs;
+
+    /**
+     * set while untracked documents are removed from the model
+     */
+    bool m_untrackedRemoved = false;
 };
 
 #endif
@@ -39,7 +39,7 @@ KateProjectViewTree::KateProjectViewTree(KateProjectPluginView *pluginView, Kate
 
     // sortModel->setFilterRole(SortFilterRole);
     // sortModel->setSortRole(SortFilterRole);
-    sortModel->setRecursiveFilteringEnabled(true);
+    // no recursive filtering, the accepted items already include the ancestors of the matches
     sortModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
     sortModel->setSortCaseSensitivity(Qt::CaseInsensitive);
     sortModel->setSourceModel(m_project->model());
@@ -17,17 +17,25 @@
 #include <QSettings>
 #include <QTime>
 
-KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force)
+#include <kfts_fuzzy_match.h>
+
+KateProjectWorker::KateProjectWorker(const QString &baseDir, const QVariantMap &projectMap, const KateProjectIndexCancelFlag &cancel)
     : m_baseDir(baseDir)
-    , m_indexDir(indexDir)
     , m_projectMap(projectMap)
-    , m_force(force)
+    , m_cancel(cancel)
 {
     Q_ASSERT(!m_baseDir.isEmpty());
 }
 
 void KateProjectWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
 {
+    /**
+     * project got reloaded or closed while we were queued
+     */
+    if (m_cancel->loadAcquire()) {
+        return;
+    }
+
     /**
      * Create dummy top level parent item and empty map inside shared pointers
      * then load the project recursively
@@ -37,14 +45,11 @@ void KateProjectWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
     loadProject(topLevel.data(), m_projectMap, file2Item.data());
 
     /**
-     * create some local backup of some data we need for further processing!
+     * the flat list to filter the tree is built here, too, not on the first filter in the main thread
      */
-    QStringList files = file2Item->keys();
-
-    emit loadDone(topLevel, file2Item);
+    const KateProjectSharedFilterList filterList = KateProjectFilterList::build(topLevel.data());
 
-    // trigger index loading, will internally handle enable/disabled
-    loadIndex(files, m_force);
+    emit loadDone(topLevel, file2Item, filterList);
 }
 
 void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item)
@@ -81,64 +86,6 @@ void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &pr
     }
 }
 
-/**
- * small helper to construct directory parent items
- * @param dir2Item map for path => item
- * @param path current path we need item for
- * @return correct parent item for given path, will reuse existing ones
- */
-static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item, QString path)
-{
-    /**
-     * throw away simple /
-     */
-    if (path == QLatin1String("/")) {
-        path = QString();
-    }
-
-    /**
-     * quick check: dir already seen?
-     */
-    if (dir2Item.contains(path)) {
-        return dir2Item[path];
-    }
-
-    /**
-     * else: construct recursively
-     */
-    int slashIndex = path.lastIndexOf(QLatin1Char('/'));
-
-    /**
-     * no slash?
-     * simple, no recursion, append new item toplevel
-     */
-    if (slashIndex < 0) {
-        dir2Item[path] = new KateProjectItem(KateProjectItem::Directory, path);
-        dir2Item[QString()]->appendRow(dir2Item[path]);
-        return dir2Item[path];
-    }
-
-    /**
-     * else, split and recurse
-     */
-    const QString leftPart = path.left(slashIndex);
-    const QString rightPart = path.right(path.size() - (slashIndex + 1));
-
-    /**
-     * special handling if / with nothing on one side are found
-     */
-    if (leftPart.isEmpty() || rightPart.isEmpty()) {
-        return directoryParent(dir2Item, leftPart.isEmpty() ? rightPart : leftPart);
-    }
-
-    /**
-     * else: recurse on left side
-     */
-    dir2Item[path] = new KateProjectItem(KateProjectItem::Directory, rightPart);
-    directoryParent(dir2Item, leftPart)->appendRow(dir2Item[path]);
-    return dir2Item[path];
-}
-
 void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item)
 {
     QDir dir(m_baseDir);
@@ -155,16 +102,17 @@ void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap
     files.sort(Qt::CaseInsensitive);
 
     /**
-     * construct paths first in tree and items in a map
+     * collect the files with their path in the tree
+     * only the first level gets items, directories create theirs on demand
      */
-    QMap<QString, QStandardItem *> dir2Item;
-    dir2Item[QString()] = parent;
-    QList<QPair<QStandardItem *, QStandardItem *>> item2ParentPath;
+    QVector<KateProjectItem::LazyFile> lazyFiles;
+    lazyFiles.reserve(files.size());
+    QSet<QString> seen;
     for (const QString &filePath : files) {
         /**
          * skip dupes
          */
-        if (file2Item->contains(filePath)) {
+        if (file2Item->contains(filePath) || seen.contains(filePath)) {
             continue;
         }
 
@@ -175,34 +123,26 @@ void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap
         if (!fileInfo.isFile()) {
             continue;
         }
+        seen.insert(filePath);
 
         /**
-         * construct the item with right directory prefix
-         * already hang in directories in tree
+         * get the directory's relative path to the base directory, without empty parts like for "."
          */
-        KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, fileInfo.fileName());
-        fileItem->setData(filePath, Qt::ToolTipRole);
-
-        // get the directory's relative path to the base directory
-        QString dirRelPath = dir.relativeFilePath(fileInfo.absolutePath());
-        // if the relative path is ".", clean it up
-        if (dirRelPath == QLatin1Char('.')) {
-            dirRelPath = QString();
+        QString treePath = dir.relativeFilePath(fileInfo.absolutePath());
+        if (treePath == QLatin1Char('.')) {
+            treePath.clear();
         }
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+        QStringList parts = treePath.split(QLatin1Char('/'), QString::SkipEmptyParts);
+#else
+        QStringList parts = treePath.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+#endif
+        parts.append(fileInfo.fileName());
 
-        item2ParentPath.append(QPair<QStandardItem *, QStandardItem *>(fileItem, directoryParent(dir2Item, dirRelPath)));
-        fileItem->setData(filePath, Qt::UserRole);
-        (*file2Item)[filePath] = fileItem;
+        lazyFiles.append({parts.join(QLatin1Char('/')), filePath});
     }
 
-    /**
-     * plug in the file items to the tree
-     */
-    auto i = item2ParentPath.constBegin();
-    while (i != item2ParentPath.constEnd()) {
-        i->second->appendRow(i->first);
-        ++i;
-    }
+    KateProjectItem::appendFiles(parent, lazyFiles, file2Item);
 }
 
 QStringList KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &filesEntry)
@@ -460,8 +400,30 @@ QStringList KateProjectWorker::filesFromDirectory(const QDir &_dir, bool recursi
     return files;
 }
 
-void KateProjectWorker::loadIndex(const QStringList &files, bool force)
+KateProjectIndexWorker::KateProjectIndexWorker(const QString &baseDir,
+                                               const QString &indexDir,
+                                               const QVariantMap &projectMap,
+                                               const QStringList &files,
+                                               bool force,
+                                               const KateProjectIndexCancelFlag &cancel)
+    : m_baseDir(baseDir)
+    , m_indexDir(indexDir)
+    , m_projectMap(projectMap)
+    , m_files(files)
+    , m_force(force)
+    , m_cancel(cancel)
+{
+}
+
+void KateProjectIndexWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
 {
+    /**
+     * project got reloaded or closed while we were queued
+     */
+    if (m_cancel->loadAcquire()) {
+        return;
+    }
+
     const QString keyCtags = QStringLiteral("ctags");
     const QVariantMap ctagsMap = m_projectMap[keyCtags].toMap();
     /**
@@ -483,7 +445,80 @@ void KateProjectWorker::loadIndex(const QStringList &files, bool force)
      * create new index, this will do the loading in the constructor
      * wrap it into shared pointer for transfer to main thread
      */
-    KateProjectSharedProjectIndex index(new KateProjectIndex(m_baseDir, m_indexDir, files, ctagsMap, force));
+    KateProjectSharedProjectIndex index(new KateProjectIndex(m_baseDir, m_indexDir, m_files, ctagsMap, m_force, m_cancel, [this](int done, int total) {
+        emit loadIndexProgress(done, total);
+    }));
+
+    /**
+     * project got reloaded or closed meanwhile, the index is of no use
+     */
+    if (m_cancel->loadAcquire()) {
+        return;
+    }
 
     emit loadIndexDone(index);
 }
+
+KateProjectIndexCompactJob::KateProjectIndexCompactJob(const QString &indexFile, const QString &target, const KateProjectIndexOverlay &overlay)
+    : m_indexFile(indexFile)
+    , m_target(target)
+    , m_overlay(overlay)
+{
+}
+
+void KateProjectIndexCompactJob::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
+{
+    KateProjectSharedSymbolTable symbols;
+    if (KateProjectIndex::writeCompactedIndex(m_indexFile, m_target, m_overlay)) {
+        symbols.reset(new KateProjectSymbolTable());
+        if (!symbols->load(m_target)) {
+            symbols.reset();
+        }
+    }
+    emit compactionDone(symbols);
+}
+
+KateProjectFilterJob::KateProjectFilterJob(const KateProjectSharedFilterRun &filter, int begin, int end)
+    : m_filter(filter)
+    , m_begin(begin)
+    , m_end(end)
+{
+}
+
+void KateProjectFilterJob::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
+{
+    const KateProjectFilterList &list = *m_filter->list;
+    quint64 *accepted = m_filter->accepted.data();
+
+    /**
+     * each job owns the words of the bitmap for its range, no locking needed
+     * a newer pattern is checked for once per word
+     */
+    for (int id = m_begin; id < m_end; ++id) {
+        if ((id % 64) == 0 && m_filter->cancel->loadAcquire()) {
+            return;
+        }
+
+        int score = 0;
+        if (kfts::fuzzy_match(m_filter->pattern, m_filter->patternMask, list.names[id], list.masks[id], score)) {
+            accepted[id / 64] |= quint64(1) << (id % 64);
+        }
+    }
+
+    if (m_filter->remaining.fetchAndAddAcqRel(-1) != 1 || m_filter->cancel->loadAcquire()) {
+        return;
+    }
+
+    /**
+     * last job: the ancestors of accepted items are accepted, too
+     * parents have smaller ids than their children, one pass from the back is enough
+     */
+    for (int id = list.parents.size() - 1; id >= 0; --id) {
+        const int parent = list.parents[id];
+        if (parent >= 0 && ((accepted[id / 64] >> (id % 64)) & 1)) {
+            accepted[parent / 64] |= quint64(1) << (parent % 64);
+        }
+    }
+
+    emit filterDone();
+}
@@ -9,6 +9,7 @@
 #define KATE_PROJECT_WORKER_H
 
 #include "kateproject.h"
+#include "kateprojectfiltermodel.h"
 #include "kateprojectitem.h"
 
 #include <ThreadWeaver/Job>
@@ -18,9 +19,22 @@
 
 class QDir;
 
+/**
+ * Priorities of the project jobs, higher ones are started first.
+ * All trees are built before any index, the active project comes first for both.
+ * Filtering the tree is interactive and goes before all loading.
+ */
+enum KateProjectJobPriority {
+    IndexJobPriority = 0,
+    TreeJobPriority = 10,
+    ActiveProjectPriorityBoost = 20,
+    FilterJobPriority = 100
+};
+
 /**
  * Class representing a project background worker.
- * This worker will build up the model for the project on load and do other stuff in the background.
+ * This worker will enumerate the files of the project and build up the model for it.
+ * The index is created afterwards by a separate KateProjectIndexWorker.
  */
 class KateProjectWorker : public QObject, public ThreadWeaver::Job
 {
@@ -32,13 +46,26 @@ public:
      */
     typedef QMap<QString, KateProjectItem *> MapString2Item;
 
-    explicit KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force);
+    explicit KateProjectWorker(const QString &baseDir, const QVariantMap &projectMap, const KateProjectIndexCancelFlag &cancel);
 
     void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
 
+    int priority() const override
+    {
+        return m_priority;
+    }
+
+    /**
+     * Change the priority, only allowed while the job is not queued.
+     * @param priority new priority
+     */
+    void setPriority(int priority)
+    {
+        m_priority = priority;
+    }
+
 Q_SIGNALS:
-    void loadDone(KateProjectSharedQStandardItem topLevel, KateProjectSharedQMapStringItem file2Item);
-    void loadIndexDone(KateProjectSharedProjectIndex index);
+    void loadDone(KateProjectSharedQStandardItem topLevel, KateProjectSharedQMapStringItem file2Item, KateProjectSharedFilterList filterList);
 
 private:
     /**
@@ -58,12 +85,6 @@ private:
      */
     void loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item);
 
-    /**
-     * Load index for whole project.
-     * @param files list of all project files to index
-     */
-    void loadIndex(const QStringList &files, bool force);
-
     QStringList findFiles(const QDir &dir, const QVariantMap &filesEntry);
 
     QStringList filesFromGit(const QDir &dir, bool recursive);
@@ -85,13 +106,168 @@ private:
      */
     const QString m_baseDir;
 
+    const QVariantMap m_projectMap;
+
     /**
-     * index directory
+     * set by the project if this load is obsolete
      */
-    const QString m_indexDir;
+    const KateProjectIndexCancelFlag m_cancel;
+
+    /**
+     * scheduling priority, see KateProjectJobPriority
+     */
+    int m_priority = TreeJobPriority;
+};
+
+/**
+ * Background job creating the ctags index of a loaded project.
+ * Scheduled after the project tree is there, can be canceled or deferred by its priority.
+ */
+class KateProjectIndexWorker : public QObject, public ThreadWeaver::Job
+{
+    Q_OBJECT
+
+public:
+    KateProjectIndexWorker(const QString &baseDir,
+                           const QString &indexDir,
+                           const QVariantMap &projectMap,
+                           const QStringList &files,
+                           bool force,
+                           const KateProjectIndexCancelFlag &cancel);
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+    int priority() const override
+    {
+        return m_priority;
+    }
+
+    /**
+     * Change the priority, only allowed while the job is not queued.
+     * @param priority new priority
+     */
+    void setPriority(int priority)
+    {
+        m_priority = priority;
+    }
 
+Q_SIGNALS:
+    void loadIndexDone(KateProjectSharedProjectIndex index);
+    void loadIndexProgress(int done, int total);
+
+private:
+    const QString m_baseDir;
+    const QString m_indexDir;
     const QVariantMap m_projectMap;
+    const QStringList m_files;
     const bool m_force;
+
+    /**
+     * set by the project if this load is obsolete
+     */
+    const KateProjectIndexCancelFlag m_cancel;
+
+    /**
+     * scheduling priority, see KateProjectJobPriority
+     */
+    int m_priority = IndexJobPriority;
+};
+
+/**
+ * Background job to fold the overlay of updated files into the ctags index file.
+ */
+class KateProjectIndexCompactJob : public QObject, public ThreadWeaver::Job
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param indexFile current index file
+     * @param target file to write the compacted index to
+     * @param overlay overlay snapshot to fold in
+     */
+    KateProjectIndexCompactJob(const QString &indexFile, const QString &target, const KateProjectIndexOverlay &overlay);
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+Q_SIGNALS:
+    /**
+     * symbols of the compacted index, null on failure
+     */
+    void compactionDone(KateProjectSharedSymbolTable symbols);
+
+private:
+    const QString m_indexFile;
+    const QString m_target;
+    const KateProjectIndexOverlay m_overlay;
+};
+
+/**
+ * State shared by the jobs filtering the project tree for one pattern.
+ */
+struct KateProjectFilterRun {
+    /**
+     * items to filter
+     */
+    KateProjectSharedFilterList list;
+
+    /**
+     * pattern and its character mask
+     */
+    QString pattern;
+    quint64 patternMask;
+
+    /**
+     * bit per item of list, set for matching items and their ancestors once all jobs are done
+     */
+    std::vector<quint64> accepted;
+
+    /**
+     * jobs not finished yet
+     */
+    QAtomicInt remaining;
+
+    /**
+     * set if the pattern is outdated
+     */
+    KateProjectIndexCancelFlag cancel;
+};
+
+typedef QSharedPointer<KateProjectFilterRun> KateProjectSharedFilterRun;
+
+/**
+ * Background job fuzzy matching one range of the items of a filter run.
+ * The job finishing last adds the ancestors of the matches.
+ */
+class KateProjectFilterJob : public QObject, public ThreadWeaver::Job
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param filter filter run this job is part of
+     * @param begin first item id to match, a multiple of 64
+     * @param end item id after the last one to match, a multiple of 64 or the size of the list
+     */
+    KateProjectFilterJob(const KateProjectSharedFilterRun &filter, int begin, int end);
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+    int priority() const override
+    {
+        return FilterJobPriority;
+    }
+
+Q_SIGNALS:
+    /**
+     * Emitted by the job finishing last, the accepted bitmap of the run is complete.
+     */
+    void filterDone();
+
+private:
+    const KateProjectSharedFilterRun m_filter;
+    const int m_begin;
+    const int m_end;
 };
 
 #endif
@@ -9,7 +9,6 @@
 
 #include <KLocalizedString>
 #include <QRegularExpression>
-#include <QThread>
 
 KateProjectCodeAnalysisToolCppcheck::KateProjectCodeAnalysisToolCppcheck(QObject *parent)
     : KateProjectCodeAnalysisTool(parent)
@@ -50,7 +49,8 @@ QStringList KateProjectCodeAnalysisToolCppcheck::arguments()
 {
     QStringList _args;
 
-    _args << QStringLiteral("-q") << QStringLiteral("-f") << QStringLiteral("-j") + QString::number(QThread::idealThreadCount()) << QStringLiteral("--inline-suppr") << QStringLiteral("--enable=all")
+    // no -j, the files are split over parallel cppcheck runs
+    _args << QStringLiteral("-q") << QStringLiteral("-f") << QStringLiteral("--inline-suppr") << QStringLiteral("--enable=all")
           << QStringLiteral("--template={file}////{line}////{severity}////{message}") << QStringLiteral("--file-list=-");
 
     return _args;
@@ -73,12 +73,7 @@ QStringList KateProjectCodeAnalysisToolCppcheck::parseLine(const QString &line)
 QString KateProjectCodeAnalysisToolCppcheck::stdinMessages()
 {
     // filenames are written to stdin (--file-list=-)
-
-    if (!m_project) {
-        return QString();
-    }
-
-    auto &&fileList = filter(m_project->files());
+    const QStringList fileList = filesToAnalyze();
     setActualFilesCount(fileList.size());
     return fileList.join(QLatin1Char('\n'));
 }
@@ -61,11 +61,9 @@ QStringList KateProjectCodeAnalysisToolFlake8::arguments()
            */
           << QStringLiteral("--format=%(path)s////%(row)d////%(code)s////%(text)s");
 
-    if (m_project) {
-        auto &&fileList = filter(m_project->files());
-        setActualFilesCount(fileList.size());
-        _args.append(fileList);
-    }
+    const QStringList fileList = filesToAnalyze();
+    setActualFilesCount(fileList.size());
+    _args.append(fileList);
 
     return _args;
 }
@@ -59,11 +59,9 @@ QStringList KateProjectCodeAnalysisToolShellcheck::arguments()
 
     _args << QStringLiteral("--format=gcc");
 
-    if (m_project) {
-        auto &&fileList = filter(m_project->files());
-        setActualFilesCount(fileList.size());
-        _args.append(fileList);
-    }
+    const QStringList fileList = filesToAnalyze();
+    setActualFilesCount(fileList.size());
+    _args.append(fileList);
 
     return _args;
 }
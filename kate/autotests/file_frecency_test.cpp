@@ -0,0 +1,112 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "file_frecency_test.h"
+#include "katefilefrecency.h"
+#include "katesession.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTestWidgets>
+
+QTEST_MAIN(KateFileFrecencyTest)
+
+void KateFileFrecencyTest::init()
+{
+    m_tmpdir = new QTemporaryDir;
+    QVERIFY(m_tmpdir->isValid());
+}
+
+void KateFileFrecencyTest::cleanup()
+{
+    delete m_tmpdir;
+}
+
+void KateFileFrecencyTest::recordAndDecay()
+{
+    KateFileFrecency f(m_tmpdir->path() + QStringLiteral("/history"));
+    const QString a = QStringLiteral("/src/a.cpp");
+    const qint64 t0 = 1600000000;
+
+    QCOMPARE(f.frecency(a, t0), 0.0);
+
+    f.recordAccess(a, t0);
+    QCOMPARE(f.frecency(a, t0), 1.0);
+
+    // one half-life later half of it is left, a new access adds one
+    const qint64 t1 = t0 + KateFileFrecency::HalfLife;
+    QCOMPARE(f.frecency(a, t1), 0.5);
+    f.recordAccess(a, t1);
+    QCOMPARE(f.frecency(a, t1), 1.5);
+    QCOMPARE(f.frecency(a, t1 + KateFileFrecency::HalfLife), 0.75);
+
+    const auto all = f.frecencies(t1);
+    QCOMPARE(all.size(), 1);
+    QCOMPARE(all.value(a), 1.5);
+}
+
+void KateFileFrecencyTest::saveAndLoad()
+{
+    const QString file = m_tmpdir->path() + QStringLiteral("/history");
+    const QString a = QStringLiteral("/src/a.cpp");
+    const QString b = QStringLiteral("/src/b.cpp");
+
+    {
+        KateFileFrecency f(file);
+        f.recordAccess(a);
+        f.recordAccess(a);
+        f.recordAccess(b);
+        QVERIFY(f.save());
+    }
+    QVERIFY(QFile::exists(file));
+
+    KateFileFrecency f(file);
+    QVERIFY(qAbs(f.frecency(a) - 2.0) < 0.01);
+    QVERIFY(qAbs(f.frecency(b) - 1.0) < 0.01);
+    QCOMPARE(f.frecency(QStringLiteral("/src/c.cpp")), 0.0);
+}
+
+void KateFileFrecencyTest::maxEntries()
+{
+    const QString file = m_tmpdir->path() + QStringLiteral("/history");
+    const QString often = QStringLiteral("/often.cpp");
+
+    {
+        KateFileFrecency f(file);
+        f.recordAccess(often);
+        f.recordAccess(often);
+        for (int i = 0; i < KateFileFrecency::MaxEntries + 10; ++i) {
+            f.recordAccess(QStringLiteral("/file%1.cpp").arg(i));
+        }
+    }
+
+    // only the files with the highest frecency are kept
+    KateFileFrecency f(file);
+    QCOMPARE(f.frecencies().size(), int(KateFileFrecency::MaxEntries));
+    QVERIFY(f.frecency(often) > 1.5);
+}
+
+void KateFileFrecencyTest::sessionSetFile()
+{
+    const QString file1 = m_tmpdir->path() + QStringLiteral("/one.katesession");
+    const QString file2 = m_tmpdir->path() + QStringLiteral("/two.katesession");
+    const QString a = QStringLiteral("/src/a.cpp");
+
+    KateSession::Ptr s = KateSession::create(file1, QStringLiteral("session name"));
+    s->fileFrecency()->recordAccess(a);
+    QVERIFY(s->fileFrecency()->save());
+    QVERIFY(QFile::exists(KateSession::fileFrecencyFile(file1)));
+
+    // the history follows the session file
+    s->setFile(file2);
+    QVERIFY(!QFile::exists(KateSession::fileFrecencyFile(file1)));
+    QVERIFY(QFile::exists(KateSession::fileFrecencyFile(file2)));
+    QCOMPARE(s->fileFrecency()->file(), KateSession::fileFrecencyFile(file2));
+
+    KateSession::Ptr copy = KateSession::createFrom(s, file1, QStringLiteral("copy"));
+    QVERIFY(qAbs(copy->fileFrecency()->frecency(a) - 1.0) < 0.01);
+}
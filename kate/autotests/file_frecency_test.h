@@ -0,0 +1,30 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_FILE_FRECENCY_TEST_H
+#define KATE_FILE_FRECENCY_TEST_H
+
+#include <QObject>
+
+class KateFileFrecencyTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void recordAndDecay();
+    void saveAndLoad();
+    void maxEntries();
+    void sessionSetFile();
+
+private:
+    class QTemporaryDir *m_tmpdir;
+};
+
+#endif
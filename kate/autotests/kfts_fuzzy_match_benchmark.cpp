@@ -0,0 +1,198 @@
+/*
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+/**
+ * Benchmark for kfts::fuzzy_match, reports the time per candidate.
+ *
+ * Usage: kfts_fuzzy_match_benchmark [corpus file]
+ *
+ * The corpus file contains one candidate per line, e.g. the output of "git ls-files" or of ctags.
+ * Without one, a deterministic corpus of 500000 file paths and symbol names is generated.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <kfts_fuzzy_match.h>
+
+#include <cstdio>
+
+/**
+ * parts the generated corpus is built of
+ */
+static const char *const directories[] = {"src", "lib", "include", "core", "gui", "widgets", "models", "views", "utils", "network",
+                                          "plugins", "tests", "autotests", "data", "3rdparty", "kernel", "io", "text", "render", "document"};
+static const char *const words[] = {"text", "editor", "view", "document", "manager", "model", "index", "project", "session", "window",
+                                    "search", "replace", "symbol", "client", "server", "request", "response", "cursor", "range", "highlight",
+                                    "buffer", "line", "layout", "config", "plugin", "action", "completion", "filter", "tree", "item",
+                                    "worker", "job", "queue", "cache", "parser", "token", "diagnostic", "file", "path", "url"};
+static const char *const extensions[] = {".cpp", ".h", ".c", ".py", ".js", ".json", ".txt", ".md", ".xml", ".ui"};
+
+/**
+ * deterministic pseudo random numbers, same corpus on all platforms
+ */
+class Random
+{
+public:
+    quint32 next(quint32 bound)
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return (m_state >> 8) % bound;
+    }
+
+private:
+    quint32 m_state = 42;
+};
+
+template<size_t N>
+static QString pick(Random &random, const char *const (&array)[N])
+{
+    return QString::fromLatin1(array[random.next(N)]);
+}
+
+static QString capitalized(const QString &word)
+{
+    return word.left(1).toUpper() + word.mid(1);
+}
+
+static QStringList generateCorpus(int size)
+{
+    Random random;
+    QStringList corpus;
+    corpus.reserve(size);
+    while (corpus.size() < size) {
+        // file path: some directories, a file name of some words, an extension
+        QString path;
+        const int depth = 1 + random.next(5);
+        for (int i = 0; i < depth; ++i) {
+            path += pick(random, directories) + QLatin1Char('/');
+        }
+        const int parts = 1 + random.next(3);
+        for (int i = 0; i < parts; ++i) {
+            path += pick(random, words);
+        }
+        corpus.append(path + pick(random, extensions));
+
+        // symbol name: camel case, snake case or member
+        QString symbol;
+        const int style = random.next(3);
+        const int symbolParts = 1 + random.next(4);
+        for (int i = 0; i < symbolParts; ++i) {
+            const QString word = pick(random, words);
+            if (style == 0) {
+                symbol += (i == 0) ? word : capitalized(word);
+            } else if (style == 1) {
+                symbol += (i == 0) ? word : (QLatin1Char('_') + word);
+            } else {
+                symbol += (i == 0) ? (QStringLiteral("m_") + word) : capitalized(word);
+            }
+        }
+        corpus.append(symbol);
+    }
+    return corpus;
+}
+
+static QStringList readCorpus(const QString &fileName)
+{
+    QStringList corpus;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return corpus;
+    }
+    QTextStream stream(&file);
+    QString line;
+    while (stream.readLineInto(&line)) {
+        if (!line.isEmpty()) {
+            corpus.append(line);
+        }
+    }
+    return corpus;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments();
+    const QStringList corpus = (arguments.size() > 1) ? readCorpus(arguments[1]) : generateCorpus(500000);
+    if (corpus.isEmpty()) {
+        std::fprintf(stderr, "empty corpus\n");
+        return 1;
+    }
+
+    // precomputed data, as the quick open model keeps it
+    QVector<QString> folded;
+    QVector<quint64> masks;
+    folded.reserve(corpus.size());
+    masks.reserve(corpus.size());
+    for (const auto &candidate : corpus) {
+        folded.append(kfts::fuzzy_fold(candidate));
+        masks.append(kfts::fuzzy_char_mask(candidate));
+    }
+
+    std::printf("%d candidates\n", corpus.size());
+    std::printf("%-20s %10s %14s %14s %14s\n", "pattern", "matches", "plain ns/cand", "mask ns/cand", "folded ns/cand");
+
+    const QStringList patterns = {QStringLiteral("v"),
+                                  QStringLiteral("mw"),
+                                  QStringLiteral("doc"),
+                                  QStringLiteral("tree"),
+                                  QStringLiteral("mgrcpp"),
+                                  QStringLiteral("textedit"),
+                                  QStringLiteral("projectindex"),
+                                  QStringLiteral("src/core/view.cpp"),
+                                  QStringLiteral("zzqx")};
+    for (const auto &pattern : patterns) {
+        const quint64 patternMask = kfts::fuzzy_char_mask(pattern);
+        int matches = 0;
+        qint64 plainSum = 0;
+        qint64 maskedSum = 0;
+        qint64 foldedSum = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const auto &candidate : corpus) {
+            int score = 0;
+            if (kfts::fuzzy_match(pattern, candidate, score)) {
+                ++matches;
+                plainSum += score;
+            }
+        }
+        const double plain = double(timer.nsecsElapsed()) / corpus.size();
+
+        timer.restart();
+        for (int i = 0; i < corpus.size(); ++i) {
+            int score = 0;
+            if (kfts::fuzzy_match(pattern, patternMask, corpus[i], masks[i], score)) {
+                maskedSum += score;
+            }
+        }
+        const double masked = double(timer.nsecsElapsed()) / corpus.size();
+
+        timer.restart();
+        for (int i = 0; i < corpus.size(); ++i) {
+            int score = 0;
+            if (kfts::fuzzy_match(pattern, patternMask, corpus[i], folded[i], masks[i], score)) {
+                foldedSum += score;
+            }
+        }
+        const double withFolded = double(timer.nsecsElapsed()) / corpus.size();
+
+        // the overloads must agree, this also keeps the loops from being optimized away
+        if (plainSum != maskedSum || plainSum != foldedSum) {
+            std::fprintf(stderr, "scores differ for pattern %s\n", qPrintable(pattern));
+            return 1;
+        }
+
+        std::printf("%-20s %10d %14.1f %14.1f %14.1f\n", qPrintable(pattern), matches, plain, masked, withFolded);
+    }
+
+    return 0;
+}
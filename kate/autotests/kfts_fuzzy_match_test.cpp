@@ -0,0 +1,238 @@
+/*
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "kfts_fuzzy_match_test.h"
+
+#include <QTest>
+
+#include <kfts_fuzzy_match.h>
+
+#include <algorithm>
+
+QTEST_MAIN(KftsFuzzyMatchTest)
+
+/**
+ * fixed corpus for the ranking tests, don't change, the expected rankings depend on it
+ */
+static const QStringList &corpus()
+{
+    static const QStringList corpus = {
+        QStringLiteral("kate/kateapp.cpp"),
+        QStringLiteral("kate/kateapp.h"),
+        QStringLiteral("kate/katemainwindow.cpp"),
+        QStringLiteral("kate/katemainwindow.h"),
+        QStringLiteral("kate/kateviewmanager.cpp"),
+        QStringLiteral("kate/kateviewspace.cpp"),
+        QStringLiteral("kate/katedocmanager.cpp"),
+        QStringLiteral("kate/quickopen/katequickopen.cpp"),
+        QStringLiteral("kate/quickopen/katequickopenmodel.cpp"),
+        QStringLiteral("kate/quickopen/katequickopenlineedit.cpp"),
+        QStringLiteral("addons/project/kateproject.cpp"),
+        QStringLiteral("addons/project/kateprojectindex.cpp"),
+        QStringLiteral("addons/project/kateprojectworker.cpp"),
+        QStringLiteral("addons/project/kateprojectview.cpp"),
+        QStringLiteral("addons/project/kateprojectpluginview.cpp"),
+        QStringLiteral("addons/lspclient/lspclientserver.cpp"),
+        QStringLiteral("addons/lspclient/lspclientpluginview.cpp"),
+        QStringLiteral("addons/lspclient/lspclientsymbolview.cpp"),
+        QStringLiteral("addons/lspclient/lspclientcompletion.cpp"),
+        QStringLiteral("shared/kfts_fuzzy_match.h"),
+        QStringLiteral("CMakeLists.txt"),
+        QStringLiteral("README.md"),
+        QStringLiteral("main.cpp"),
+        QStringLiteral("KateMainWindow"),
+        QStringLiteral("KateViewManager"),
+        QStringLiteral("KateQuickOpen"),
+        QStringLiteral("KateProjectIndex"),
+        QStringLiteral("LSPClientServer"),
+        QStringLiteral("LSPClientPluginView"),
+        QStringLiteral("updateViewGeometry"),
+        QStringLiteral("slotDocumentUrlChanged"),
+        QStringLiteral("slotViewChanged"),
+        QStringLiteral("fuzzy_match"),
+        QStringLiteral("fuzzy_match_simple"),
+        QStringLiteral("setFilterText"),
+        QStringLiteral("m_projectIndex"),
+        QStringLiteral("m_mainWindow"),
+        QStringLiteral("index_queue_policy"),
+        QStringLiteral("MAX_MODELS"),
+        QStringLiteral("kfts"),
+    };
+    return corpus;
+}
+
+void KftsFuzzyMatchTest::basicMatches()
+{
+    int score = 0;
+
+    // empty pattern or string never match
+    QVERIFY(!kfts::fuzzy_match(QStringView(), QStringLiteral("kate"), score));
+    QVERIFY(!kfts::fuzzy_match(QStringLiteral("kate"), QStringView(), score));
+
+    // letters must appear in order, case doesn't matter
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("kte"), QStringLiteral("kate"), score));
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("KATE"), QStringLiteral("kate"), score));
+    QVERIFY(!kfts::fuzzy_match(QStringLiteral("etk"), QStringLiteral("kate"), score));
+    QVERIFY(!kfts::fuzzy_match(QStringLiteral("kates"), QStringLiteral("kate"), score));
+
+    // simple match agrees
+    QVERIFY(kfts::fuzzy_match_simple(QStringLiteral("kte"), QStringLiteral("kate")));
+    QVERIFY(!kfts::fuzzy_match_simple(QStringLiteral("etk"), QStringLiteral("kate")));
+
+    // exact prefix scores better than scattered letters
+    int prefixScore = 0;
+    int scatteredScore = 0;
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("view"), QStringLiteral("viewmanager"), prefixScore));
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("view"), QStringLiteral("valueitemeditwidget"), scatteredScore));
+    QVERIFY(prefixScore > scatteredScore);
+
+    // match positions past 255 work
+    const QString longString = QString(300, QLatin1Char('x')) + QStringLiteral("kate");
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("kate"), longString, score));
+}
+
+void KftsFuzzyMatchTest::matchPositions()
+{
+    int score = 0;
+    QVector<int> positions;
+
+    // camel humps are preferred over the first occurrence of a letter
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("kqo"), QStringLiteral("KateQuickOpen"), score, positions));
+    QCOMPARE(positions, QVector<int>({0, 4, 9}));
+
+    // letters after separators are preferred
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("fm"), QStringLiteral("fuzzy_match"), score, positions));
+    QCOMPARE(positions, QVector<int>({0, 6}));
+
+    // same score as without positions
+    int scoreWithoutPositions = 0;
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("fm"), QStringLiteral("fuzzy_match"), scoreWithoutPositions));
+    QCOMPARE(score, scoreWithoutPositions);
+
+    // no match, no positions
+    QVERIFY(!kfts::fuzzy_match(QStringLiteral("xyz"), QStringLiteral("fuzzy_match"), score, positions));
+    QVERIFY(positions.isEmpty());
+
+    // byte buffer variant
+    uint8_t matches[2];
+    QVERIFY(kfts::fuzzy_match(QStringLiteral("fm"), QStringLiteral("fuzzy_match"), score, matches, 2));
+    QCOMPARE(int(matches[0]), 0);
+    QCOMPARE(int(matches[1]), 6);
+    QVERIFY(!kfts::fuzzy_match(QStringLiteral("fma"), QStringLiteral("fuzzy_match"), score, matches, 2));
+}
+
+void KftsFuzzyMatchTest::masksAndFolding()
+{
+    // all overloads agree on the whole corpus
+    const QStringList patterns = {QStringLiteral("kate"), QStringLiteral("KVM"), QStringLiteral("lsp"), QStringLiteral("x"), QStringLiteral("_m")};
+    for (const auto &pattern : patterns) {
+        const quint64 patternMask = kfts::fuzzy_char_mask(pattern);
+        for (const auto &candidate : corpus()) {
+            int score = 0;
+            int maskScore = 0;
+            int foldedScore = 0;
+            const QString folded = kfts::fuzzy_fold(candidate);
+            QCOMPARE(folded.size(), candidate.size());
+            const bool res = kfts::fuzzy_match(pattern, candidate, score);
+            QCOMPARE(kfts::fuzzy_match(pattern, patternMask, candidate, kfts::fuzzy_char_mask(candidate), maskScore), res);
+            QCOMPARE(kfts::fuzzy_match(pattern, patternMask, candidate, folded, kfts::fuzzy_char_mask(candidate), foldedScore), res);
+            if (res) {
+                QCOMPARE(maskScore, score);
+                QCOMPARE(foldedScore, score);
+            }
+        }
+    }
+}
+
+void KftsFuzzyMatchTest::goldenRanking_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("kqo") << QStringLiteral("kqo")
+                         << QStringList{QStringLiteral("KateQuickOpen"),
+                                        QStringLiteral("kate/quickopen/katequickopen.cpp"),
+                                        QStringLiteral("kate/quickopen/katequickopenmodel.cpp"),
+                                        QStringLiteral("kate/quickopen/katequickopenlineedit.cpp")};
+    QTest::newRow("kateproj") << QStringLiteral("kateproj")
+                              << QStringList{QStringLiteral("KateProjectIndex"),
+                                             QStringLiteral("addons/project/kateproject.cpp"),
+                                             QStringLiteral("addons/project/kateprojectview.cpp"),
+                                             QStringLiteral("addons/project/kateprojectindex.cpp"),
+                                             QStringLiteral("addons/project/kateprojectworker.cpp")};
+    QTest::newRow("lsp") << QStringLiteral("lsp")
+                         << QStringList{QStringLiteral("LSPClientPluginView"),
+                                        QStringLiteral("LSPClientServer"),
+                                        QStringLiteral("addons/lspclient/lspclientserver.cpp"),
+                                        QStringLiteral("addons/lspclient/lspclientpluginview.cpp"),
+                                        QStringLiteral("addons/lspclient/lspclientsymbolview.cpp")};
+    QTest::newRow("view") << QStringLiteral("view")
+                          << QStringList{QStringLiteral("KateViewManager"),
+                                         QStringLiteral("slotViewChanged"),
+                                         QStringLiteral("updateViewGeometry"),
+                                         QStringLiteral("LSPClientPluginView"),
+                                         QStringLiteral("kate/kateviewspace.cpp")};
+    QTest::newRow("fm") << QStringLiteral("fm")
+                        << QStringList{QStringLiteral("fuzzy_match"), QStringLiteral("fuzzy_match_simple"), QStringLiteral("shared/kfts_fuzzy_match.h")};
+    QTest::newRow("kmw") << QStringLiteral("kmw")
+                         << QStringList{QStringLiteral("KateMainWindow"), QStringLiteral("kate/katemainwindow.h"), QStringLiteral("kate/katemainwindow.cpp")};
+    QTest::newRow("cpp") << QStringLiteral("cpp")
+                         << QStringList{QStringLiteral("main.cpp"),
+                                        QStringLiteral("kate/kateapp.cpp"),
+                                        QStringLiteral("kate/kateviewspace.cpp"),
+                                        QStringLiteral("kate/katemainwindow.cpp"),
+                                        QStringLiteral("kate/katedocmanager.cpp")};
+    QTest::newRow("lspsv") << QStringLiteral("lspsv")
+                           << QStringList{QStringLiteral("LSPClientServer"),
+                                          QStringLiteral("addons/lspclient/lspclientserver.cpp"),
+                                          QStringLiteral("addons/lspclient/lspclientpluginview.cpp"),
+                                          QStringLiteral("addons/lspclient/lspclientsymbolview.cpp")};
+    QTest::newRow("mw") << QStringLiteral("mw")
+                        << QStringList{QStringLiteral("m_mainWindow"),
+                                       QStringLiteral("KateMainWindow"),
+                                       QStringLiteral("kate/katemainwindow.h"),
+                                       QStringLiteral("kate/katemainwindow.cpp"),
+                                       QStringLiteral("addons/lspclient/lspclientsymbolview.cpp")};
+    QTest::newRow("idx") << QStringLiteral("idx")
+                         << QStringList{QStringLiteral("m_projectIndex"),
+                                        QStringLiteral("KateProjectIndex"),
+                                        QStringLiteral("index_queue_policy"),
+                                        QStringLiteral("addons/project/kateprojectindex.cpp")};
+    QTest::newRow("fuzzy") << QStringLiteral("fuzzy")
+                           << QStringList{QStringLiteral("fuzzy_match"), QStringLiteral("fuzzy_match_simple"), QStringLiteral("shared/kfts_fuzzy_match.h")};
+    QTest::newRow("pv") << QStringLiteral("pv")
+                        << QStringList{QStringLiteral("LSPClientPluginView"),
+                                       QStringLiteral("updateViewGeometry"),
+                                       QStringLiteral("LSPClientServer"),
+                                       QStringLiteral("addons/project/kateprojectview.cpp"),
+                                       QStringLiteral("addons/lspclient/lspclientserver.cpp")};
+    QTest::newRow("KVM") << QStringLiteral("KVM") << QStringList{QStringLiteral("KateViewManager"), QStringLiteral("kate/kateviewmanager.cpp")};
+    QTest::newRow("setf") << QStringLiteral("setf") << QStringList{QStringLiteral("setFilterText"), QStringLiteral("shared/kfts_fuzzy_match.h")};
+}
+
+void KftsFuzzyMatchTest::goldenRanking()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QStringList, expected);
+
+    // best score first, corpus order for equal scores
+    QVector<QPair<int, QString>> results;
+    for (const auto &candidate : corpus()) {
+        int score = 0;
+        if (kfts::fuzzy_match(pattern, candidate, score)) {
+            results.append(qMakePair(score, candidate));
+        }
+    }
+    std::stable_sort(results.begin(), results.end(), [](const QPair<int, QString> &a, const QPair<int, QString> &b) {
+        return a.first > b.first;
+    });
+
+    QStringList top;
+    for (int i = 0; i < results.size() && i < 5; ++i) {
+        top.append(results[i].second);
+    }
+    QCOMPARE(top, expected);
+}
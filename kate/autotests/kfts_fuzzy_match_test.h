@@ -0,0 +1,21 @@
+/*
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <QObject>
+
+class KftsFuzzyMatchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void basicMatches();
+    void matchPositions();
+    void masksAndFolding();
+    void goldenRanking_data();
+    void goldenRanking();
+};
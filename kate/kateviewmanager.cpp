@@ -11,7 +11,9 @@
 
 #include "config.h"
 #include "kateapp.h"
+#include "katefilefrecency.h"
 #include "katemainwindow.h"
+#include "katesessionmanager.h"
 #include "kateupdatedisabler.h"
 #include "kateviewspace.h"
 
@@ -407,9 +409,21 @@ void KateViewManager::documentsDeleted(const QList<KTextEditor::Document *> &)
     mainWindow()->setUpdatesEnabled(true);
 }
 
+/**
+ * remember the access of the document in the file access history of the session
+ */
+static void recordFileAccess(KTextEditor::Document *doc)
+{
+    KateSession::Ptr session = KateApp::self()->sessionManager()->activeSession();
+    if (session && doc->url().isLocalFile()) {
+        session->fileFrecency()->recordAccess(doc->url().toLocalFile());
+    }
+}
+
 void KateViewManager::documentSavedOrUploaded(KTextEditor::Document *doc, bool)
 {
     m_mainWindow->addRecentOpenedFile(doc->url());
+    recordFileAccess(doc);
 }
 
 KTextEditor::View *KateViewManager::createView(KTextEditor::Document *doc, KateViewSpace *vs)
@@ -658,6 +672,10 @@ void KateViewManager::slotViewChanged()
     if (activeView() && !activeView()->hasFocus()) {
         activeView()->setFocus();
     }
+
+    if (activeView()) {
+        recordFileAccess(activeView()->document());
+    }
 }
 
 void KateViewManager::activateNextView()
@@ -22,6 +22,7 @@
 #include <KPluginFactory>
 #include <KSharedConfig>
 
+#include <QAbstractProxyModel>
 #include <QBoxLayout>
 #include <QCoreApplication>
 #include <QDesktopWidget>
@@ -29,166 +30,361 @@
 #include <QFileInfo>
 #include <QHeaderView>
 #include <QLabel>
-#include <QPainter>
 #include <QPointer>
-#include <QSortFilterProxyModel>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QStandardItemModel>
-#include <QStyledItemDelegate>
-#include <QTextDocument>
+#include <QThreadPool>
 #include <QTreeView>
 
+#include <fuzzyhighlightdelegate.h>
 #include <kfts_fuzzy_match.h>
 
-class QuickOpenFilterProxyModel : public QSortFilterProxyModel
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+/**
+ * Runs the work for the given number of chunks on the global thread pool and the calling thread.
+ * Returns once all chunks are processed.
+ */
+class QuickOpenChunkRunner : public QRunnable
 {
 public:
+    QuickOpenChunkRunner(const std::function<void()> &work, QSemaphore &done)
+        : m_work(work)
+        , m_done(done)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        m_work();
+        m_done.release();
+    }
+
+    static void runChunks(int chunks, const std::function<void(int)> &processChunk)
+    {
+        QAtomicInt nextChunk(0);
+        const std::function<void()> work = [&nextChunk, chunks, &processChunk]() {
+            for (int chunk = nextChunk.fetchAndAddRelaxed(1); chunk < chunks; chunk = nextChunk.fetchAndAddRelaxed(1)) {
+                processChunk(chunk);
+            }
+        };
+
+        QThreadPool *pool = QThreadPool::globalInstance();
+        QSemaphore done;
+        std::vector<std::unique_ptr<QuickOpenChunkRunner>> helpers;
+        for (int i = 1; i < std::min(chunks, pool->maxThreadCount()); ++i) {
+            helpers.emplace_back(new QuickOpenChunkRunner(work, done));
+            pool->start(helpers.back().get());
+        }
+
+        work();
+
+        // helpers that did not start yet are not needed anymore, wait for the others
+        int running = 0;
+        for (const auto &helper : helpers) {
+            if (!pool->tryTake(helper.get())) {
+                ++running;
+            }
+        }
+        done.acquire(running);
+    }
+
+private:
+    const std::function<void()> &m_work;
+    QSemaphore &m_done;
+};
+
+/**
+ * Filters and sorts the quick open model by fuzzy matching.
+ * Matches the precomputed strings of the model, scores are kept in a side array.
+ * The frecency bonus of the model is added to the score of each match.
+ * Matching runs chunked in parallel, an extended pattern only re-checks the previous matches.
+ * Only the rows shown are sorted, more are sorted on demand via fetchMore.
+ */
+class QuickOpenFilterProxyModel : public QAbstractProxyModel
+{
+public:
+    enum {
+        /**
+         * rows sorted and shown at once
+         */
+        BatchSize = 256,
+
+        /**
+         * candidates per parallel chunk
+         */
+        ChunkSize = 8192
+    };
+
     QuickOpenFilterProxyModel(QObject *parent = nullptr)
-        : QSortFilterProxyModel(parent)
+        : QAbstractProxyModel(parent)
     {
     }
 
+    void setSourceModel(QAbstractItemModel *model) override
+    {
+        if (sourceModel()) {
+            disconnect(sourceModel(), nullptr, this, nullptr);
+        }
+
+        beginResetModel();
+        QAbstractProxyModel::setSourceModel(model);
+        resetScores();
+        filter(false);
+        m_visible = std::min<int>(m_matches.size(), BatchSize);
+        endResetModel();
+
+        connect(model, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+            beginResetModel();
+        });
+        connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+            resetScores();
+            filter(false);
+            m_visible = std::min<int>(m_matches.size(), BatchSize);
+            endResetModel();
+        });
+    }
+
     void changeMode(FilterModes m)
     {
         mode = m;
+        filter(false);
+        updateRows();
     }
 
-protected:
-    bool lessThan(const QModelIndex &sourceLeft, const QModelIndex &sourceRight) const override
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override
     {
-        int l = sourceLeft.data(KateQuickOpenModel::Score).toInt();
-        int r = sourceRight.data(KateQuickOpenModel::Score).toInt();
-        return l < r;
+        if (parent.isValid() || row < 0 || row >= m_visible || column != 0) {
+            return QModelIndex();
+        }
+        return createIndex(row, column);
     }
 
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    QModelIndex parent(const QModelIndex &) const override
     {
-        if (pattern.isEmpty())
-            return true;
-        const QString fileName = sourceModel()->index(sourceRow, 0, sourceParent).data().toString();
-        const auto nameAndPath = fileName.splitRef(QStringLiteral("{[split]}"));
+        return QModelIndex();
+    }
 
-        const auto &name = nameAndPath.at(0);
-        const auto &path = nameAndPath.at(1);
-        int score = 0;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_visible;
+    }
 
-        bool res = false;
-        if (mode == FilterMode::FilterByName) {
-            res = filterByName(name, score);
-        } else if (mode == FilterMode::FilterByPath) {
-            res = filterByPath(path, score);
-        } else {
-            int scorep = 0, scoren = 0;
-            bool resp = filterByPath(path, scorep);
-            bool resn = filterByName(name, scoren);
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : 1;
+    }
 
-            // store the score for sorting later
-            score = scoren + scorep;
-            res = resp || resn;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override
+    {
+        if (!sourceModel() || !proxyIndex.isValid() || proxyIndex.row() >= m_matches.size()) {
+            return QModelIndex();
         }
+        return sourceModel()->index(m_matches[proxyIndex.row()], proxyIndex.column());
+    }
 
-        auto idx = sourceModel()->index(sourceRow, 0, sourceParent);
-        sourceModel()->setData(idx, score, KateQuickOpenModel::Score);
-
-        return res;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override
+    {
+        if (!sourceIndex.isValid()) {
+            return QModelIndex();
+        }
+        for (int row = 0; row < m_visible; ++row) {
+            if (m_matches[row] == sourceIndex.row()) {
+                return index(row, sourceIndex.column());
+            }
+        }
+        return QModelIndex();
     }
 
-public Q_SLOTS:
-    void setFilterText(const QString &text)
+    bool canFetchMore(const QModelIndex &parent) const override
     {
-        beginResetModel();
-        pattern = text;
-        endResetModel();
+        return !parent.isValid() && m_visible < m_matches.size();
     }
 
-private:
-    inline bool filterByPath(const QStringRef &path, int &score) const
+    void fetchMore(const QModelIndex &parent) override
     {
-        return kfts::fuzzy_match(pattern, path, score);
+        if (!canFetchMore(parent)) {
+            return;
+        }
+
+        const int count = std::min<int>(m_matches.size(), m_visible + BatchSize);
+        sortUpTo(count);
+        beginInsertRows(QModelIndex(), m_visible, count - 1);
+        m_visible = count;
+        endInsertRows();
     }
 
-    inline bool filterByName(const QStringRef &name, int &score) const
+public Q_SLOTS:
+    void setFilterText(const QString &text)
     {
-        return kfts::fuzzy_match(pattern, name, score);
+        // the matches of an extended pattern are a subset of the current matches
+        const bool extended = !pattern.isEmpty() && text.startsWith(pattern, Qt::CaseInsensitive);
+        pattern = text;
+        filter(extended);
+        updateRows();
     }
 
 private:
-    QString pattern;
-    FilterModes mode;
-};
-
-class QuickOpenStyleDelegate : public QStyledItemDelegate
-{
-public:
-    QuickOpenStyleDelegate(QObject *parent = nullptr)
-        : QStyledItemDelegate(parent)
+    /**
+     * scores are indexed by source row
+     */
+    void resetScores()
     {
+        m_model = static_cast<const KateQuickOpenModel *>(sourceModel());
+        m_scores.fill(0, m_model ? m_model->rowCount() : 0);
     }
 
-    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    /**
+     * compute the matches for the current pattern, either from all rows or from the current matches
+     * the top rows are sorted afterwards
+     */
+    void filter(bool onlyMatches)
     {
-        QStyleOptionViewItem options = option;
-        initStyleOption(&options, index);
+        const int count = m_scores.size();
+        m_sorted = 0;
+
+        // no pattern: all rows in model order
+        if (pattern.isEmpty()) {
+            m_matches.resize(count);
+            std::iota(m_matches.begin(), m_matches.end(), 0);
+            m_sorted = count;
+            return;
+        }
 
-        QTextDocument doc;
+        QVector<int> candidates;
+        if (onlyMatches) {
+            candidates = m_matches;
+        } else {
+            candidates.resize(count);
+            std::iota(candidates.begin(), candidates.end(), 0);
+        }
 
-        QString str = index.data().toString();
+        // chunks write disjoint parts of the score array, results are joined in chunk order
+        const quint64 patternMask = kfts::fuzzy_char_mask(pattern);
+        int *scores = m_scores.data();
+        const int chunks = (candidates.size() + ChunkSize - 1) / ChunkSize;
+        std::vector<QVector<int>> chunkMatches(chunks);
+        const int *rows = candidates.constData();
+        const int candidateCount = candidates.size();
+        const auto processChunk = [this, rows, candidateCount, &chunkMatches, patternMask, scores](int chunk) {
+            const int end = std::min<int>(candidateCount, (chunk + 1) * ChunkSize);
+            QVector<int> &matches = chunkMatches[chunk];
+            for (int i = chunk * ChunkSize; i < end; ++i) {
+                const int row = rows[i];
+                if (matchRow(row, patternMask, scores[row])) {
+                    scores[row] += m_model->frecencyBonus(row);
+                    matches.append(row);
+                }
+            }
+        };
 
-        auto namePath = str.split(QStringLiteral("{[split]}"));
-        QString name = namePath.at(0);
-        QString path = namePath.at(1);
+        if (chunks > 1) {
+            QuickOpenChunkRunner::runChunks(chunks, processChunk);
+        } else if (chunks == 1) {
+            processChunk(0);
+        }
 
-        const QString nameColor = option.palette.color(QPalette::Link).name();
+        m_matches.clear();
+        for (const auto &matches : chunkMatches) {
+            m_matches += matches;
+        }
+        sortUpTo(std::min<int>(m_matches.size(), BatchSize));
+    }
 
+    /**
+     * match one row with the current pattern and mode
+     */
+    bool matchRow(int row, quint64 patternMask, int &score) const
+    {
+        score = 0;
         if (mode == FilterMode::FilterByName) {
-            kfts::to_fuzzy_matched_display_string(m_filterString, name, QStringLiteral("<b style=\"color:%1;\">").arg(nameColor), QStringLiteral("</b>"));
+            return matchString(m_model->fileNameId(row), patternMask, score);
         } else if (mode == FilterMode::FilterByPath) {
-            kfts::to_fuzzy_matched_display_string(m_filterString, path, QStringLiteral("<b>"), QStringLiteral("</b>"));
-        } else {
-            kfts::to_fuzzy_matched_display_string(m_filterString, name, QStringLiteral("<b style=\"color:%1;\">").arg(nameColor), QStringLiteral("</b>"));
-            kfts::to_fuzzy_matched_display_string(m_filterString, path, QStringLiteral("<b>"), QStringLiteral("</b>"));
+            return matchString(m_model->filePathId(row), patternMask, score);
         }
 
-        const auto pathFontsize = option.font.pointSize();
-        doc.setHtml(QStringLiteral("<span style=\"font-size: %1pt;\">").arg(pathFontsize) + name + QStringLiteral("</span>") + QStringLiteral(" &nbsp;") +
-                    QStringLiteral("<span style=\"color:gray; font-size:%1pt;\">").arg(pathFontsize - 1) + path + QStringLiteral("</span>"));
-        doc.setDocumentMargin(2);
+        int scorep = 0, scoren = 0;
+        bool resp = matchString(m_model->filePathId(row), patternMask, scorep);
+        bool resn = matchString(m_model->fileNameId(row), patternMask, scoren);
 
-        painter->save();
-
-        // paint background
-        if (option.state & QStyle::State_Selected) {
-            painter->fillRect(option.rect, option.palette.highlight());
-        } else {
-            painter->fillRect(option.rect, option.palette.base());
-        }
+        // the score for sorting later
+        score = (resp ? scorep : 0) + (resn ? scoren : 0);
+        return resp || resn;
+    }
 
-        options.text = QString(); // clear old text
-        options.widget->style()->drawControl(QStyle::CE_ItemViewItem, &options, painter, options.widget);
+    /**
+     * match one string of the model's string table with the current pattern
+     */
+    bool matchString(int id, quint64 patternMask, int &score) const
+    {
+        return kfts::fuzzy_match(pattern, patternMask, m_model->string(id), m_model->foldedString(id), m_model->stringMask(id), score);
+    }
 
-        // draw text
-        painter->translate(option.rect.x(), option.rect.y());
-        if (index.column() == 0) {
-            painter->translate(25, 0);
+    /**
+     * ensure the first count matches are sorted by score, best first, model order for equal scores
+     */
+    void sortUpTo(int count)
+    {
+        if (count <= m_sorted) {
+            return;
         }
-        doc.drawContents(painter);
 
-        painter->restore();
+        const int *scores = m_scores.constData();
+        std::partial_sort(m_matches.begin() + m_sorted, m_matches.begin() + count, m_matches.end(), [scores](int a, int b) {
+            return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+        });
+        m_sorted = count;
     }
 
-    void changeMode(FilterModes m)
+    /**
+     * update the shown rows to the current matches, without reset
+     */
+    void updateRows()
     {
-        mode = m;
-    }
+        const int oldVisible = m_visible;
+        const int newVisible = std::min<int>(m_matches.size(), BatchSize);
+
+        if (newVisible < oldVisible) {
+            beginRemoveRows(QModelIndex(), newVisible, oldVisible - 1);
+            m_visible = newVisible;
+            endRemoveRows();
+        } else if (newVisible > oldVisible) {
+            beginInsertRows(QModelIndex(), oldVisible, newVisible - 1);
+            m_visible = newVisible;
+            endInsertRows();
+        }
 
-public Q_SLOTS:
-    void setFilterString(const QString &text)
-    {
-        m_filterString = text;
+        const int changed = std::min(oldVisible, newVisible);
+        if (changed > 0) {
+            emit dataChanged(index(0, 0), index(changed - 1, 0));
+        }
     }
 
 private:
-    QString m_filterString;
-    FilterModes mode;
+    QString pattern;
+    FilterModes mode{FilterMode::FilterByName, FilterMode::FilterByPath};
+
+    /**
+     * the source model, provides the strings and their masks
+     */
+    const KateQuickOpenModel *m_model = nullptr;
+
+    /**
+     * score of the last match, by source row
+     */
+    QVector<int> m_scores;
+
+    /**
+     * matching source rows, the first m_sorted are sorted, the first m_visible are shown
+     */
+    QVector<int> m_matches;
+    int m_sorted = 0;
+    int m_visible = 0;
 };
 
 Q_DECLARE_METATYPE(QPointer<KTextEditor::Document>)
@@ -215,31 +411,31 @@ KateQuickOpen::KateQuickOpen(KateMainWindow *mainWindow)
     m_base_model = new KateQuickOpenModel(m_mainWindow, this);
 
     m_model = new QuickOpenFilterProxyModel(this);
-    m_model->setFilterRole(Qt::DisplayRole);
-    m_model->setSortRole(KateQuickOpenModel::Score);
-    m_model->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setSortCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setFilterKeyColumn(Qt::DisplayRole);
 
-    m_styleDelegate = new QuickOpenStyleDelegate(this);
+    m_styleDelegate = new FuzzyHighlightDelegate(this);
+    m_styleDelegate->setSecondaryText([](const QModelIndex &index) {
+        return index.data(KateQuickOpenModel::FilePathRole).toString();
+    });
     m_listView->setItemDelegate(m_styleDelegate);
 
     connect(m_inputLine, &QuickOpenLineEdit::textChanged, m_model, &QuickOpenFilterProxyModel::setFilterText);
-    connect(m_inputLine, &QuickOpenLineEdit::textChanged, m_styleDelegate, &QuickOpenStyleDelegate::setFilterString);
+    connect(m_inputLine, &QuickOpenLineEdit::textChanged, m_styleDelegate, [this](const QString &text) {
+        m_styleDelegate->setFilterString(text);
+    });
     connect(m_inputLine, &QuickOpenLineEdit::textChanged, this, [this]() {
         m_listView->viewport()->update();
     });
     connect(m_inputLine, &QuickOpenLineEdit::returnPressed, this, &KateQuickOpen::slotReturnPressed);
     connect(m_inputLine, &QuickOpenLineEdit::filterModeChanged, this, &KateQuickOpen::slotfilterModeChanged);
     connect(m_inputLine, &QuickOpenLineEdit::listModeChanged, this, &KateQuickOpen::slotListModeChanged);
-    connect(m_model, &QSortFilterProxyModel::rowsInserted, this, &KateQuickOpen::reselectFirst);
-    connect(m_model, &QSortFilterProxyModel::rowsRemoved, this, &KateQuickOpen::reselectFirst);
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &KateQuickOpen::reselectFirst);
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, &KateQuickOpen::reselectFirst);
+    connect(m_model, &QAbstractItemModel::dataChanged, this, &KateQuickOpen::reselectFirst);
 
     connect(m_listView, &QTreeView::activated, this, &KateQuickOpen::slotReturnPressed);
     connect(m_listView, &QTreeView::clicked, this, &KateQuickOpen::slotReturnPressed); // for single click
 
     m_listView->setModel(m_model);
-    m_listView->setSortingEnabled(true);
     m_model->setSourceModel(m_base_model);
 
     m_inputLine->installEventFilter(this);
@@ -338,8 +534,15 @@ void KateQuickOpen::slotfilterModeChanged(FilterModes mode)
 {
     m_filterMode = mode;
     m_model->changeMode(mode);
-    m_styleDelegate->changeMode(mode);
-    m_model->invalidate();
+    int highlight = 0;
+    if (mode & FilterMode::FilterByName) {
+        highlight |= FuzzyHighlightDelegate::HighlightText;
+    }
+    if (mode & FilterMode::FilterByPath) {
+        highlight |= FuzzyHighlightDelegate::HighlightSecondaryText;
+    }
+    m_styleDelegate->setHighlight(highlight);
+    m_listView->viewport()->update();
 }
 
 void KateQuickOpen::slotListModeChanged(KateQuickOpenModel::List mode)
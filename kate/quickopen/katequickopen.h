@@ -17,7 +17,7 @@ class KateMainWindow;
 class QModelIndex;
 class QStandardItemModel;
 class QSortFilterProxyModel;
-class QuickOpenStyleDelegate;
+class FuzzyHighlightDelegate;
 class QTreeView;
 class KateQuickOpenModel;
 enum KateQuickOpenModelList : int;
@@ -58,7 +58,7 @@ private:
     KateMainWindow *m_mainWindow;
     QTreeView *m_listView;
     QuickOpenLineEdit *m_inputLine;
-    QuickOpenStyleDelegate *m_styleDelegate;
+    FuzzyHighlightDelegate *m_styleDelegate;
     FilterModes m_filterMode;
 
     /**
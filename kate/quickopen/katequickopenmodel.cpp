@@ -8,7 +8,9 @@
 #include "katequickopenmodel.h"
 
 #include "kateapp.h"
+#include "katefilefrecency.h"
 #include "katemainwindow.h"
+#include "katesessionmanager.h"
 #include "kateviewmanager.h"
 
 #include <ktexteditor/document.h>
@@ -16,6 +18,12 @@
 
 #include <QMimeDatabase>
 
+#include <kfts_fuzzy_match.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 KateQuickOpenModel::KateQuickOpenModel(KateMainWindow *mainWindow, QObject *parent)
     : QAbstractTableModel(parent)
     , m_mainWindow(mainWindow)
@@ -27,7 +35,7 @@ int KateQuickOpenModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid()) {
         return 0;
     }
-    return m_modelEntries.size();
+    return m_openEntries.size() + m_projectRows.size();
 }
 
 int KateQuickOpenModel::columnCount(const QModelIndex &parent) const
@@ -42,24 +50,25 @@ QVariant KateQuickOpenModel::data(const QModelIndex &idx, int role) const
         return {};
     }
 
-    auto entry = m_modelEntries.at(idx.row());
+    const int row = idx.row();
+    const bool bold = row < m_openEntries.size();
     if (role == Qt::DisplayRole) {
         switch (idx.column()) {
         case Columns::FileName:
-            return QString(entry.fileName + QStringLiteral("{[split]}") + entry.filePath);
+            return m_strings[fileNameId(row)];
         }
+    } else if (role == Role::FilePathRole) {
+        return m_strings[filePathId(row)];
     } else if (role == Qt::FontRole) {
-        if (entry.bold) {
+        if (bold) {
             QFont font;
             font.setBold(true);
             return font;
         }
     } else if (role == Qt::DecorationRole) {
-        return QIcon::fromTheme(QMimeDatabase().mimeTypeForFile(entry.fileName, QMimeDatabase::MatchExtension).iconName());
+        return m_icons[bold ? m_openEntries[row].icon : m_projectFileIcons[m_projectRows[row - m_openEntries.size()]]];
     } else if (role == Qt::UserRole) {
-        return entry.url;
-    } else if (role == Role::Score) {
-        return entry.score;
+        return bold ? m_openEntries[row].url : QUrl::fromLocalFile(m_projectFiles[m_projectRows[row - m_openEntries.size()]]);
     }
 
     return {};
@@ -70,7 +79,6 @@ void KateQuickOpenModel::refresh()
     QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
     const QList<KTextEditor::View *> sortedViews = m_mainWindow->viewManager()->sortedViews();
     const QList<KTextEditor::Document *> openDocs = KateApp::self()->documentManager()->documentList();
-    const QStringList projectDocs = projectView ? (m_listMode == CurrentProject ? projectView->property("projectFiles") : projectView->property("allProjectsFiles")).toStringList() : QStringList();
     const QString projectBase = [this, projectView]() -> QString {
         if (!projectView)
             return QString();
@@ -85,50 +93,257 @@ void KateQuickOpenModel::refresh()
         return ret;
     }();
 
-    QVector<ModelEntry> allDocuments;
-    allDocuments.reserve(sortedViews.size() + openDocs.size() + projectDocs.size());
+    beginResetModel();
+
+    updateProjectFiles(projectView, projectBase);
+
+    /**
+     * open documents, few, computed each time
+     */
+    struct Document {
+        QUrl url;
+        QString fileName;
+        QString filePath;
+        size_t sort_id;
+    };
+    QVector<Document> documents;
+    documents.reserve(sortedViews.size() + openDocs.size());
 
     size_t sort_id = static_cast<size_t>(-1);
     for (auto *view : qAsConst(sortedViews)) {
         auto doc = view->document();
-        allDocuments.push_back({doc->url(), doc->documentName(), doc->url().toDisplayString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile).remove(projectBase).remove(QStringLiteral("/") + doc->documentName()), true, sort_id--, -1});
+        documents.push_back({doc->url(), doc->documentName(), doc->url().toDisplayString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile).remove(projectBase).remove(QStringLiteral("/") + doc->documentName()), sort_id--});
     }
 
     for (auto *doc : qAsConst(openDocs)) {
         const auto normalizedUrl = doc->url().toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile).remove(projectBase).remove(QStringLiteral("/") + doc->documentName());
-        allDocuments.push_back({doc->url(), doc->documentName(), normalizedUrl, true, 0, -1});
-    }
-
-    for (const auto &file : qAsConst(projectDocs)) {
-        QFileInfo fi(file);
-        const auto localFile = QUrl::fromLocalFile(fi.absoluteFilePath());
-        allDocuments.push_back({localFile, fi.fileName(), fi.filePath().remove(projectBase).remove(QStringLiteral("/") + fi.fileName()), false, 0, -1});
+        documents.push_back({doc->url(), doc->documentName(), normalizedUrl, 0});
     }
 
     /** Sort the arrays by filePath. */
-    std::stable_sort(std::begin(allDocuments), std::end(allDocuments), [](const ModelEntry &a, const ModelEntry &b) {
+    std::stable_sort(std::begin(documents), std::end(documents), [](const Document &a, const Document &b) {
         return a.filePath < b.filePath;
     });
 
     /** remove Duplicates.
-     * Note that the stable_sort above guarantees that the items that the
-     * bold/sort_id fields of the items added first are correctly preserved.
+     * Note that the stable_sort above guarantees that the sort_id fields of the items added first are correctly preserved.
      */
-    allDocuments.erase(std::unique(allDocuments.begin(),
-                                   allDocuments.end(),
-                                   [](const ModelEntry &a, const ModelEntry &b) {
-                                       return a.url == b.url;
-                                   }),
-                       std::end(allDocuments));
-
-    /** sort the arrays via boldness (open or not */
-    std::stable_sort(std::begin(allDocuments), std::end(allDocuments), [](const ModelEntry &a, const ModelEntry &b) {
-        if (a.bold == b.bold)
-            return a.sort_id > b.sort_id;
-        return a.bold > b.bold;
+    documents.erase(std::unique(documents.begin(),
+                                documents.end(),
+                                [](const Document &a, const Document &b) {
+                                    return a.url == b.url;
+                                }),
+                    std::end(documents));
+
+    /** sort the open documents by their views */
+    std::stable_sort(std::begin(documents), std::end(documents), [](const Document &a, const Document &b) {
+        return a.sort_id > b.sort_id;
     });
 
-    beginResetModel();
-    m_modelEntries = allDocuments;
+    /**
+     * strings of the previous open documents are not needed anymore
+     */
+    m_strings.resize(m_projectStringCount);
+    m_foldedStrings.resize(m_projectStringCount);
+    m_stringMasks.resize(m_projectStringCount);
+
+    /**
+     * frecencies of the session, few files, looked up in the project file table
+     */
+    KateSession::Ptr session = KateApp::self()->sessionManager()->activeSession();
+    const QHash<QString, double> frecencies = session ? session->fileFrecency()->frecencies() : QHash<QString, double>();
+    m_projectFileBonus.fill(0, m_projectFiles.size());
+    for (auto it = frecencies.constBegin(); it != frecencies.constEnd(); ++it) {
+        const int index = projectFileIndex(it.key());
+        if (index >= 0) {
+            m_projectFileBonus[index] = bonusForFrecency(it.value());
+        }
+    }
+
+    m_openEntries.clear();
+    QVector<bool> projectFileOpen(m_projectFiles.size(), false);
+    for (const auto &document : qAsConst(documents)) {
+        const int bonus = document.url.isLocalFile() ? bonusForFrecency(frecencies.value(document.url.toLocalFile())) : 0;
+        m_openEntries.push_back({document.url, addString(document.fileName), addString(document.filePath), iconForFile(document.fileName), bonus});
+
+        /**
+         * open project files are only shown once, as open document
+         */
+        if (document.url.isLocalFile()) {
+            const int index = projectFileIndex(document.url.toLocalFile());
+            if (index >= 0) {
+                projectFileOpen[index] = true;
+            }
+        }
+    }
+
+    m_projectRows.clear();
+    m_projectRows.reserve(m_projectFiles.size());
+    for (int i = 0; i < m_projectFiles.size(); ++i) {
+        if (!projectFileOpen[i]) {
+            m_projectRows.push_back(i);
+        }
+    }
+
     endResetModel();
 }
+
+void KateQuickOpenModel::updateProjectFiles(QObject *projectView, const QString &projectBase)
+{
+    /**
+     * nothing to do if the project files are the same as for the current table
+     */
+    const qulonglong version = projectView ? (m_listMode == CurrentProject ? projectView->property("projectFilesVersion") : projectView->property("allProjectsFilesVersion")).toULongLong() : 0;
+    if (m_projectFilesValid && version == m_projectFilesVersion && m_listMode == m_projectFilesListMode && projectBase == m_projectFilesBase) {
+        return;
+    }
+    m_projectFilesValid = true;
+    m_projectFilesVersion = version;
+    m_projectFilesListMode = m_listMode;
+    m_projectFilesBase = projectBase;
+
+    const QStringList projectDocs = projectView ? (m_listMode == CurrentProject ? projectView->property("projectFiles") : projectView->property("allProjectsFiles")).toStringList() : QStringList();
+
+    m_strings.clear();
+    m_foldedStrings.clear();
+    m_stringMasks.clear();
+    m_projectFiles.clear();
+    m_projectFileNames.clear();
+    m_projectFilePaths.clear();
+    m_projectFileIcons.clear();
+
+    /**
+     * intern names and paths, many files share them
+     */
+    QHash<QString, int> stringIds;
+    const auto intern = [this, &stringIds](const QString &string) {
+        auto it = stringIds.constFind(string);
+        if (it != stringIds.constEnd()) {
+            return it.value();
+        }
+        const int id = addString(string);
+        stringIds.insert(string, id);
+        return id;
+    };
+
+    QVector<int> fileNames;
+    QVector<int> filePaths;
+    fileNames.reserve(projectDocs.size());
+    filePaths.reserve(projectDocs.size());
+    for (const auto &file : projectDocs) {
+        /**
+         * path relative to the base without the file name, the file name for files in the base
+         */
+        const int start = file.startsWith(projectBase) ? projectBase.size() : 0;
+        const int slash = file.lastIndexOf(QLatin1Char('/'));
+        const int name = intern(file.mid(slash + 1));
+        fileNames.push_back(name);
+        filePaths.push_back((slash < start) ? name : intern(file.mid(start, slash - start)));
+    }
+
+    /** Sort by filePath, keep the order of the files for equal paths. */
+    QVector<int> order(projectDocs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this, &filePaths](int a, int b) {
+        return filePaths[a] != filePaths[b] && m_strings[filePaths[a]] < m_strings[filePaths[b]];
+    });
+
+    m_projectFiles.reserve(order.size());
+    m_projectFileNames.reserve(order.size());
+    m_projectFilePaths.reserve(order.size());
+    m_projectFileIcons.reserve(order.size());
+    for (int i : qAsConst(order)) {
+        m_projectFiles.push_back(projectDocs[i]);
+        m_projectFileNames.push_back(fileNames[i]);
+        m_projectFilePaths.push_back(filePaths[i]);
+        m_projectFileIcons.push_back(iconForFile(m_strings[fileNames[i]]));
+    }
+    m_projectStringCount = m_strings.size();
+
+    /**
+     * remove duplicates, e.g. files in multiple projects, keep the first
+     */
+    m_projectFilesSorted.resize(m_projectFiles.size());
+    std::iota(m_projectFilesSorted.begin(), m_projectFilesSorted.end(), 0);
+    std::stable_sort(m_projectFilesSorted.begin(), m_projectFilesSorted.end(), [this](int a, int b) {
+        return m_projectFiles[a] < m_projectFiles[b];
+    });
+    m_projectFilesSorted.erase(std::unique(m_projectFilesSorted.begin(),
+                                           m_projectFilesSorted.end(),
+                                           [this](int a, int b) {
+                                               return m_projectFiles[a] == m_projectFiles[b];
+                                           }),
+                               m_projectFilesSorted.end());
+    if (m_projectFilesSorted.size() != m_projectFiles.size()) {
+        QVector<bool> keep(m_projectFiles.size(), false);
+        for (int i : qAsConst(m_projectFilesSorted)) {
+            keep[i] = true;
+        }
+        QVector<int> newIndex(m_projectFiles.size(), -1);
+        int count = 0;
+        for (int i = 0; i < m_projectFiles.size(); ++i) {
+            if (keep[i]) {
+                newIndex[i] = count;
+                m_projectFiles[count] = m_projectFiles[i];
+                m_projectFileNames[count] = m_projectFileNames[i];
+                m_projectFilePaths[count] = m_projectFilePaths[i];
+                m_projectFileIcons[count] = m_projectFileIcons[i];
+                ++count;
+            }
+        }
+        m_projectFiles.resize(count);
+        m_projectFileNames.resize(count);
+        m_projectFilePaths.resize(count);
+        m_projectFileIcons.resize(count);
+        for (int &i : m_projectFilesSorted) {
+            i = newIndex[i];
+        }
+    }
+}
+
+int KateQuickOpenModel::addString(const QString &string)
+{
+    m_strings.push_back(string);
+    m_foldedStrings.push_back(kfts::fuzzy_fold(string));
+    m_stringMasks.push_back(kfts::fuzzy_char_mask(string));
+    return m_strings.size() - 1;
+}
+
+int KateQuickOpenModel::iconForFile(const QString &fileName)
+{
+    /**
+     * files without extension are looked up by name
+     */
+    const int dot = fileName.lastIndexOf(QLatin1Char('.'));
+    const QString key = (dot > 0) ? fileName.mid(dot) : fileName;
+    auto it = m_iconIds.constFind(key);
+    if (it != m_iconIds.constEnd()) {
+        return it.value();
+    }
+
+    const int id = m_icons.size();
+    m_icons.push_back(QIcon::fromTheme(QMimeDatabase().mimeTypeForFile(fileName, QMimeDatabase::MatchExtension).iconName()));
+    m_iconIds.insert(key, id);
+    return id;
+}
+
+int KateQuickOpenModel::projectFileIndex(const QString &file) const
+{
+    auto it = std::lower_bound(m_projectFilesSorted.cbegin(), m_projectFilesSorted.cend(), file, [this](int index, const QString &value) {
+        return m_projectFiles[index] < value;
+    });
+    return (it != m_projectFilesSorted.cend() && m_projectFiles[*it] == file) ? *it : -1;
+}
+
+int KateQuickOpenModel::bonusForFrecency(double frecency)
+{
+    /**
+     * logarithmic, a file used daily beats a slightly better match after a few letters
+     * but not a clearly better one
+     */
+    enum { Weight = 12, MaxBonus = 80 };
+    if (frecency <= 0) {
+        return 0;
+    }
+    return std::min<int>(MaxBonus, int(Weight * std::log2(1.0 + frecency)));
+}
@@ -9,6 +9,7 @@
 #define KATEQUICKOPENMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QIcon>
 #include <QUrl>
 #include <QVariant>
@@ -16,24 +17,22 @@
 
 class KateMainWindow;
 
-struct ModelEntry {
-    QUrl url; // used for actually opening a selected file (local or remote)
-    QString fileName; // display string for left column
-    QString filePath; // display string for right column
-    bool bold; // format line in bold text or not
-    size_t sort_id;
-    int score;
-};
-
 // needs to be defined outside of class to support forward declaration elsewhere
 enum KateQuickOpenModelList : int { CurrentProject, AllProjects };
 
+/**
+ * Model for quick open: the open documents first, then the project files.
+ * All names and paths are interned into a string table, together with a case folded copy and
+ * a character mask for fuzzy matching, see string(), foldedString() and stringMask().
+ * The project file table is only rebuilt if the project files did change since the last refresh.
+ * Files often and recently used in the session get a score bonus, see frecencyBonus().
+ */
 class KateQuickOpenModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
     enum Columns : int { FileName, FilePath, Bold };
-    enum Role { Score = Qt::UserRole + 1 };
+    enum Role { FilePathRole = Qt::UserRole + 1 };
     explicit KateQuickOpenModel(KateMainWindow *mainWindow, QObject *parent = nullptr);
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent) const override;
@@ -50,19 +49,123 @@ public:
         m_listMode = mode;
     }
 
-    bool setData(const QModelIndex &index, const QVariant &value, int role) override
+    /**
+     * id of the file name of the given row in the string table
+     */
+    int fileNameId(int row) const
+    {
+        return (row < m_openEntries.size()) ? m_openEntries[row].fileName : m_projectFileNames[m_projectRows[row - m_openEntries.size()]];
+    }
+
+    /**
+     * id of the file path of the given row in the string table
+     */
+    int filePathId(int row) const
+    {
+        return (row < m_openEntries.size()) ? m_openEntries[row].filePath : m_projectFilePaths[m_projectRows[row - m_openEntries.size()]];
+    }
+
+    const QString &string(int id) const
+    {
+        return m_strings[id];
+    }
+
+    /**
+     * case folded string, see kfts::fuzzy_fold
+     */
+    const QString &foldedString(int id) const
+    {
+        return m_foldedStrings[id];
+    }
+
+    /**
+     * character mask of the string, see kfts::fuzzy_char_mask
+     */
+    quint64 stringMask(int id) const
+    {
+        return m_stringMasks[id];
+    }
+
+    /**
+     * bonus added to the match score of the given row, for often and recently used files
+     */
+    int frecencyBonus(int row) const
     {
-        if (!index.isValid())
-            return false;
-        if (role == Role::Score) {
-            auto row = index.row();
-            m_modelEntries[row].score = value.toInt();
-        }
-        return QAbstractTableModel::setData(index, value, role);
+        return (row < m_openEntries.size()) ? m_openEntries[row].frecencyBonus : m_projectFileBonus[m_projectRows[row - m_openEntries.size()]];
     }
 
 private:
-    QVector<ModelEntry> m_modelEntries;
+    /**
+     * rebuild the project file table if the project files changed
+     */
+    void updateProjectFiles(QObject *projectView, const QString &projectBase);
+
+    /**
+     * add string to the string table
+     */
+    int addString(const QString &string);
+
+    /**
+     * icon id for the given file name, icons are shared by all files with the same extension
+     */
+    int iconForFile(const QString &fileName);
+
+    /**
+     * index of the given project file, -1 if none
+     */
+    int projectFileIndex(const QString &file) const;
+
+    /**
+     * score bonus for the given frecency, see KateFileFrecency
+     */
+    static int bonusForFrecency(double frecency);
+
+private:
+    /**
+     * open document, shown in bold
+     */
+    struct OpenEntry {
+        QUrl url;
+        int fileName;
+        int filePath;
+        int icon;
+        int frecencyBonus;
+    };
+
+    /**
+     * string table: strings of the project files, then strings of the open documents
+     */
+    QVector<QString> m_strings;
+    QVector<QString> m_foldedStrings;
+    QVector<quint64> m_stringMasks;
+    int m_projectStringCount = 0;
+
+    /**
+     * icons, by extension
+     */
+    QVector<QIcon> m_icons;
+    QHash<QString, int> m_iconIds;
+
+    /**
+     * project files, sorted by shown path, and the snapshot they are built from
+     * m_projectFilesSorted has their indices sorted by file for lookups
+     */
+    QVector<QString> m_projectFiles;
+    QVector<int> m_projectFileNames;
+    QVector<int> m_projectFilePaths;
+    QVector<int> m_projectFileIcons;
+    QVector<int> m_projectFilesSorted;
+    QVector<int> m_projectFileBonus;
+    qulonglong m_projectFilesVersion = 0;
+    QString m_projectFilesBase;
+    List m_projectFilesListMode{};
+    bool m_projectFilesValid = false;
+
+    /**
+     * shown entries: open documents, then the project files not open
+     */
+    QVector<OpenEntry> m_openEntries;
+    QVector<int> m_projectRows;
 
     /* TODO: don't rely in a pointer to the main window.
      * this is bad engineering, but current code is too tight
@@ -0,0 +1,171 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katefilefrecency.h"
+
+#include "katedebug.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * file format: magic, version, time all values are decayed to, count, then path and value per file
+ */
+static const quint32 frecencyMagic = 0x4b465243; // KFRC
+static const quint32 frecencyVersion = 1;
+
+/**
+ * entries decayed below this are not stored, about 46 days after a single access
+ */
+static const double minimalFrecency = 0.01;
+
+KateFileFrecency::KateFileFrecency(const QString &file)
+    : m_file(file)
+{
+}
+
+KateFileFrecency::~KateFileFrecency()
+{
+    save();
+}
+
+void KateFileFrecency::setFile(const QString &file)
+{
+    m_file = file;
+}
+
+void KateFileFrecency::recordAccess(const QString &path, qint64 time)
+{
+    if (path.isEmpty()) {
+        return;
+    }
+
+    load();
+    Entry &entry = m_entries[path];
+    entry.value = decayed(entry, time) + 1.0;
+    entry.time = time;
+    m_dirty = true;
+}
+
+double KateFileFrecency::frecency(const QString &path, qint64 time) const
+{
+    load();
+    const auto it = m_entries.constFind(path);
+    return (it == m_entries.constEnd()) ? 0.0 : decayed(it.value(), time);
+}
+
+QHash<QString, double> KateFileFrecency::frecencies(qint64 time) const
+{
+    load();
+    QHash<QString, double> frecencies;
+    frecencies.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        frecencies.insert(it.key(), decayed(it.value(), time));
+    }
+    return frecencies;
+}
+
+bool KateFileFrecency::save()
+{
+    if (!m_dirty || m_file.isEmpty()) {
+        return true;
+    }
+
+    /**
+     * store all values decayed to now, the ones with the highest frecency first
+     */
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    std::vector<std::pair<double, QString>> entries;
+    entries.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const double value = decayed(it.value(), now);
+        if (value >= minimalFrecency) {
+            entries.emplace_back(value, it.key());
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const std::pair<double, QString> &a, const std::pair<double, QString> &b) {
+        return a.first > b.first;
+    });
+    if (entries.size() > size_t(MaxEntries)) {
+        entries.resize(MaxEntries);
+    }
+
+    QSaveFile file(m_file);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(LOG_KATE) << "Failed to write file access history" << m_file;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+    stream << frecencyMagic << frecencyVersion << now << quint32(entries.size());
+    for (const auto &entry : entries) {
+        stream << entry.second << float(entry.first);
+    }
+    if (!file.commit()) {
+        qCWarning(LOG_KATE) << "Failed to write file access history" << m_file;
+        return false;
+    }
+
+    /**
+     * keep the memory in sync with the file
+     */
+    m_entries.clear();
+    for (const auto &entry : entries) {
+        m_entries.insert(entry.second, {entry.first, now});
+    }
+    m_dirty = false;
+    return true;
+}
+
+double KateFileFrecency::decayed(const Entry &entry, qint64 time)
+{
+    if (entry.value <= 0.0 || time <= entry.time) {
+        return std::max(entry.value, 0.0);
+    }
+    return entry.value * std::exp2(-double(time - entry.time) / HalfLife);
+}
+
+void KateFileFrecency::load() const
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QFile file(m_file);
+    if (m_file.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 time = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> time >> count;
+    if (stream.status() != QDataStream::Ok || magic != frecencyMagic || version != frecencyVersion) {
+        return;
+    }
+
+    m_entries.reserve(std::min<quint32>(count, MaxEntries));
+    for (quint32 i = 0; i < count; ++i) {
+        QString path;
+        float value = 0;
+        stream >> path >> value;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        m_entries.insert(path, {value, time});
+    }
+}
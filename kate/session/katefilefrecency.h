@@ -0,0 +1,113 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef __KATE_FILE_FRECENCY_H__
+#define __KATE_FILE_FRECENCY_H__
+
+#include "katetests_export.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+
+/**
+ * Access history of the files of a session, for ranking them, e.g. in quick open.
+ * Each access adds one to the frecency of a file, frecencies decay with a half-life of one week.
+ * The history is stored in a small binary file next to the session file, read on first use.
+ */
+class KATE_TESTS_EXPORT KateFileFrecency
+{
+public:
+    enum {
+        /**
+         * half-life of the frecencies, in seconds
+         */
+        HalfLife = 7 * 24 * 60 * 60,
+
+        /**
+         * files stored at most, the ones with the lowest frecency are dropped
+         */
+        MaxEntries = 2000
+    };
+
+    /**
+     * @param file file to store the history in
+     */
+    explicit KateFileFrecency(const QString &file);
+
+    /**
+     * stores the history, if changed
+     */
+    ~KateFileFrecency();
+
+    /**
+     * @return file the history is stored in
+     */
+    const QString &file() const
+    {
+        return m_file;
+    }
+
+    /**
+     * Change the file the history is stored in, the history is kept.
+     * @param file new file
+     */
+    void setFile(const QString &file);
+
+    /**
+     * Record an access of the given file, e.g. it got activated or saved.
+     * @param path local file path
+     * @param time time of the access, seconds since epoch
+     */
+    void recordAccess(const QString &path, qint64 time = QDateTime::currentSecsSinceEpoch());
+
+    /**
+     * @param path local file path
+     * @param time time to compute the decayed frecency for, seconds since epoch
+     * @return frecency of the file, 0 if never accessed
+     */
+    double frecency(const QString &path, qint64 time = QDateTime::currentSecsSinceEpoch()) const;
+
+    /**
+     * @param time time to compute the decayed frecencies for, seconds since epoch
+     * @return frecencies of all files in the history
+     */
+    QHash<QString, double> frecencies(qint64 time = QDateTime::currentSecsSinceEpoch()) const;
+
+    /**
+     * Write the history to the file, if it changed since loading.
+     * @return success
+     */
+    bool save();
+
+private:
+    /**
+     * frecency of a file, decayed up to the given time
+     */
+    struct Entry {
+        double value;
+        qint64 time;
+    };
+
+    /**
+     * decay the entry to the given time
+     */
+    static double decayed(const Entry &entry, qint64 time);
+
+    /**
+     * read the history from the file, once
+     */
+    void load() const;
+
+private:
+    QString m_file;
+    mutable QHash<QString, Entry> m_entries;
+    mutable bool m_loaded = false;
+    bool m_dirty = false;
+};
+
+#endif
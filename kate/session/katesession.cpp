@@ -8,6 +8,7 @@
 #include "katesession.h"
 
 #include "katedebug.h"
+#include "katefilefrecency.h"
 #include "katesessionmanager.h"
 
 #include <KConfig>
@@ -44,6 +45,7 @@ KateSession::KateSession(const QString &file, const QString &name, const bool an
 
 KateSession::~KateSession()
 {
+    delete m_fileFrecency;
     delete m_config;
 }
 
@@ -66,6 +68,16 @@ void KateSession::setFile(const QString &filename)
         m_config = cfg;
     }
 
+    // the file access history moves with the session file
+    if (filename != m_file) {
+        if (m_fileFrecency) {
+            m_fileFrecency->save();
+            m_fileFrecency->setFile(fileFrecencyFile(filename));
+        }
+        QFile::remove(fileFrecencyFile(filename));
+        QFile::rename(fileFrecencyFile(m_file), fileFrecencyFile(filename));
+    }
+
     m_file = filename;
 }
 
@@ -84,6 +96,29 @@ KConfig *KateSession::config()
     return m_config = new KConfig(m_file, KConfig::SimpleConfig);
 }
 
+KateFileFrecency *KateSession::fileFrecency()
+{
+    if (!m_fileFrecency) {
+        m_fileFrecency = new KateFileFrecency(fileFrecencyFile(m_file));
+    }
+    return m_fileFrecency;
+}
+
+QString KateSession::fileFrecencyFile(const QString &sessionFile)
+{
+    return sessionFile + QStringLiteral(".frecency");
+}
+
+/**
+ * copy the file access history of session to the new session file
+ */
+static void copyFileFrecency(const KateSession::Ptr &session, const QString &file)
+{
+    session->fileFrecency()->save();
+    QFile::remove(KateSession::fileFrecencyFile(file));
+    QFile::copy(KateSession::fileFrecencyFile(session->file()), KateSession::fileFrecencyFile(file));
+}
+
 KateSession::Ptr KateSession::create(const QString &file, const QString &name)
 {
     return Ptr(new KateSession(file, name, false));
@@ -91,6 +126,7 @@ KateSession::Ptr KateSession::create(const QString &file, const QString &name)
 
 KateSession::Ptr KateSession::createFrom(const KateSession::Ptr &session, const QString &file, const QString &name)
 {
+    copyFileFrecency(session, file);
     return Ptr(new KateSession(file, name, false, session->config()));
 }
 
@@ -101,6 +137,7 @@ KateSession::Ptr KateSession::createAnonymous(const QString &file)
 
 KateSession::Ptr KateSession::createAnonymousFrom(const KateSession::Ptr &session, const QString &file)
 {
+    copyFileFrecency(session, file);
     return Ptr(new KateSession(file, QString(), true, session->config()));
 }
 
@@ -15,6 +15,7 @@
 #include <QString>
 
 class KConfig;
+class KateFileFrecency;
 
 class KATE_TESTS_EXPORT KateSession : public QSharedData
 {
@@ -46,6 +47,19 @@ public:
      */
     KConfig *config();
 
+    /**
+     * access history of the files of this session
+     * on first access, will create the object, the history itself is read on first use
+     * @return file access history, never null
+     */
+    KateFileFrecency *fileFrecency();
+
+    /**
+     * @param sessionFile session file
+     * @return file the access history of the session is stored in
+     */
+    static QString fileFrecencyFile(const QString &sessionFile);
+
     /**
      * count of documents in this session
      * @return documents count
@@ -96,6 +110,7 @@ public:
 private:
     friend class KateSessionManager;
     friend class KateSessionTest;
+    friend class KateFileFrecencyTest;
     /**
      * set session name
      */
@@ -121,6 +136,7 @@ private:
     bool m_anonymous;
     unsigned int m_documents;
     KConfig *m_config;
+    KateFileFrecency *m_fileFrecency = nullptr;
     QDateTime m_timestamp;
 };
 
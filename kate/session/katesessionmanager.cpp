@@ -8,6 +8,7 @@
 #include "katesessionmanager.h"
 
 #include "katesessionmanagedialog.h"
+#include "katefilefrecency.h"
 
 #include "kateapp.h"
 #include "katepluginmanager.h"
@@ -262,6 +263,7 @@ bool KateSessionManager::deleteSession(KateSession::Ptr session)
     }
 
     QFile::remove(session->file());
+    QFile::remove(KateSession::fileFrecencyFile(session->file()));
     m_sessions.remove(session->name());
     // Due to this remove from m_sessions will updateSessionList() no signal emit,
     // but this way is there no delay between deletion and information
@@ -374,6 +376,7 @@ bool KateSessionManager::saveActiveSession(bool rememberAsLast)
     KConfig *sc = activeSession()->config();
 
     saveSessionTo(sc);
+    activeSession()->fileFrecency()->save();
 
     if (rememberAsLast && !activeSession()->isAnonymous()) {
         KSharedConfigPtr c = KSharedConfig::openConfig();
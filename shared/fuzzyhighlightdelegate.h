@@ -0,0 +1,201 @@
+/*
+    SPDX-FileCopyrightText: 2021 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef FUZZY_HIGHLIGHT_DELEGATE_H
+#define FUZZY_HIGHLIGHT_DELEGATE_H
+
+#include <QApplication>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include <QTextLayout>
+
+#include <algorithm>
+#include <functional>
+
+#include <kfts_fuzzy_match.h>
+
+/**
+ * Item delegate that shows the text of an item with the letters matching a filter in bold.
+ * Optionally a secondary text, e.g. a path, is shown grayed after it.
+ * The text is painted with one QTextLayout, no rich text is built or parsed.
+ *
+ * Includes kfts_fuzzy_match.h, include it only in source files, too.
+ */
+class FuzzyHighlightDelegate : public QStyledItemDelegate
+{
+public:
+    /**
+     * How the filter string is matched.
+     */
+    enum MatchMode {
+        /**
+         * fuzzy, see kfts::fuzzy_match
+         */
+        FuzzyMatch,
+
+        /**
+         * all occurrences of the space separated words of the filter
+         */
+        SubstringMatch
+    };
+
+    /**
+     * Which texts get highlighted.
+     */
+    enum Highlight { HighlightText = 0x1, HighlightSecondaryText = 0x2 };
+
+    FuzzyHighlightDelegate(QObject *parent = nullptr)
+        : QStyledItemDelegate(parent)
+    {
+    }
+
+    void setFilterString(const QString &filter)
+    {
+        m_filter = filter;
+    }
+
+    void setMatchMode(MatchMode mode)
+    {
+        m_matchMode = mode;
+    }
+
+    /**
+     * @param highlight combination of Highlight flags
+     */
+    void setHighlight(int highlight)
+    {
+        m_highlight = highlight;
+    }
+
+    /**
+     * @param secondaryText function returning the secondary text for an index, empty for none
+     */
+    void setSecondaryText(const std::function<QString(const QModelIndex &)> &secondaryText)
+    {
+        m_secondaryText = secondaryText;
+    }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    {
+        QStyleOptionViewItem options = option;
+        initStyleOption(&options, index);
+
+        const QString text = options.text;
+        const QString secondary = m_secondaryText ? m_secondaryText(index) : QString();
+
+        // background, selection and icon
+        const QWidget *widget = options.widget;
+        QStyle *style = widget ? widget->style() : QApplication::style();
+        options.text = QString();
+        style->drawControl(QStyle::CE_ItemViewItem, &options, painter, widget);
+
+        // one layout for both texts, formats for the matches
+        const QString separator = QStringLiteral("  ");
+        QString fullText = text;
+        if (!secondary.isEmpty()) {
+            fullText += separator + secondary;
+        }
+
+        QVector<QTextLayout::FormatRange> formats;
+        if (m_highlight & HighlightText) {
+            addMatchFormats(text, 0, options, formats);
+        }
+        if (!secondary.isEmpty()) {
+            const int start = text.size() + separator.size();
+            QTextLayout::FormatRange secondaryFormat;
+            secondaryFormat.start = start;
+            secondaryFormat.length = secondary.size();
+            if (!(options.state & QStyle::State_Selected)) {
+                secondaryFormat.format.setForeground(options.palette.brush(QPalette::Disabled, QPalette::Text));
+            }
+            formats.append(secondaryFormat);
+            if (m_highlight & HighlightSecondaryText) {
+                addMatchFormats(secondary, start, options, formats);
+            }
+        }
+
+        const QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &options, widget);
+        QTextLayout layout(fullText, options.font);
+        QTextOption textOption;
+        textOption.setWrapMode(QTextOption::NoWrap);
+        layout.setTextOption(textOption);
+        layout.beginLayout();
+        QTextLine line = layout.createLine();
+        line.setLineWidth(textRect.width());
+        layout.endLayout();
+
+        painter->save();
+        painter->setClipRect(textRect);
+        painter->setPen(options.palette.color(QPalette::Active, (options.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text));
+        const int textMargin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, widget) + 1;
+        const QPointF position(textRect.x() + textMargin, textRect.y() + (textRect.height() - line.height()) / 2);
+        layout.draw(painter, position, formats);
+        painter->restore();
+    }
+
+private:
+    /**
+     * add bold formats for the runs of matched letters in text, that starts at offset in the layout
+     */
+    void addMatchFormats(const QString &text, int offset, const QStyleOptionViewItem &options, QVector<QTextLayout::FormatRange> &formats) const
+    {
+        if (m_filter.isEmpty()) {
+            return;
+        }
+
+        // positions of matched letters, sorted
+        QVector<int> positions;
+        if (m_matchMode == FuzzyMatch) {
+            int score = 0;
+            kfts::fuzzy_match(m_filter, text, score, positions);
+        } else {
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+            const auto words = m_filter.splitRef(QLatin1Char(' '), QString::SkipEmptyParts);
+#else
+            const auto words = m_filter.splitRef(QLatin1Char(' '), Qt::SkipEmptyParts);
+#endif
+            QVector<bool> matched(text.size(), false);
+            for (const auto &word : words) {
+                for (int pos = text.indexOf(word, 0, Qt::CaseInsensitive); pos >= 0; pos = text.indexOf(word, pos + word.size(), Qt::CaseInsensitive)) {
+                    std::fill(matched.begin() + pos, matched.begin() + pos + word.size(), true);
+                }
+            }
+            for (int i = 0; i < matched.size(); ++i) {
+                if (matched[i]) {
+                    positions.append(i);
+                }
+            }
+        }
+
+        QTextCharFormat format;
+        format.setFontWeight(QFont::Bold);
+        if (!(options.state & QStyle::State_Selected)) {
+            format.setForeground(options.palette.link());
+        }
+
+        for (int i = 0; i < positions.size();) {
+            int end = i + 1;
+            while (end < positions.size() && positions[end] == positions[end - 1] + 1) {
+                ++end;
+            }
+
+            QTextLayout::FormatRange range;
+            range.start = offset + positions[i];
+            range.length = end - i;
+            range.format = format;
+            formats.append(range);
+            i = end;
+        }
+    }
+
+private:
+    QString m_filter;
+    MatchMode m_matchMode = FuzzyMatch;
+    int m_highlight = HighlightText;
+    std::function<QString(const QModelIndex &)> m_secondaryText;
+};
+
+#endif
@@ -9,6 +9,11 @@
 #define KFTS_FUZZY_MATCH_H
 
 #include <QString>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include <algorithm>
+#include <limits>
 
 /**
  * This is based on https://github.com/forrestthewoods/lib_fts/blob/master/code/fts_fuzzy_match.h
@@ -33,15 +38,36 @@ Q_DECL_UNUSED static bool fuzzy_match(const QStringView pattern, const QStringVi
 Q_DECL_UNUSED static bool fuzzy_match(const QStringView pattern, const QStringView str, int &outScore, uint8_t *matches, int maxMatches);
 
 /**
- * @brief get string for display in treeview / listview. This should be used from style delegate.
- * For example: with @a pattern = "kate", @a str = "kateapp" and @htmlTag = "<b>
- * the output will be <b>k</b><b>a</b><b>t</b><b>e</b>app which will be visible to user as
- * <b>kate</b>app.
- *
- * TODO: improve this so that we don't have to put html tags on every char probably using some kind
- * of interval container
+ * @brief same as fuzzy_match, @a positions receives the positions in @a str of the matched pattern letters.
+ * Use it to highlight the matched letters.
+ */
+Q_DECL_UNUSED static bool fuzzy_match(const QStringView pattern, const QStringView str, int &outScore, QVector<int> &positions);
+
+/**
+ * @brief 64 bit mask of the characters in @a str, case-insensitive.
+ * Compute it once per candidate string and per pattern, then use the fuzzy_match overload
+ * taking the masks: candidates that lack a character of the pattern are rejected with one AND.
+ */
+Q_DECL_UNUSED static quint64 fuzzy_char_mask(const QStringView str);
+
+/**
+ * @brief same as fuzzy_match, but first rejects @a str if its @a strMask lacks bits of @a patternMask.
+ * Both masks must be computed by fuzzy_char_mask.
+ */
+Q_DECL_UNUSED static bool fuzzy_match(const QStringView pattern, quint64 patternMask, const QStringView str, quint64 strMask, int &outScore);
+
+/**
+ * @brief case folded copy of @a str, as used for matching. Has the same length as @a str.
  */
-Q_DECL_UNUSED static QString to_fuzzy_matched_display_string(const QStringView pattern, QString &str, const QString &htmlTag, const QString &htmlTagClose);
+Q_DECL_UNUSED static QString fuzzy_fold(const QStringView str);
+
+/**
+ * @brief same as the fuzzy_match overload taking masks, for candidates with a precomputed
+ * case folded copy @a foldedStr, as returned by fuzzy_fold(str).
+ */
+Q_DECL_UNUSED static bool
+fuzzy_match(const QStringView pattern, quint64 patternMask, const QStringView str, const QStringView foldedStr, quint64 strMask, int &outScore);
+
 }
 
 namespace kfts
@@ -49,17 +75,46 @@ namespace kfts
 // Forward declarations for "private" implementation
 namespace fuzzy_internal
 {
-static bool fuzzy_match_recursive(QStringView::const_iterator pattern,
-                                  QStringView::const_iterator str,
-                                  int &outScore,
-                                  const QStringView::const_iterator strBegin,
-                                  const QStringView::const_iterator strEnd,
-                                  const QStringView::const_iterator patternEnd,
-                                  uint8_t const *srcMatches,
-                                  uint8_t *newMatches,
-                                  int maxMatches,
-                                  int nextMatch,
-                                  int &recursionCount);
+static bool fuzzy_match_dp(const QStringView pattern, const QStringView str, const QStringView foldedStr, int &outScore, int *positions);
+
+/**
+ * lower case, without table lookups for ASCII
+ */
+static inline QChar toLower(QChar c)
+{
+    const ushort u = c.unicode();
+    if (u < 128) {
+        return QChar((u >= 'A' && u <= 'Z') ? ushort(u + ('a' - 'A')) : u);
+    }
+    return c.toLower();
+}
+
+static inline bool isLower(QChar c)
+{
+    const ushort u = c.unicode();
+    return u < 128 ? (u >= 'a' && u <= 'z') : c.isLower();
+}
+
+static inline bool isUpper(QChar c)
+{
+    const ushort u = c.unicode();
+    return u < 128 ? (u >= 'A' && u <= 'Z') : c.isUpper();
+}
+
+/**
+ * bit of a lower case character in the mask: letters and digits get an own bit, the rest shares the others
+ */
+static inline int charBit(QChar lower)
+{
+    const ushort u = lower.unicode();
+    if (u >= 'a' && u <= 'z') {
+        return u - 'a';
+    }
+    if (u >= '0' && u <= '9') {
+        return 26 + (u - '0');
+    }
+    return 36 + (u % 28);
+}
 }
 
 // Public interface
@@ -67,7 +122,7 @@ static bool fuzzy_match_simple(const QStringView pattern, const QStringView str)
 {
     auto patternIt = pattern.cbegin();
     for (auto strIt = str.cbegin(); strIt != str.cend() && patternIt != pattern.cend(); ++strIt) {
-        if (strIt->toLower() == patternIt->toLower())
+        if (fuzzy_internal::toLower(*strIt) == fuzzy_internal::toLower(*patternIt))
             ++patternIt;
     }
     return patternIt == pattern.cend();
@@ -75,178 +130,228 @@ static bool fuzzy_match_simple(const QStringView pattern, const QStringView str)
 
 static bool fuzzy_match(const QStringView pattern, const QStringView str, int &outScore)
 {
-    uint8_t matches[256];
-    return fuzzy_match(pattern, str, outScore, matches, sizeof(matches));
+    // no match positions needed, saves the bookkeeping for them
+    return fuzzy_internal::fuzzy_match_dp(pattern, str, QStringView(), outScore, nullptr);
 }
 
 static bool fuzzy_match(const QStringView pattern, const QStringView str, int &outScore, uint8_t *matches, int maxMatches)
 {
-    int recursionCount = 0;
+    // Supplied matches buffer is too short
+    if (pattern.size() > maxMatches)
+        return false;
 
-    auto strIt = str.cbegin();
-    auto patternIt = pattern.cbegin();
-    const auto patternEnd = pattern.cend();
-    const auto strEnd = str.cend();
+    QVarLengthArray<int, 256> positions(pattern.size());
+    if (!fuzzy_internal::fuzzy_match_dp(pattern, str, QStringView(), outScore, positions.data()))
+        return false;
 
-    return fuzzy_internal::fuzzy_match_recursive(patternIt, strIt, outScore, strIt, strEnd, patternEnd, nullptr, matches, maxMatches, 0, recursionCount);
+    for (int i = 0; i < positions.size(); ++i)
+        matches[i] = (uint8_t)positions[i];
+    return true;
 }
 
-// Private implementation
-static bool fuzzy_internal::fuzzy_match_recursive(QStringView::const_iterator pattern,
-                                                  QStringView::const_iterator str,
-                                                  int &outScore,
-                                                  const QStringView::const_iterator strBegin,
-                                                  const QStringView::const_iterator strEnd,
-                                                  const QStringView::const_iterator patternEnd,
-                                                  const uint8_t *srcMatches,
-                                                  uint8_t *matches,
-                                                  int maxMatches,
-                                                  int nextMatch,
-                                                  int &recursionCount)
-{
-    // Count recursions
-    static constexpr int recursionLimit = 10;
-    ++recursionCount;
-    if (recursionCount >= recursionLimit)
+static bool fuzzy_match(const QStringView pattern, const QStringView str, int &outScore, QVector<int> &positions)
+{
+    positions.resize(pattern.size());
+    if (!fuzzy_internal::fuzzy_match_dp(pattern, str, QStringView(), outScore, positions.data())) {
+        positions.clear();
         return false;
+    }
+    return true;
+}
 
-    // Detect end of strings
-    if (pattern == patternEnd || str == strEnd)
+static quint64 fuzzy_char_mask(const QStringView str)
+{
+    quint64 mask = 0;
+    for (const QChar c : str) {
+        mask |= quint64(1) << fuzzy_internal::charBit(fuzzy_internal::toLower(c));
+    }
+    return mask;
+}
+
+static bool fuzzy_match(const QStringView pattern, quint64 patternMask, const QStringView str, quint64 strMask, int &outScore)
+{
+    if (patternMask & ~strMask)
         return false;
+    return fuzzy_internal::fuzzy_match_dp(pattern, str, QStringView(), outScore, nullptr);
+}
 
-    // Recursion params
-    bool recursiveMatch = false;
-    uint8_t bestRecursiveMatches[256];
-    int bestRecursiveScore = 0;
-
-    // Loop through pattern and str looking for a match
-    bool first_match = true;
-    while (pattern != patternEnd && str != strEnd) {
-        // Found match
-        if (pattern->toLower() == str->toLower()) {
-            // Supplied matches buffer was too short
-            if (nextMatch >= maxMatches)
-                return false;
-
-            // "Copy-on-Write" srcMatches into matches
-            if (first_match && srcMatches) {
-                memcpy(matches, srcMatches, nextMatch);
-                first_match = false;
-            }
+static QString fuzzy_fold(const QStringView str)
+{
+    QString folded(str.size(), Qt::Uninitialized);
+    QChar *out = folded.data();
+    for (const QChar c : str) {
+        *out++ = fuzzy_internal::toLower(c);
+    }
+    return folded;
+}
 
-            // Recursive call that "skips" this match
-            uint8_t recursiveMatches[256];
-            int recursiveScore;
-            auto strNextChar = std::next(str);
-            if (fuzzy_match_recursive(pattern, strNextChar, recursiveScore, strBegin, strEnd, patternEnd, matches, recursiveMatches, sizeof(recursiveMatches), nextMatch, recursionCount)) {
-                // Pick best recursive score
-                if (!recursiveMatch || recursiveScore > bestRecursiveScore) {
-                    memcpy(bestRecursiveMatches, recursiveMatches, 256);
-                    bestRecursiveScore = recursiveScore;
-                }
-                recursiveMatch = true;
-            }
+static bool fuzzy_match(const QStringView pattern, quint64 patternMask, const QStringView str, const QStringView foldedStr, quint64 strMask, int &outScore)
+{
+    if (patternMask & ~strMask)
+        return false;
+    return fuzzy_internal::fuzzy_match_dp(pattern, str, foldedStr, outScore, nullptr);
+}
 
-            // Advance
-            matches[nextMatch++] = (uint8_t)(std::distance(strBegin, str));
-            ++pattern;
-        }
-        ++str;
-    }
+// Private implementation
+/**
+ * Find the matching of pattern in str with the best score.
+ *
+ * The score is 100, minus a penalty for unmatched letters and letters before the first match,
+ * plus bonuses for each matched letter: after a separator, camel case hump, first letter,
+ * adjacent to the previous match. Only the adjacency bonus depends on the previous match,
+ * therefore the best score for "pattern[i] matched at str[j]" only depends on the best scores
+ * of pattern[i - 1], computed row by row.
+ * Pattern letter i can only match between its earliest (greedy from the front) and
+ * latest (greedy from the back) position, only this band is computed.
+ * If @a foldedStr is not empty, it is the case folded @a str.
+ */
+static bool fuzzy_internal::fuzzy_match_dp(const QStringView pattern, const QStringView str, const QStringView foldedStr, int &outScore, int *positions)
+{
+    static constexpr int sequential_bonus = 15; // bonus for adjacent matches
+    static constexpr int separator_bonus = 30; // bonus if match occurs after a separator
+    static constexpr int camel_bonus = 30; // bonus if match is uppercase and prev is lower
+    static constexpr int first_letter_bonus = 15; // bonus if the first letter is matched
 
-    // Determine if full pattern was matched
-    bool matched = pattern == patternEnd ? true : false;
+    static constexpr int leading_letter_penalty = -5; // penalty applied for every letter in str before the first match
+    static constexpr int max_leading_letter_penalty = -15; // maximum penalty for leading letters
+    static constexpr int unmatched_letter_penalty = -1; // penalty for every letter that doesn't matter
 
-    // Calculate score
-    if (matched) {
-        static constexpr int sequential_bonus = 15; // bonus for adjacent matches
-        static constexpr int separator_bonus = 30; // bonus if match occurs after a separator
-        static constexpr int camel_bonus = 30; // bonus if match is uppercase and prev is lower
-        static constexpr int first_letter_bonus = 15; // bonus if the first letter is matched
+    static constexpr int no_match = std::numeric_limits<int>::min() / 2;
 
-        static constexpr int leading_letter_penalty = -5; // penalty applied for every letter in str before the first match
-        static constexpr int max_leading_letter_penalty = -15; // maximum penalty for leading letters
-        static constexpr int unmatched_letter_penalty = -1; // penalty for every letter that doesn't matter
+    const int n = pattern.size();
+    const int m = str.size();
+    if (n == 0 || m == 0 || n > m)
+        return false;
 
-        // Iterate str to end
-        while (str != strEnd)
-            ++str;
+    QVarLengthArray<QChar, 64> lowerPattern(n);
+    for (int i = 0; i < n; ++i)
+        lowerPattern[i] = toLower(pattern[i]);
 
-        // Initialize score
-        outScore = 100;
+    // Lower case string, if not precomputed
+    QVarLengthArray<QChar, 256> lowerStrData(foldedStr.size() == m ? 0 : m);
+    if (foldedStr.size() != m) {
+        for (int j = 0; j < m; ++j)
+            lowerStrData[j] = toLower(str[j]);
+    }
+    const QChar *lowerStr = foldedStr.size() == m ? foldedStr.data() : lowerStrData.constData();
 
-        // Apply leading letter penalty
-        int penalty = leading_letter_penalty * matches[0];
-        if (penalty < max_leading_letter_penalty)
-            penalty = max_leading_letter_penalty;
-        outScore += penalty;
+    // Band of possible positions per pattern letter, this also rejects non-matches
+    QVarLengthArray<int, 64> earliest(n);
+    QVarLengthArray<int, 64> latest(n);
+    for (int i = 0, j = 0; i < n; ++i, ++j) {
+        while (j < m && lowerStr[j] != lowerPattern[i])
+            ++j;
+        if (j == m)
+            return false;
+        earliest[i] = j;
+    }
+    for (int i = n - 1, j = m - 1; i >= 0; --i, --j) {
+        while (lowerStr[j] != lowerPattern[i])
+            --j;
+        latest[i] = j;
+    }
 
-        // Apply unmatched penalty
-        const int unmatched = (int)(std::distance(strBegin, str)) - nextMatch;
-        outScore += unmatched_letter_penalty * unmatched;
+    // Bonuses only for the part that can match
+    const int first = earliest[0];
+    const int last = latest[n - 1];
+    QVarLengthArray<int, 256> bonus(m);
+    for (int j = first; j <= last; ++j) {
+        if (j == 0) {
+            // First letter
+            bonus[j] = first_letter_bonus;
+            continue;
+        }
 
-        // Apply ordering bonuses
-        for (int i = 0; i < nextMatch; ++i) {
-            uint8_t currIdx = matches[i];
+        // Check for bonuses based on neighbor character value
+        const QChar neighbor = str[j - 1];
+        const QChar curr = str[j];
+        int b = 0;
+        // Camel case
+        if (isLower(neighbor) && isUpper(curr))
+            b += camel_bonus;
+        // Separator
+        if (neighbor == QLatin1Char('_') || neighbor == QLatin1Char(' '))
+            b += separator_bonus;
+        bonus[j] = b;
+    }
 
-            if (i > 0) {
-                uint8_t prevIdx = matches[i - 1];
+    // Best score per position for the previous and the current pattern letter
+    // and, if match positions are wanted, the position of the previous letter for each entry
+    QVarLengthArray<int, 256> prevRowData(m);
+    QVarLengthArray<int, 256> currRowData(m);
+    int *prevRow = prevRowData.data();
+    int *currRow = currRowData.data();
+    QVarLengthArray<int, 1> from(positions ? n * m : 0);
+
+    for (int j = earliest[0]; j <= latest[0]; ++j) {
+        prevRow[j] = no_match;
+        if (lowerStr[j] == lowerPattern[0]) {
+            // Apply leading letter penalty
+            prevRow[j] = bonus[j] + std::max(leading_letter_penalty * j, max_leading_letter_penalty);
+        }
+    }
 
-                // Sequential
-                if (currIdx == (prevIdx + 1))
-                    outScore += sequential_bonus;
+    for (int i = 1; i < n; ++i) {
+        // best entry of the previous letter at least two positions before j
+        int bestBefore = no_match;
+        int bestBeforePos = -1;
+        int k = earliest[i - 1];
+        for (int j = earliest[i]; j <= latest[i]; ++j) {
+            for (; k <= j - 2 && k <= latest[i - 1]; ++k) {
+                if (prevRow[k] > bestBefore) {
+                    bestBefore = prevRow[k];
+                    bestBeforePos = k;
+                }
             }
 
-            // Check for bonuses based on neighbor character value
-            if (currIdx > 0) {
-                // Camel case
-                QChar neighbor = *(strBegin + currIdx - 1);
-                QChar curr = *(strBegin + currIdx);
-                if (neighbor.isLower() && curr.isUpper())
-                    outScore += camel_bonus;
-
-                // Separator
-                bool neighborSeparator = neighbor == QLatin1Char('_') || neighbor == QLatin1Char(' ');
-                if (neighborSeparator)
-                    outScore += separator_bonus;
-            } else {
-                // First letter
-                outScore += first_letter_bonus;
+            currRow[j] = no_match;
+            if (lowerStr[j] != lowerPattern[i])
+                continue;
+
+            // Sequential, preferred on equal score
+            int score = bestBefore;
+            int pos = bestBeforePos;
+            if (j - 1 >= earliest[i - 1] && j - 1 <= latest[i - 1] && prevRow[j - 1] != no_match && prevRow[j - 1] + sequential_bonus >= score) {
+                score = prevRow[j - 1] + sequential_bonus;
+                pos = j - 1;
             }
+
+            if (score == no_match)
+                continue;
+
+            currRow[j] = score + bonus[j];
+            if (positions)
+                from[i * m + j] = pos;
         }
+        std::swap(prevRow, currRow);
     }
 
-    // Return best result
-    if (recursiveMatch && (!matched || bestRecursiveScore > outScore)) {
-        // Recursive score is better than "this"
-        memcpy(matches, bestRecursiveMatches, maxMatches);
-        outScore = bestRecursiveScore;
-        return true;
-    } else if (matched) {
-        // "this" score is better than recursive
-        return true;
-    } else {
-        // no match
-        return false;
+    // Best end position
+    int best = no_match;
+    int bestPos = -1;
+    for (int j = earliest[n - 1]; j <= latest[n - 1]; ++j) {
+        if (prevRow[j] > best) {
+            best = prevRow[j];
+            bestPos = j;
+        }
     }
-}
+    if (best == no_match)
+        return false;
 
-static QString to_fuzzy_matched_display_string(const QStringView pattern, QString &str, const QString &htmlTag, const QString &htmlTagClose)
-{
-    /**
-     * FIXME Don't do so many appends. Instead consider using some interval based solution to wrap a range
-     * of text with the html <tag></tag>
-     */
-    int j = 0;
-    for (int i = 0; i < str.size() && j < pattern.size(); ++i) {
-        if (str.at(i).toLower() == pattern.at(j).toLower()) {
-            str.replace(i, 1, htmlTag + str.at(i) + htmlTagClose);
-            i += htmlTag.size() + htmlTagClose.size();
-            ++j;
+    // Apply unmatched penalty
+    outScore = 100 + best + unmatched_letter_penalty * (m - n);
+
+    // Collect positions
+    if (positions) {
+        for (int i = n - 1; i >= 0; --i) {
+            positions[i] = bestPos;
+            if (i > 0)
+                bestPos = from[i * m + bestPos];
         }
     }
-    return str;
+    return true;
 }
+
 } // namespace kfts
 
 #endif // KFTS_FUZZY_MATCH_H